@@ -35,6 +35,21 @@ LIBDVDAUDIO_MKVERSION(LIBDVDAUDIO_MAJOR_VERSION, \
 
 #define PTS_PER_SECOND 90000
 
+/*thread safety
+
+  the library keeps no global mutable state, so:
+
+  - DVDA, DVDA_Titleset, DVDA_Title and DVDA_Track objects
+    are only read once opened, so they may be shared between threads
+    provided none is closed while another thread is using it
+
+  - each DVDA_Track_Reader must be used by one thread at a time,
+    but any number of readers - even of the same track -
+    may be opened, read and closed on separate threads at once
+
+  - opening readers of a CPPM-protected disc on several threads
+    authenticates with the drive one reader at a time*/
+
 struct DVDA_s;
 struct DVDA_Titleset_s;
 struct DVDA_Title_s;
@@ -51,6 +66,23 @@ typedef struct DVDA_Track_Reader_s DVDA_Track_Reader;
 
 typedef enum {DVDA_PCM, DVDA_MLP} dvda_codec_t;
 
+/*flags for dvda_open_track_reader_ex() and dvda_open_title_reader_ex(),
+  which may be OR-ed together*/
+typedef enum {
+    DVDA_DEFAULT = 0x0,
+    /*decode only the 2 channel presentation carried in
+      substream 0 of 2 substream MLP streams
+      and skip the remaining channels entirely*/
+    DVDA_STEREO_ONLY = 0x1,
+    /*decode MLP tracks on a pool of worker threads,
+      one per online processor*/
+    DVDA_PARALLEL_DECODE = 0x2,
+    /*skip the parity and CRC-8 checks of MLP substreams,
+      which is only suitable for re-decoding material
+      that has already been verified*/
+    DVDA_SKIP_VERIFICATION = 0x4
+} dvda_reader_flags_t;
+
 /*given a path to the disc's AUDIO_TS directory
   and a device (such as "/dev/cdrom") - which may be NULL,
   returns a DVDA or NULL if AUDIO_TS.IFO is missing or invalid
@@ -138,6 +170,17 @@ dvda_track_pts_index(const DVDA_Track* track);
 unsigned
 dvda_track_pts_length(const DVDA_Track* track);
 
+/*returns the exact number of PCM frames in the track,
+  as will be returned by dvda_read(), or 0 if an error occurs
+
+  for MLP tracks this walks the track's MLP frame headers
+  without decoding any audio, so it runs at the speed of reading the disc,
+  while PCM tracks are run through the PCM decoder to their end,
+  since a track's last packet may run past its PTS length,
+  which costs about as much as reading the whole track*/
+uint64_t
+dvda_track_pcm_frames(const DVDA_Track* track);
+
 /*returns the track's first sector
 
   note that it may not start at the very beginning of the sector*/
@@ -158,9 +201,104 @@ dvda_track_last_sector(const DVDA_Track* track);
 DVDA_Track_Reader*
 dvda_open_track_reader(const DVDA_Track* track);
 
+/*as dvda_open_track_reader() but with a set of dvda_reader_flags_t
+
+  with DVDA_STEREO_ONLY, MLP tracks with 2 substreams
+  are returned as 2 channel front left / front right streams
+  (as reported by dvda_channel_count() and dvda_riff_wave_channel_mask())
+  while all other tracks are returned unchanged
+
+  with DVDA_PARALLEL_DECODE, MLP tracks are split at restart points
+  and the pieces decoded concurrently, which yields identical samples
+  but buffers more of the track in memory at once
+
+  with DVDA_SKIP_VERIFICATION, MLP substreams are decoded
+  without checking their parity and CRC-8*/
+DVDA_Track_Reader*
+dvda_open_track_reader_ex(const DVDA_Track* track, unsigned flags);
+
+/*given a DVDA_Title object, returns a DVDA_Track_Reader
+  which returns all of the title's tracks as one continuous stream
+  or NULL if some error occurs opening the title for reading
+
+  the title is decoded in a single pass with a single decoder,
+  so no PCM frames are lost or repeated between tracks
+  and an MLP stream isn't re-synchronized at each track's start
+
+  dvda_read() returns no more than one track's PCM frames per call
+  and dvda_reader_track_number() indicates which track they're from
+
+  should a later track's stream attributes differ from the first's,
+  the stream ends before that track,
+  which may then be read with dvda_open_track_reader()
+
+  the DVDA_Track_Reader should be closed with dvda_close_track_reader()
+  when no longer needed*/
+DVDA_Track_Reader*
+dvda_open_title_reader(const DVDA_Title* title);
+
+/*as dvda_open_title_reader() but with a set of dvda_reader_flags_t
+  which work as they do for dvda_open_track_reader_ex()*/
+DVDA_Track_Reader*
+dvda_open_title_reader_ex(const DVDA_Title* title, unsigned flags);
+
 void
 dvda_close_track_reader(DVDA_Track_Reader* reader);
 
+/*a set of callbacks which receive the tracks read by dvda_read_titleset()
+
+  each returns 0 to continue reading or nonzero to stop immediately*/
+typedef struct {
+    /*called before each track's PCM frames with its title and track number
+      and a reader whose stream attributes, such as channel count,
+      apply to the track*/
+    int (*start_track)(void* sink_data,
+                       unsigned title,
+                       unsigned track,
+                       const DVDA_Track_Reader* reader);
+
+    /*called with successive runs of the track's PCM frames
+      interleaved as returned by dvda_read()*/
+    int (*write)(void* sink_data,
+                 const int buffer[],
+                 unsigned pcm_frames);
+
+    /*called after the track's final PCM frames*/
+    int (*finish_track)(void* sink_data);
+} dvda_track_sink_t;
+
+/*decodes every track of every title in the title set
+  in a single sequential pass over its AOB files,
+  in the order the titles appear on disc,
+  and passes each track's PCM frames to the sink's callbacks
+
+  this avoids seeking between tracks,
+  which is much faster on optical drives with slow random access
+
+  each track's PCM frames are split from the title's stream as by
+  dvda_open_title_reader(), so a track starting partway through a sector
+  omits the packets before its start which its own track reader includes
+
+  flags are a set of dvda_reader_flags_t
+  as for dvda_open_track_reader_ex()
+
+  returns 0 on success, -1 if the title set's AOBs can't be opened
+  or the first nonzero value returned by one of the sink's callbacks*/
+int
+dvda_read_titleset(DVDA_Titleset* titleset,
+                   unsigned flags,
+                   const dvda_track_sink_t* sink,
+                   void* sink_data);
+
+/*returns the number of the track, starting from 1,
+  whose PCM frames were most recently returned by dvda_read()
+  or the first track if none have been returned yet
+
+  this is always the track's own number
+  for readers opened with dvda_open_track_reader()*/
+unsigned
+dvda_reader_track_number(const DVDA_Track_Reader* reader);
+
 /*returns the track's codec, such as PCM or MLP*/
 dvda_codec_t
 dvda_codec(const DVDA_Track_Reader* reader);
@@ -194,8 +332,55 @@ dvda_riff_wave_channel_mask(const DVDA_Track_Reader *reader);
 
   returns the number of PCM frames actually read
   which may be less than requested at the end of the stream
+  or, for readers opened with dvda_open_title_reader(),
+  at the end of each track
 */
 unsigned
 dvda_read(DVDA_Track_Reader* reader,
           unsigned pcm_frames,
           int buffer[]);
+
+/*cumulative counts of the work a reader has done since it was opened,
+  for attributing slow reads to disc I/O, decryption or decoding*/
+typedef struct {
+    /*sectors read from the AOB files,
+      not counting sectors re-read from memory after a short seek*/
+    uint64_t sectors_read;
+
+    /*bytes of those sectors decrypted with CPPM*/
+    uint64_t bytes_decrypted;
+
+    /*packets pulled apart from sectors
+      and how many of those weren't audio packets and were skipped*/
+    uint64_t packets_demuxed;
+    uint64_t packets_skipped;
+
+    /*MLP frames and blocks decoded, the latter across all substreams,
+      and the restart headers read from those blocks*/
+    uint64_t mlp_frames;
+    uint64_t mlp_blocks;
+    uint64_t mlp_restart_headers;
+
+    /*MLP substreams failing their parity or CRC-8 checks*/
+    uint64_t mlp_check_failures;
+
+    /*bytes of MLP data searched for a major sync
+      to find where the stream and each of its tracks begin*/
+    uint64_t sync_bytes_scanned;
+
+    /*nanoseconds spent reading sectors, decrypting them,
+      pulling them apart into packets and decoding those packets
+
+      these are the time spent on the reader's own thread,
+      so when MLP is decoded by DVDA_PARALLEL_DECODE's worker threads
+      decode_ns is the time spent waiting on them*/
+    uint64_t read_ns;
+    uint64_t decrypt_ns;
+    uint64_t demux_ns;
+    uint64_t decode_ns;
+} dvda_reader_stats_t;
+
+/*populates stats with the reader's counts so far*/
+void
+dvda_reader_stats(const DVDA_Track_Reader* reader,
+                  dvda_reader_stats_t* stats);
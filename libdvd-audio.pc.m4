@@ -4,5 +4,5 @@ includedir=INCLUDE_DIR
 Name: libdvd-audio
 Description: DVD-Audio extraction library
 Version: MAJOR_VERSION.MINOR_VERSION.RELEASE_VERSION
-Libs: -L${libdir} -ldvd-audio -lm
+Libs: -L${libdir} -ldvd-audio -lm -lpthread
 CFlags: -I${includedir}
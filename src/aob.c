@@ -26,8 +26,21 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include "cppm/cppm.h"
+#include "clock.h"
+#include "probes.h"
+#ifdef HAS_CPPM
+#include <pthread.h>
+#endif
 
 #define SECTOR_SIZE 2048
+#define HISTORY_SECTORS 64
+
+#ifdef HAS_CPPM
+/*a drive's authentication handshake is a sequence of ioctls
+  that mustn't interleave with another's,
+  so readers opened on separate threads take turns*/
+static pthread_mutex_t cppm_init_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 struct AOB {
     FILE *file;
@@ -44,6 +57,22 @@ struct AOB_Reader_s {
     struct cppm_decoder cppm_decoder;
     int perform_decoding;
 #endif
+
+    /*the most recently read sectors, after any decryption,
+      so that seeking back a short way doesn't read the disc again
+
+      sectors "history_end - history_count" to "history_end - 1"
+      are held at index "sector % HISTORY_SECTORS"
+      and history_end is the disc's sector once they're re-read*/
+    uint8_t history[HISTORY_SECTORS][SECTOR_SIZE];
+    unsigned history_count;
+    unsigned history_end;
+
+    /*the sector to be read next,
+      which is behind history_end while re-reading sectors*/
+    unsigned position;
+
+    struct aob_reader_stats stats;
 };
 
 /*******************************************************************
@@ -83,6 +112,10 @@ aob_current(AOB_Reader *reader)
     return &(reader->AOB[reader->current_aob]);
 }
 
+/*returns the sector number the AOB files are at*/
+static unsigned
+aob_reader_disc_tell(AOB_Reader *reader);
+
 /*******************************************************************
  *                  public function implementations                *
  *******************************************************************/
@@ -96,6 +129,10 @@ aob_reader_open(const char *audio_ts_path,
     AOB_Reader *reader = malloc(sizeof(AOB_Reader));
     reader->total_aobs = 0;
     reader->current_aob = 0;
+    reader->history_count = 0;
+    reader->history_end = 0;
+    reader->position = 0;
+    memset(&reader->stats, 0, sizeof(struct aob_reader_stats));
 
     /*open all the individual .AOB files*/
     for (aob_number = 1; aob_number <= 9; aob_number++) {
@@ -128,10 +165,12 @@ aob_reader_open(const char *audio_ts_path,
     if (cdrom_device) {
         char *mkb_path = find_audio_ts_file(audio_ts_path, "DVDAUDIO.MKB");
         if (mkb_path) {
+            pthread_mutex_lock(&cppm_init_lock);
             reader->perform_decoding =
                 (cppm_init(&reader->cppm_decoder,
                            cdrom_device,
                            mkb_path) >= 0);
+            pthread_mutex_unlock(&cppm_init_lock);
             free(mkb_path);
         } else {
             reader->perform_decoding = 0;
@@ -157,21 +196,67 @@ aob_reader_close(AOB_Reader *reader)
 int
 aob_reader_read(AOB_Reader *reader, uint8_t *sector_data)
 {
+    if (reader->position < reader->history_end) {
+        /*re-read a sector from history*/
+        memcpy(sector_data,
+               reader->history[reader->position % HISTORY_SECTORS],
+               SECTOR_SIZE);
+        reader->position += 1;
+        return 0;
+    }
+
     if (reader->current_aob < reader->total_aobs) {
-        if (aob_read_sector(aob_current(reader), sector_data)) {
+        uint64_t read_start;
+        int read_error;
+
+        DVDA_PROBE1(sector__read__start, reader->position);
+        read_start = dvda_clock_ns();
+        read_error = aob_read_sector(aob_current(reader), sector_data);
+        reader->stats.read_ns += dvda_clock_ns() - read_start;
+        DVDA_PROBE2(sector__read__done, reader->position, read_error);
+
+        if (read_error) {
             /*error reading sector in current AOB, so try next*/
             reader->current_aob++;
             return aob_reader_read(reader, sector_data);
         } else {
             /*sector read OK*/
+            const unsigned sector = aob_reader_disc_tell(reader) - 1;
+
+            reader->stats.sectors_read += 1;
 
 #ifdef HAS_CPPM
             if (reader->perform_decoding) {
-                cppm_decrypt_block(&reader->cppm_decoder, sector_data, 1);
+                uint64_t decrypt_start;
+                int encrypted;
+
+                DVDA_PROBE1(decrypt__start, sector);
+                decrypt_start = dvda_clock_ns();
+                encrypted = cppm_decrypt_block(&reader->cppm_decoder,
+                                               sector_data,
+                                               1);
+                reader->stats.decrypt_ns += dvda_clock_ns() - decrypt_start;
+                DVDA_PROBE2(decrypt__done, sector, encrypted);
+
+                if (encrypted) {
+                    reader->stats.bytes_decrypted += SECTOR_SIZE;
+                }
             }
 #endif
 
-        return 0;
+            /*add sector to history*/
+            if (sector != reader->history_end) {
+                reader->history_count = 0;
+            }
+            memcpy(reader->history[sector % HISTORY_SECTORS],
+                   sector_data,
+                   SECTOR_SIZE);
+            if (reader->history_count < HISTORY_SECTORS) {
+                reader->history_count += 1;
+            }
+            reader->history_end = reader->position = sector + 1;
+
+            return 0;
         }
     } else {
         return 1;
@@ -183,12 +268,25 @@ aob_reader_seek(AOB_Reader *reader, unsigned sector_number)
 {
     unsigned current_aob;
 
+    if ((sector_number <= reader->history_end) &&
+        (sector_number >= (reader->history_end - reader->history_count))) {
+        /*sector is either in history, so re-read it from there,
+          or is the next one to be read from disc*/
+        reader->position = sector_number;
+        return 0;
+    }
+
     for (current_aob = 0; current_aob < reader->total_aobs; current_aob++) {
         const unsigned aob_sectors =
             reader->AOB[current_aob].total_sectors;
         if (sector_number < aob_sectors) {
             reader->current_aob = current_aob;
             aob_seek_sector(aob_current(reader), sector_number);
+
+            /*history continues from the new position*/
+            reader->history_count = 0;
+            reader->history_end = reader->position =
+                aob_reader_disc_tell(reader);
             return 0;
         } else {
             sector_number -= aob_sectors;
@@ -200,6 +298,22 @@ aob_reader_seek(AOB_Reader *reader, unsigned sector_number)
 
 unsigned
 aob_reader_tell(AOB_Reader *reader)
+{
+    return reader->position;
+}
+
+const struct aob_reader_stats*
+aob_reader_stats(const AOB_Reader *reader)
+{
+    return &reader->stats;
+}
+
+/*******************************************************************
+ *                  private function implementations               *
+ *******************************************************************/
+
+static unsigned
+aob_reader_disc_tell(AOB_Reader *reader)
 {
     unsigned i;
     unsigned current_sector = 0;
@@ -212,9 +326,6 @@ aob_reader_tell(AOB_Reader *reader)
     return current_sector;
 }
 
-/*******************************************************************
- *                  private function implementations               *
- *******************************************************************/
 static int
 aob_open(const char *aob_path, struct AOB *aob)
 {
@@ -26,6 +26,15 @@ struct AOB_Reader_s;
 
 typedef struct AOB_Reader_s AOB_Reader;
 
+/*cumulative counts of an AOB reader's work since it was opened*/
+struct aob_reader_stats {
+    uint64_t sectors_read;     /*sectors read from the AOB files,
+                                 not counting re-reads from history*/
+    uint64_t bytes_decrypted;  /*bytes of those sectors CPPM-decrypted*/
+    uint64_t read_ns;          /*time spent reading sectors*/
+    uint64_t decrypt_ns;       /*time spent decrypting sectors*/
+};
+
 /*given a full path to an AUDIO_TS directory
   cdrom device (or NULL)
   and title set number (starting from 1),
@@ -46,7 +55,10 @@ int
 aob_reader_read(AOB_Reader *reader, uint8_t *sector_data);
 
 /*seeks to the given sector number
-  and returns 0 on success, 1 on failure*/
+  and returns 0 on success, 1 on failure
+
+  seeking back to one of the most recently read sectors
+  re-reads them from memory rather than from disc*/
 int
 aob_reader_seek(AOB_Reader *reader, unsigned sector_number);
 
@@ -54,4 +66,8 @@ aob_reader_seek(AOB_Reader *reader, unsigned sector_number);
 unsigned
 aob_reader_tell(AOB_Reader *reader);
 
+/*returns the reader's counts so far*/
+const struct aob_reader_stats*
+aob_reader_stats(const AOB_Reader *reader);
+
 #endif
@@ -82,6 +82,10 @@ DEF_READ_BITS(br_read_bits_b_be, unsigned int)
 DEF_READ_BITS(br_read_bits_b_le, unsigned int)
 DEF_READ_BITS(br_read_bits_q_be, unsigned int)
 DEF_READ_BITS(br_read_bits_q_le, unsigned int)
+DEF_READ_BITS(br_read_bits_bw_be, unsigned int)
+DEF_READ_BITS(br_read_bits_bw_le, unsigned int)
+DEF_READ_BITS(br_read_bits_qw_be, unsigned int)
+DEF_READ_BITS(br_read_bits_qw_le, unsigned int)
 DEF_READ_BITS(br_read_bits_e_be, unsigned int)
 DEF_READ_BITS(br_read_bits_e_le, unsigned int)
 DEF_READ_BITS(br_read_bits_c, unsigned int)
@@ -93,6 +97,10 @@ DEF_READ_BITS(br_read_bits64_b_be, uint64_t)
 DEF_READ_BITS(br_read_bits64_b_le, uint64_t)
 DEF_READ_BITS(br_read_bits64_q_be, uint64_t)
 DEF_READ_BITS(br_read_bits64_q_le, uint64_t)
+DEF_READ_BITS(br_read_bits64_bw_be, uint64_t)
+DEF_READ_BITS(br_read_bits64_bw_le, uint64_t)
+DEF_READ_BITS(br_read_bits64_qw_be, uint64_t)
+DEF_READ_BITS(br_read_bits64_qw_le, uint64_t)
 DEF_READ_BITS(br_read_bits64_e_be, uint64_t)
 DEF_READ_BITS(br_read_bits64_e_le, uint64_t)
 DEF_READ_BITS(br_read_bits64_c, uint64_t)
@@ -127,6 +135,10 @@ DEF_SKIP(br_skip_bits_b_be)
 DEF_SKIP(br_skip_bits_b_le)
 DEF_SKIP(br_skip_bits_q_be)
 DEF_SKIP(br_skip_bits_q_le)
+DEF_SKIP(br_skip_bits_bw_be)
+DEF_SKIP(br_skip_bits_bw_le)
+DEF_SKIP(br_skip_bits_qw_be)
+DEF_SKIP(br_skip_bits_qw_le)
 DEF_SKIP(br_skip_bits_e_be)
 DEF_SKIP(br_skip_bits_e_le)
 DEF_SKIP(br_skip_bits_c)
@@ -207,6 +219,18 @@ br_skip_bytes(BitstreamReader* self, unsigned int count);
 static void
 br_parse(BitstreamReader* self, const char* format, ...);
 
+static void
+br_parse_compiled(BitstreamReader* self, const bs_format_t* format, ...);
+
+/*performs a single format instruction "times" times,
+  taking the values' pointers from "ap"*/
+static inline void
+br_parse_inst(BitstreamReader* self,
+              bs_instruction_t inst,
+              unsigned times,
+              unsigned size,
+              va_list* ap);
+
 
 static int
 br_byte_aligned(const BitstreamReader* self);
@@ -407,6 +431,18 @@ DEF_WRITE_BYTES(bw_write_bytes_c)
 static void
 bw_build(BitstreamWriter* self, const char* format, ...);
 
+static void
+bw_build_compiled(BitstreamWriter* self, const bs_format_t* format, ...);
+
+/*performs a single format instruction "times" times,
+  taking the values from "ap"*/
+static inline void
+bw_build_inst(BitstreamWriter* self,
+              bs_instruction_t inst,
+              unsigned times,
+              unsigned size,
+              va_list* ap);
+
 
 static int
 bw_byte_aligned(const BitstreamWriter* self);
@@ -826,6 +862,7 @@ __base_bitstreamreader__(bs_endianness endianness)
     /*bs->read_bytes = ???*/
     bs->skip_bytes = br_skip_bytes;
     bs->parse = br_parse;
+    bs->parse_compiled = br_parse_compiled;
     bs->byte_aligned = br_byte_aligned;
     bs->byte_align = br_byte_align;
 
@@ -906,18 +943,18 @@ br_open_buffer(const uint8_t *buffer,
 
     switch (endianness) {
     case BS_BIG_ENDIAN:
-        bs->read = br_read_bits_b_be;
-        bs->read_64 = br_read_bits64_b_be;
+        bs->read = br_read_bits_bw_be;
+        bs->read_64 = br_read_bits64_bw_be;
         bs->read_bigint = br_read_bits_bigint_b_be;
-        bs->skip = br_skip_bits_b_be;
+        bs->skip = br_skip_bits_bw_be;
         bs->read_unary = br_read_unary_b_be;
         bs->skip_unary = br_skip_unary_b_be;
         break;
     case BS_LITTLE_ENDIAN:
-        bs->read = br_read_bits_b_le;
-        bs->read_64 = br_read_bits64_b_le;
+        bs->read = br_read_bits_bw_le;
+        bs->read_64 = br_read_bits64_bw_le;
         bs->read_bigint = br_read_bits_bigint_b_le;
-        bs->skip = br_skip_bits_b_le;
+        bs->skip = br_skip_bits_bw_le;
         bs->read_unary = br_read_unary_b_le;
         bs->skip_unary = br_skip_unary_b_le;
         break;
@@ -954,25 +991,25 @@ br_open_queue(bs_endianness endianness)
 
     switch (endianness) {
     case BS_BIG_ENDIAN:
-        bs->read = br_read_bits_q_be;
+        bs->read = br_read_bits_qw_be;
         bs->read_signed = br_read_signed_bits_be;
-        bs->read_64 = br_read_bits64_q_be;
+        bs->read_64 = br_read_bits64_qw_be;
         bs->read_signed_64 = br_read_signed_bits64_be;
         bs->read_bigint = br_read_bits_bigint_q_be;
         bs->read_signed_bigint = br_read_signed_bits_bigint_be;
-        bs->skip = br_skip_bits_q_be;
+        bs->skip = br_skip_bits_qw_be;
         bs->unread = br_unread_bit_be;
         bs->read_unary = br_read_unary_q_be;
         bs->skip_unary = br_skip_unary_q_be;
         break;
     case BS_LITTLE_ENDIAN:
-        bs->read = br_read_bits_q_le;
+        bs->read = br_read_bits_qw_le;
         bs->read_signed = br_read_signed_bits_le;
-        bs->read_64 = br_read_bits64_q_le;
+        bs->read_64 = br_read_bits64_qw_le;
         bs->read_signed_64 = br_read_signed_bits64_le;
         bs->read_bigint = br_read_bits_bigint_q_le;
         bs->read_signed_bigint = br_read_signed_bits_bigint_le;
-        bs->skip = br_skip_bits_q_le;
+        bs->skip = br_skip_bits_qw_le;
         bs->unread = br_unread_bit_le;
         bs->read_unary = br_read_unary_q_le;
         bs->skip_unary = br_skip_unary_q_le;
@@ -984,6 +1021,7 @@ br_open_queue(bs_endianness endianness)
     bs->read_bytes = br_read_bytes_q;
     bs->skip_bytes = br_skip_bytes;
     bs->parse = br_parse;
+    bs->parse_compiled = br_parse_compiled;
     bs->byte_aligned = br_byte_aligned;
     bs->byte_align = br_byte_align;
 
@@ -1450,7 +1488,7 @@ br_read_signed_bits_bigint_le(BitstreamReader* self,
           while (count > 0) {                                   \
               const unsigned int byte_count = MIN(BUFFER_SIZE,  \
                                                   count);       \
-              static uint8_t dummy[BUFFER_SIZE];                \
+              uint8_t dummy[BUFFER_SIZE];                       \
               self->read_bytes(self, dummy, byte_count);        \
               count -= byte_count;                              \
           }                                                     \
@@ -1495,7 +1533,7 @@ FUNC_SKIP_BITS_BE(br_skip_bits_e_be, ext_getc, self->input.external)
           while (count > 0) {                                  \
               const unsigned int byte_count = MIN(BUFFER_SIZE, \
                                                   count);      \
-              static uint8_t dummy[BUFFER_SIZE];               \
+              uint8_t dummy[BUFFER_SIZE];                      \
               self->read_bytes(self, dummy, byte_count);       \
               count -= byte_count;                             \
           }                                                    \
@@ -1679,6 +1717,229 @@ br_skip_unary_c(BitstreamReader* self, int stop_bit)
 }
 
 
+/*******************************************************************
+ *                  word-at-a-time buffer and queue                *
+ *******************************************************************/
+
+/*buffer and queue readers hold all their data in memory,
+  so rather than feeding it through the state tables a byte at a time
+  these read and skip functions pull up to 8 bytes at once
+  into a 64-bit word and shift the bits out of it directly
+  (read_unary stays table-driven, since the table already
+  finds the short values it is used for in a single lookup)
+
+  the reader's state still holds the 0 to 8 bits
+  left over from a partially consumed byte, exactly as
+  the table-driven functions would leave them,
+  so the two can be mixed freely with every other method
+
+  should the reader have callbacks to be called on each byte,
+  or there not be enough data remaining,
+  they fall back to the table-driven functions
+  which call callbacks and raise errors at the same point as always*/
+
+/*reads of more bits than this beyond those in the current state
+  go through the table-driven functions*/
+#define WORD_READ_BITS 56
+
+#ifdef __GNUC__
+#define CLZ64(x) ((unsigned)__builtin_clzll(x))
+#else
+static inline unsigned
+CLZ64(uint64_t x)
+{
+    unsigned zeroes = 0;
+    for (; !(x & ((uint64_t)1 << 63)); x <<= 1) {
+        zeroes++;
+    }
+    return zeroes;
+}
+#endif
+
+/*returns the number of bits held by a reader's state*/
+static inline unsigned
+state_size(state_t state)
+{
+    return (state > 1) ? (63 - CLZ64(state)) : 0;
+}
+
+/*returns a state holding the "size" bits of "value"*/
+static inline state_t
+pack_state(unsigned size, unsigned value)
+{
+    return size ? (state_t)((1 << size) | (value & ((1 << size) - 1))) : 0;
+}
+
+/*returns up to 8 of the "size" bytes at "data"
+  as the most-significant bytes of a word, with any missing bytes as 0*/
+static inline uint64_t
+load_word_be(const uint8_t* data, unsigned size)
+{
+    if (size >= 8) {
+        return ((uint64_t)data[0] << 56) | ((uint64_t)data[1] << 48) |
+               ((uint64_t)data[2] << 40) | ((uint64_t)data[3] << 32) |
+               ((uint64_t)data[4] << 24) | ((uint64_t)data[5] << 16) |
+               ((uint64_t)data[6] << 8)  |  (uint64_t)data[7];
+    } else {
+        uint64_t word = 0;
+        unsigned i;
+        for (i = 0; i < size; i++) {
+            word |= (uint64_t)data[i] << (56 - (i * 8));
+        }
+        return word;
+    }
+}
+
+/*returns up to 8 of the "size" bytes at "data"
+  as the least-significant bytes of a word, with any missing bytes as 0*/
+static inline uint64_t
+load_word_le(const uint8_t* data, unsigned size)
+{
+    if (size >= 8) {
+        return  (uint64_t)data[0]        | ((uint64_t)data[1] << 8)  |
+               ((uint64_t)data[2] << 16) | ((uint64_t)data[3] << 24) |
+               ((uint64_t)data[4] << 32) | ((uint64_t)data[5] << 40) |
+               ((uint64_t)data[6] << 48) | ((uint64_t)data[7] << 56);
+    } else {
+        uint64_t word = 0;
+        unsigned i;
+        for (i = 0; i < size; i++) {
+            word |= (uint64_t)data[i] << (i * 8);
+        }
+        return word;
+    }
+}
+
+#define FUNC_READ_BITS_WORD_BE(FUNC_NAME, RETURN_TYPE, INPUT, FALLBACK) \
+    static RETURN_TYPE                                                  \
+    FUNC_NAME(BitstreamReader* self, unsigned int count)                \
+    {                                                                   \
+        const unsigned held = state_size(self->state);                  \
+        const unsigned value = self->state & ((1 << held) - 1);         \
+                                                                        \
+        if (count <= held) {                                            \
+            /*the most-significant held bits are next*/                 \
+            self->state = pack_state(held - count, value);              \
+            return (RETURN_TYPE)(value >> (held - count));              \
+        } else if (((count - held) <= WORD_READ_BITS) &&                \
+                   (self->callbacks == NULL)) {                         \
+            const unsigned needed = count - held;                       \
+            const unsigned bytes = (needed + 7) / 8;                    \
+            const unsigned available = INPUT->size - INPUT->pos;        \
+                                                                        \
+            if (bytes <= available) {                                   \
+                const uint64_t word =                                   \
+                    load_word_be(INPUT->data + INPUT->pos, available);  \
+                const unsigned left = (bytes * 8) - needed;             \
+                                                                        \
+                INPUT->pos += bytes;                                    \
+                self->state = pack_state(                               \
+                    left, (unsigned)(word >> (64 - (bytes * 8))));      \
+                return (RETURN_TYPE)(((uint64_t)value << needed) |      \
+                                     (word >> (64 - needed)));          \
+            }                                                           \
+        }                                                               \
+                                                                        \
+        return FALLBACK(self, count);                                   \
+    }
+FUNC_READ_BITS_WORD_BE(br_read_bits_bw_be,
+                       unsigned int, self->input.buffer, br_read_bits_b_be)
+FUNC_READ_BITS_WORD_BE(br_read_bits_qw_be,
+                       unsigned int, self->input.queue, br_read_bits_q_be)
+FUNC_READ_BITS_WORD_BE(br_read_bits64_bw_be,
+                       uint64_t, self->input.buffer, br_read_bits64_b_be)
+FUNC_READ_BITS_WORD_BE(br_read_bits64_qw_be,
+                       uint64_t, self->input.queue, br_read_bits64_q_be)
+
+#define FUNC_READ_BITS_WORD_LE(FUNC_NAME, RETURN_TYPE, INPUT, FALLBACK) \
+    static RETURN_TYPE                                                  \
+    FUNC_NAME(BitstreamReader* self, unsigned int count)                \
+    {                                                                   \
+        const unsigned held = state_size(self->state);                  \
+        const unsigned value = self->state & ((1 << held) - 1);         \
+                                                                        \
+        if (count <= held) {                                            \
+            /*the least-significant held bits are next*/                \
+            self->state = pack_state(held - count, value >> count);     \
+            return (RETURN_TYPE)(value & ((1 << count) - 1));           \
+        } else if (((count - held) <= WORD_READ_BITS) &&                \
+                   (self->callbacks == NULL)) {                         \
+            const unsigned needed = count - held;                       \
+            const unsigned bytes = (needed + 7) / 8;                    \
+            const unsigned available = INPUT->size - INPUT->pos;        \
+                                                                        \
+            if (bytes <= available) {                                   \
+                const uint64_t word =                                   \
+                    load_word_le(INPUT->data + INPUT->pos, available);  \
+                const unsigned left = (bytes * 8) - needed;             \
+                                                                        \
+                INPUT->pos += bytes;                                    \
+                self->state = pack_state(                               \
+                    left, (unsigned)(word >> needed));                  \
+                return (RETURN_TYPE)(value |                            \
+                                     ((word &                           \
+                                       (((uint64_t)1 << needed) - 1))   \
+                                      << held));                        \
+            }                                                           \
+        }                                                               \
+                                                                        \
+        return FALLBACK(self, count);                                   \
+    }
+FUNC_READ_BITS_WORD_LE(br_read_bits_bw_le,
+                       unsigned int, self->input.buffer, br_read_bits_b_le)
+FUNC_READ_BITS_WORD_LE(br_read_bits_qw_le,
+                       unsigned int, self->input.queue, br_read_bits_q_le)
+FUNC_READ_BITS_WORD_LE(br_read_bits64_bw_le,
+                       uint64_t, self->input.buffer, br_read_bits64_b_le)
+FUNC_READ_BITS_WORD_LE(br_read_bits64_qw_le,
+                       uint64_t, self->input.queue, br_read_bits64_q_le)
+
+/*skips any number of whole bytes by moving the position
+  and reads the partial byte at the end, if any, to the state*/
+#define FUNC_SKIP_BITS_WORD(FUNC_NAME, INPUT, FALLBACK, BIG_ENDIAN)     \
+    static void                                                         \
+    FUNC_NAME(BitstreamReader* self, unsigned int count)                \
+    {                                                                   \
+        const unsigned held = state_size(self->state);                  \
+        const unsigned value = self->state & ((1 << held) - 1);         \
+                                                                        \
+        if (count <= held) {                                            \
+            self->state = pack_state(held - count,                      \
+                                     BIG_ENDIAN ? value :               \
+                                     (value >> count));                 \
+            return;                                                     \
+        } else if (self->callbacks == NULL) {                           \
+            const unsigned needed = count - held;                       \
+            const unsigned bytes = needed / 8;                          \
+            const unsigned bits = needed % 8;                           \
+            const unsigned available = INPUT->size - INPUT->pos;        \
+                                                                        \
+            if ((bytes < available) ||                                  \
+                ((bytes == available) && (bits == 0))) {                \
+                INPUT->pos += bytes;                                    \
+                if (bits) {                                             \
+                    const unsigned byte = INPUT->data[INPUT->pos++];    \
+                    self->state = pack_state(8 - bits,                  \
+                                             BIG_ENDIAN ? byte :        \
+                                             (byte >> bits));           \
+                } else {                                                \
+                    self->state = 0;                                    \
+                }                                                       \
+                return;                                                 \
+            }                                                           \
+        }                                                               \
+                                                                        \
+        FALLBACK(self, count);                                          \
+    }
+FUNC_SKIP_BITS_WORD(br_skip_bits_bw_be,
+                    self->input.buffer, br_skip_bits_b_be, 1)
+FUNC_SKIP_BITS_WORD(br_skip_bits_bw_le,
+                    self->input.buffer, br_skip_bits_b_le, 0)
+FUNC_SKIP_BITS_WORD(br_skip_bits_qw_be,
+                    self->input.queue, br_skip_bits_q_be, 1)
+FUNC_SKIP_BITS_WORD(br_skip_bits_qw_le,
+                    self->input.queue, br_skip_bits_q_le, 0)
+
 static void
 __br_set_endianness__(BitstreamReader* self, bs_endianness endianness)
 {
@@ -1730,18 +1991,18 @@ br_set_endianness_b(BitstreamReader* self, bs_endianness endianness)
     __br_set_endianness__(self, endianness);
     switch (endianness) {
     case BS_LITTLE_ENDIAN:
-        self->read = br_read_bits_b_le;
-        self->read_64 = br_read_bits64_b_le;
+        self->read = br_read_bits_bw_le;
+        self->read_64 = br_read_bits64_bw_le;
         self->read_bigint = br_read_bits_bigint_b_le;
-        self->skip = br_skip_bits_b_le;
+        self->skip = br_skip_bits_bw_le;
         self->read_unary = br_read_unary_b_le;
         self->skip_unary = br_skip_unary_b_le;
         break;
     case BS_BIG_ENDIAN:
-        self->read = br_read_bits_b_be;
-        self->read_64 = br_read_bits64_b_be;
+        self->read = br_read_bits_bw_be;
+        self->read_64 = br_read_bits64_bw_be;
         self->read_bigint = br_read_bits_bigint_b_be;
-        self->skip = br_skip_bits_b_be;
+        self->skip = br_skip_bits_bw_be;
         self->read_unary = br_read_unary_b_be;
         self->skip_unary = br_skip_unary_b_be;
         break;
@@ -1754,18 +2015,18 @@ br_set_endianness_q(BitstreamReader* self, bs_endianness endianness)
     __br_set_endianness__(self, endianness);
     switch (endianness) {
     case BS_LITTLE_ENDIAN:
-        self->read = br_read_bits_q_le;
-        self->read_64 = br_read_bits64_q_le;
+        self->read = br_read_bits_qw_le;
+        self->read_64 = br_read_bits64_qw_le;
         self->read_bigint = br_read_bits_bigint_q_le;
-        self->skip = br_skip_bits_q_le;
+        self->skip = br_skip_bits_qw_le;
         self->read_unary = br_read_unary_q_le;
         self->skip_unary = br_skip_unary_q_le;
         break;
     case BS_BIG_ENDIAN:
-        self->read = br_read_bits_q_be;
-        self->read_64 = br_read_bits64_q_be;
+        self->read = br_read_bits_qw_be;
+        self->read_64 = br_read_bits64_qw_be;
         self->read_bigint = br_read_bits_bigint_q_be;
-        self->skip = br_skip_bits_q_be;
+        self->skip = br_skip_bits_qw_be;
         self->read_unary = br_read_unary_q_be;
         self->skip_unary = br_skip_unary_q_be;
         break;
@@ -1933,7 +2194,7 @@ br_skip_bytes(BitstreamReader* self, unsigned int count)
     /*try to generate large, byte-aligned chunks of bit skips*/
     while (count > 0) {
         const unsigned int byte_count = MIN(BUFFER_SIZE, count);
-        static uint8_t dummy[BUFFER_SIZE];
+        uint8_t dummy[BUFFER_SIZE];
         self->read_bytes(self, dummy, byte_count);
         count -= byte_count;
     }
@@ -1943,17 +2204,6 @@ br_skip_bytes(BitstreamReader* self, unsigned int count)
 static void
 br_parse(BitstreamReader* self, const char* format, ...)
 {
-    /*cache function pointers for reuse*/
-    br_read_f read = self->read;
-    br_read_signed_f read_signed = self->read_signed;
-    br_read_64_f read_64 = self->read_64;
-    br_read_signed_64_f read_signed_64 = self->read_signed_64;
-    br_read_bigint_f read_bigint = self->read_bigint;
-    br_read_signed_bigint_f read_signed_bigint = self->read_signed_bigint;
-    br_skip_f skip = self->skip;
-    br_skip_bytes_f skip_bytes = self->skip_bytes;
-    br_read_bytes_f read_bytes = self->read_bytes;
-
     va_list ap;
     bs_instruction_t inst;
 
@@ -1963,70 +2213,94 @@ br_parse(BitstreamReader* self, const char* format, ...)
         unsigned size;
 
         format = bs_parse_format(format, &times, &size, &inst);
-        switch (inst) {
-        case BS_INST_UNSIGNED:
-            for (; times; times--) {
-                unsigned *value = va_arg(ap, unsigned*);
-                *value = read(self, size);
-            }
-            break;
-        case BS_INST_SIGNED:
-            for (; times; times--) {
-                int *value = va_arg(ap, int*);
-                *value = read_signed(self, size);
-            }
-            break;
-        case BS_INST_UNSIGNED64:
-            for (; times; times--) {
-                uint64_t *value = va_arg(ap, uint64_t*);
-                *value = read_64(self, size);
-            }
-            break;
-        case BS_INST_SIGNED64:
-            for (; times; times--) {
-                int64_t *value = va_arg(ap, int64_t*);
-                *value = read_signed_64(self, size);
-            }
-            break;
-        case BS_INST_UNSIGNED_BIGINT:
-            for (; times; times--) {
-                mpz_t *value = va_arg(ap, mpz_t*);
-                read_bigint(self, size, *value);
-            }
-            break;
-        case BS_INST_SIGNED_BIGINT:
-            for (; times; times--) {
-                mpz_t *value = va_arg(ap, mpz_t*);
-                read_signed_bigint(self, size, *value);
-            }
-            break;
-        case BS_INST_SKIP:
-            for (; times; times--) {
-                skip(self, size);
-            }
-            break;
-        case BS_INST_SKIP_BYTES:
-            for (; times; times--) {
-                skip_bytes(self, size);
-            }
-            break;
-        case BS_INST_BYTES:
-            for (; times; times--) {
-                uint8_t *value = va_arg(ap, uint8_t*);
-                read_bytes(self, value, size);
-            }
-            break;
-        case BS_INST_ALIGN:
-            self->byte_align(self);
-            break;
-        case BS_INST_EOF:
-            break;
-        }
+        br_parse_inst(self, inst, times, size, &ap);
     } while (inst != BS_INST_EOF);
     va_end(ap);
 }
 
 
+static void
+br_parse_compiled(BitstreamReader* self, const bs_format_t* format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    for (; format->inst != BS_INST_EOF; format++) {
+        br_parse_inst(self, format->inst, format->times, format->size, &ap);
+    }
+    va_end(ap);
+}
+
+
+static inline void
+br_parse_inst(BitstreamReader* self,
+              bs_instruction_t inst,
+              unsigned times,
+              unsigned size,
+              va_list* ap)
+{
+    switch (inst) {
+    case BS_INST_UNSIGNED:
+        for (; times; times--) {
+            unsigned *value = va_arg(*ap, unsigned*);
+            *value = self->read(self, size);
+        }
+        break;
+    case BS_INST_SIGNED:
+        for (; times; times--) {
+            int *value = va_arg(*ap, int*);
+            *value = self->read_signed(self, size);
+        }
+        break;
+    case BS_INST_UNSIGNED64:
+        for (; times; times--) {
+            uint64_t *value = va_arg(*ap, uint64_t*);
+            *value = self->read_64(self, size);
+        }
+        break;
+    case BS_INST_SIGNED64:
+        for (; times; times--) {
+            int64_t *value = va_arg(*ap, int64_t*);
+            *value = self->read_signed_64(self, size);
+        }
+        break;
+    case BS_INST_UNSIGNED_BIGINT:
+        for (; times; times--) {
+            mpz_t *value = va_arg(*ap, mpz_t*);
+            self->read_bigint(self, size, *value);
+        }
+        break;
+    case BS_INST_SIGNED_BIGINT:
+        for (; times; times--) {
+            mpz_t *value = va_arg(*ap, mpz_t*);
+            self->read_signed_bigint(self, size, *value);
+        }
+        break;
+    case BS_INST_SKIP:
+        for (; times; times--) {
+            self->skip(self, size);
+        }
+        break;
+    case BS_INST_SKIP_BYTES:
+        for (; times; times--) {
+            self->skip_bytes(self, size);
+        }
+        break;
+    case BS_INST_BYTES:
+        for (; times; times--) {
+            uint8_t *value = va_arg(*ap, uint8_t*);
+            self->read_bytes(self, value, size);
+        }
+        break;
+    case BS_INST_ALIGN:
+        self->byte_align(self);
+        break;
+    case BS_INST_EOF:
+        break;
+    }
+}
+
+
 static int
 br_byte_aligned(const BitstreamReader* self)
 {
@@ -2557,6 +2831,7 @@ bw_open(FILE *f, bs_endianness endianness)
     bs->write_huffman_code = bw_write_huffman;
     bs->write_bytes = bw_write_bytes_file;
     bs->build = bw_build;
+    bs->build_compiled = bw_build_compiled;
     bs->byte_aligned = bw_byte_aligned;
     bs->byte_align = bw_byte_align;
     bs->flush = bw_flush_f;
@@ -2630,6 +2905,7 @@ bw_open_external(void* user_data,
     bs->write_huffman_code = bw_write_huffman;
     bs->write_bytes = bw_write_bytes_e;
     bs->build = bw_build;
+    bs->build_compiled = bw_build_compiled;
     bs->byte_aligned = bw_byte_aligned;
     bs->byte_align = bw_byte_align;
     bs->flush = bw_flush_e;
@@ -2687,6 +2963,7 @@ bw_open_recorder(bs_endianness endianness)
     bs->write_huffman_code = bw_write_huffman;
     bs->write_bytes = bw_write_bytes_r;
     bs->build = bw_build;
+    bs->build_compiled = bw_build_compiled;
     bs->byte_aligned = bw_byte_aligned;
     bs->byte_align = bw_byte_align;
     bs->flush = bw_flush_r_c;
@@ -3386,15 +3663,6 @@ bw_write_bytes_c(BitstreamWriter* self,
 static void
 bw_build(BitstreamWriter* self, const char* format, ...)
 {
-    /*cache function pointers for reuse*/
-    bw_write_f write = self->write;
-    bw_write_signed_f write_signed = self->write_signed;
-    bw_write_64_f write_64 = self->write_64;
-    bw_write_signed_64_f write_signed_64 = self->write_signed_64;
-    bw_write_bigint_f write_bigint = self->write_bigint;
-    bw_write_signed_bigint_f write_signed_bigint = self->write_signed_bigint;
-    bw_write_bytes_f write_bytes = self->write_bytes;
-
     va_list ap;
     bs_instruction_t inst;
 
@@ -3404,78 +3672,100 @@ bw_build(BitstreamWriter* self, const char* format, ...)
         unsigned size;
 
         format = bs_parse_format(format, &times, &size, &inst);
-        switch (inst) {
-        case BS_INST_UNSIGNED:
-            for (; times; times--) {
-                const unsigned value = va_arg(ap, unsigned);
-                write(self, size, value);
-            }
-            break;
-        case BS_INST_SIGNED:
-            for (; times; times--) {
-                const int value = va_arg(ap, int);
-                write_signed(self, size, value);
-            }
-            break;
-        case BS_INST_UNSIGNED64:
-            for (; times; times--) {
-                const uint64_t value = va_arg(ap, uint64_t);
-                write_64(self, size, value);
-            }
-            break;
-        case BS_INST_SIGNED64:
-            for (; times; times--) {
-                const int64_t value = va_arg(ap, int64_t);
-                write_signed_64(self, size, value);
-            }
-            break;
-        case BS_INST_UNSIGNED_BIGINT:
-            for (; times; times--) {
-                mpz_t *value = va_arg(ap, mpz_t*);
-                write_bigint(self, size, *value);
-            }
-            break;
-        case BS_INST_SIGNED_BIGINT:
-            for (; times; times--) {
-                mpz_t *value = va_arg(ap, mpz_t*);
-                write_signed_bigint(self, size, *value);
-            }
-            break;
-        case BS_INST_SKIP:
-            for (; times; times--) {
-                write(self, size, 0);
-            }
-            break;
-        case BS_INST_SKIP_BYTES:
-            for (; times; times--) {
-                /*somewhat inefficient,
-                  but byte skipping is rare for BitstreamWriters anyway*/
-                write(self, size, 0);
-                write(self, size, 0);
-                write(self, size, 0);
-                write(self, size, 0);
-                write(self, size, 0);
-                write(self, size, 0);
-                write(self, size, 0);
-                write(self, size, 0);
-            }
-            break;
-        case BS_INST_BYTES:
-            for (; times; times--) {
-                const uint8_t *value = va_arg(ap, uint8_t*);
-                write_bytes(self, value, size);
-            }
-            break;
-        case BS_INST_ALIGN:
-            self->byte_align(self);
-            break;
-        case BS_INST_EOF:
-            break;
-        }
+        bw_build_inst(self, inst, times, size, &ap);
     } while (inst != BS_INST_EOF);
     va_end(ap);
 }
 
+static void
+bw_build_compiled(BitstreamWriter* self, const bs_format_t* format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    for (; format->inst != BS_INST_EOF; format++) {
+        bw_build_inst(self, format->inst, format->times, format->size, &ap);
+    }
+    va_end(ap);
+}
+
+static inline void
+bw_build_inst(BitstreamWriter* self,
+              bs_instruction_t inst,
+              unsigned times,
+              unsigned size,
+              va_list* ap)
+{
+    switch (inst) {
+    case BS_INST_UNSIGNED:
+        for (; times; times--) {
+            const unsigned value = va_arg(*ap, unsigned);
+            self->write(self, size, value);
+        }
+        break;
+    case BS_INST_SIGNED:
+        for (; times; times--) {
+            const int value = va_arg(*ap, int);
+            self->write_signed(self, size, value);
+        }
+        break;
+    case BS_INST_UNSIGNED64:
+        for (; times; times--) {
+            const uint64_t value = va_arg(*ap, uint64_t);
+            self->write_64(self, size, value);
+        }
+        break;
+    case BS_INST_SIGNED64:
+        for (; times; times--) {
+            const int64_t value = va_arg(*ap, int64_t);
+            self->write_signed_64(self, size, value);
+        }
+        break;
+    case BS_INST_UNSIGNED_BIGINT:
+        for (; times; times--) {
+            mpz_t *value = va_arg(*ap, mpz_t*);
+            self->write_bigint(self, size, *value);
+        }
+        break;
+    case BS_INST_SIGNED_BIGINT:
+        for (; times; times--) {
+            mpz_t *value = va_arg(*ap, mpz_t*);
+            self->write_signed_bigint(self, size, *value);
+        }
+        break;
+    case BS_INST_SKIP:
+        for (; times; times--) {
+            self->write(self, size, 0);
+        }
+        break;
+    case BS_INST_SKIP_BYTES:
+        for (; times; times--) {
+            /*somewhat inefficient,
+              but byte skipping is rare for BitstreamWriters anyway*/
+            self->write(self, size, 0);
+            self->write(self, size, 0);
+            self->write(self, size, 0);
+            self->write(self, size, 0);
+            self->write(self, size, 0);
+            self->write(self, size, 0);
+            self->write(self, size, 0);
+            self->write(self, size, 0);
+        }
+        break;
+    case BS_INST_BYTES:
+        for (; times; times--) {
+            const uint8_t *value = va_arg(*ap, uint8_t*);
+            self->write_bytes(self, value, size);
+        }
+        break;
+    case BS_INST_ALIGN:
+        self->byte_align(self);
+        break;
+    case BS_INST_EOF:
+        break;
+    }
+}
+
 static int
 bw_byte_aligned(const BitstreamWriter* self)
 {
@@ -3936,6 +4226,24 @@ bs_parse_format(const char *format,
 }
 
 
+bs_format_t*
+bs_compile_format(const char* format)
+{
+    unsigned total = 0;
+    bs_format_t* compiled = NULL;
+
+    do {
+        compiled = realloc(compiled, sizeof(bs_format_t) * (total + 1));
+        format = bs_parse_format(format,
+                                 &(compiled[total].times),
+                                 &(compiled[total].size),
+                                 &(compiled[total].inst));
+    } while (compiled[total++].inst != BS_INST_EOF);
+
+    return compiled;
+}
+
+
 unsigned
 bs_format_size(const char* format)
 {
@@ -4473,6 +4781,10 @@ void
 writer_perform_build_mult(BitstreamWriter* writer,
                           bs_endianness endianness);
 
+void
+writer_perform_build_compiled(BitstreamWriter* writer,
+                              bs_endianness endianness);
+
 void
 writer_perform_huffman(BitstreamWriter* writer,
                        bs_endianness endianness);
@@ -5163,6 +5475,7 @@ void test_big_endian_parse(BitstreamReader* reader) {
     uint8_t sub_data2[2];
     mpz_t B1,B2,B3,B4,B5;
     br_pos_t *pos;
+    bs_format_t *format;
 
     mpz_init(B1);
     mpz_init(B2);
@@ -5263,6 +5576,28 @@ void test_big_endian_parse(BitstreamReader* reader) {
     assert(u5 == 3);
     assert(u6 == 2);
 
+    /*compiled formats should parse the same as their strings*/
+    reader->setpos(reader, pos);
+    format = bs_compile_format("2u 3u 5u 3u 19u");
+    reader->parse_compiled(reader, format, &u1, &u2, &u3, &u4, &u5);
+    free(format);
+    assert(u1 == 0x2);
+    assert(u2 == 0x6);
+    assert(u3 == 0x07);
+    assert(u4 == 0x5);
+    assert(u5 == 0x53BC1);
+
+    reader->setpos(reader, pos);
+    format = bs_compile_format("3* 2* 2u");
+    reader->parse_compiled(reader, format, &u1, &u2, &u3, &u4, &u5, &u6);
+    free(format);
+    assert(u1 == 2);
+    assert(u2 == 3);
+    assert(u3 == 0);
+    assert(u4 == 1);
+    assert(u5 == 3);
+    assert(u6 == 2);
+
     /*then check some errors which trigger an end-of-format*/
 
     /*unknown instruction*/
@@ -5615,6 +5950,7 @@ void test_little_endian_parse(BitstreamReader* reader) {
     uint8_t sub_data2[2];
     mpz_t B1,B2,B3,B4,B5;
     br_pos_t* pos;
+    bs_format_t* format;
 
     mpz_init(B1);
     mpz_init(B2);
@@ -5715,6 +6051,18 @@ void test_little_endian_parse(BitstreamReader* reader) {
     assert(u5 == 1);
     assert(u6 == 3);
 
+    /*compiled formats should parse the same as their strings*/
+    reader->setpos(reader, pos);
+    format = bs_compile_format("3* 2* 2u");
+    reader->parse_compiled(reader, format, &u1, &u2, &u3, &u4, &u5, &u6);
+    free(format);
+    assert(u1 == 1);
+    assert(u2 == 0);
+    assert(u3 == 3);
+    assert(u4 == 2);
+    assert(u5 == 1);
+    assert(u6 == 3);
+
     /*then check some errors which trigger an end-of-format*/
 
     /*unknown instruction*/
@@ -6148,8 +6496,9 @@ test_writer(bs_endianness endianness) {
                             writer_perform_build_K,
                             writer_perform_build_L,
                             writer_perform_build_b,
-                            writer_perform_build_mult};
-    int total_checks = 14;
+                            writer_perform_build_mult,
+                            writer_perform_build_compiled};
+    int total_checks = sizeof(checks) / sizeof(write_check);
 
     align_check achecks_be[] = {{0, 0, 0, 0},
                                 {1, 1, 1, 0x80},
@@ -6978,6 +7327,25 @@ writer_perform_build_mult(BitstreamWriter* writer,
     assert(writer->byte_aligned(writer) == 1);
 }
 
+void
+writer_perform_build_compiled(BitstreamWriter* writer,
+                              bs_endianness endianness)
+{
+    bs_format_t* format = bs_compile_format("2u 3u 5u 3u 19u");
+
+    assert(writer->byte_aligned(writer) == 1);
+    switch (endianness) {
+    case BS_BIG_ENDIAN:
+        writer->build_compiled(writer, format, 2, 6, 7, 5, 342977);
+        break;
+    case BS_LITTLE_ENDIAN:
+        writer->build_compiled(writer, format, 1, 4, 13, 3, 395743);
+        break;
+    }
+    assert(writer->byte_aligned(writer) == 1);
+    free(format);
+}
+
 
 void
 writer_perform_huffman(BitstreamWriter* writer,
@@ -68,6 +68,14 @@ typedef enum {BS_INST_UNSIGNED,
               BS_INST_BYTES,
               BS_INST_ALIGN,
               BS_INST_EOF} bs_instruction_t;
+
+/*a single instruction of a format string compiled by bs_compile_format()
+  a compiled format is an array of these, ending with BS_INST_EOF*/
+typedef struct {
+    bs_instruction_t inst;
+    unsigned times;
+    unsigned size;
+} bs_format_t;
 typedef enum {BS_SEEK_SET=0,
               BS_SEEK_CUR=1,
               BS_SEEK_END=2} bs_whence;
@@ -339,6 +347,13 @@ typedef void
     void                                                                 \
     (*parse)(struct BitstreamReader_s* self, const char* format, ...);   \
                                                                          \
+    /*as parse(), but takes a format from bs_compile_format()*/          \
+    /*so that formats used repeatedly need only be tokenized once*/      \
+                                                                         \
+    void                                                                 \
+    (*parse_compiled)(struct BitstreamReader_s* self,                    \
+                      const bs_format_t* format, ...);                   \
+                                                                         \
     /*returns 1 if the stream is byte-aligned, 0 if not*/                \
     int                                                                  \
     (*byte_aligned)(const struct BitstreamReader_s* self);               \
@@ -496,6 +511,8 @@ typedef struct BitstreamQueue_s {
    where "x" is "f" for raw file, "s" for substream
    or "e" for external functions
    and "yy" is "be" for big endian or "le" for little endian.
+   Buffer and queue readers also have "bw" and "qw" variants
+   of read and skip which work a 64-bit word at a time.
    For example:
 
    | Function          | Input     | Endianness    |
@@ -793,6 +810,11 @@ typedef void
     (*build)(struct BitstreamWriter_s* self,                \
              const char* format, ...);                      \
                                                             \
+    /*as build(), but takes a format from bs_compile_format()*/ \
+    void                                                    \
+    (*build_compiled)(struct BitstreamWriter_s* self,       \
+                      const bs_format_t* format, ...);      \
+                                                            \
     /*returns 1 if the stream is byte-aligned, 0 if not*/   \
     int                                                     \
     (*byte_aligned)(const struct BitstreamWriter_s* self);  \
@@ -1023,6 +1045,13 @@ const char*
 bs_parse_format(const char *format,
                 unsigned *times, unsigned *size, bs_instruction_t *inst);
 
+/*returns the given format string as an array of instructions
+  ending with BS_INST_EOF, for use by parse_compiled() and build_compiled()
+
+  the array must be freed with free() when no longer needed*/
+bs_format_t*
+bs_compile_format(const char* format);
+
 /*returns the size of the given format string in bits*/
 unsigned
 bs_format_size(const char* format);
@@ -0,0 +1,37 @@
+/********************************************************
+ DVD-A Library, a module for reading DVD-Audio discs
+ Copyright (C) 2014-2015  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#ifndef __LIBDVDAUDIO_CLOCK_H__
+#define __LIBDVDAUDIO_CLOCK_H__
+
+#include <stdint.h>
+#include <time.h>
+
+/*returns a monotonic timestamp in nanoseconds,
+  for timing how long the stages of reading a disc take*/
+static inline uint64_t
+dvda_clock_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+#endif
@@ -146,7 +146,7 @@ const static uint32_t sbox_f[256] = {
     0x3FA5C6FA, 0xD5F2B341, 0x71D7E16B, 0xC66A3A87
 };
 
-static device_key_t cppm_device_keys[] =
+static const device_key_t cppm_device_keys[] =
 {
     {0x00, 0x5f58, 0x53e173beec3b8cLL},
 
@@ -350,7 +350,7 @@ c2_dec(uint64_t code, uint64_t key) {
 
 int
 cppm_process_mkb(uint8_t *p_mkb,
-                 device_key_t *p_dev_keys,
+                 const device_key_t *p_dev_keys,
                  int nr_dev_keys,
                  uint64_t *p_media_key) {
     int mkb_pos, length, i, i_dev_key, no_more_keys, no_more_records;
@@ -63,7 +63,7 @@ cppm_get_mkb(const char *psz_mkb);
 
 int
 cppm_process_mkb(uint8_t *p_mkb,
-                 device_key_t *p_dev_keys,
+                 const device_key_t *p_dev_keys,
                  int nr_dev_keys,
                  uint64_t *p_media_key);
 
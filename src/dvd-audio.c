@@ -21,7 +21,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
+#include <unistd.h>
 #include "bitstream.h"
 #include "array.h"
 #include "audio_ts.h"
@@ -30,8 +32,11 @@
 #include "pcm.h"
 #include "mlp.h"
 #include "stream_parameters.h"
+#include "clock.h"
+#include "probes.h"
 
 #define SECTOR_SIZE 2048
+#define TRACK_SINK_FRAMES 4096
 #define PCM_CODEC_ID 0xA0
 #define MLP_CODEC_ID 0xA1
 
@@ -101,6 +106,10 @@ struct DVDA_Title_s {
         struct {
             unsigned first;
             unsigned last;
+
+            /*the last sector of the track's own index,
+              which may also be the first sector of the next track*/
+            unsigned end;
         } sector;
     } tracks[256];
 };
@@ -130,28 +139,106 @@ struct PCM_Track_Reader {
 };
 
 struct MLP_Track_Reader {
-    unsigned last_sector;
+    /*the index of the track whose packets are being read,
+      which may be ahead of the track being returned
+      when MLP is decoded in parallel*/
+    unsigned track;
+
+    /*the stream's parameters and substream count
+      from its first major sync, before any stereo-only adjustment,
+      which each following track must match*/
+    struct stream_parameters parameters;
+    unsigned substream_count;
+
+    /*exactly one of these is used, depending on whether
+      the track is decoded on a single thread or in parallel*/
     MLPDecoder* decoder;
+    MLPParallelDecoder* parallel_decoder;
+
+    /*the number of segments to keep queued for the parallel decoder
+      and whether all the track's packets have been queued*/
+    unsigned segments_ahead;
+    int packets_finished;
+
+    /*the number of segments taken from the parallel decoder so far*/
+    unsigned segments_taken;
+};
+
+/*one of the tracks returned by a reader*/
+struct reader_track {
+    unsigned number;
+    unsigned pts_length;
+    unsigned first_sector;
+    unsigned last_sector;
+
+    /*the last sector in which the track may still have data,
+      past which a title's PCM reader starts the next track*/
+    unsigned end_sector;
+
+    /*the PCM frame of the stream at which the track starts,
+      which is only valid once the decoder has reached it*/
+    uint64_t start;
+
+    /*when MLP is decoded in parallel, the number of segments
+      handed off to the decoder before the track's first*/
+    unsigned segment;
 };
 
 struct DVDA_Track_Reader_s {
     Packet_Reader* packet_reader;
 
+    /*whether the packet reader's AOB reader is closed along with it,
+      which isn't the case when a series of readers share one*/
+    int owns_aob_reader;
+
     dvda_codec_t codec;
 
     int stream_finished;
 
     struct stream_parameters parameters;
 
+    /*the tracks returned by the reader, in stream order,
+      which is just the one unless a whole title is being read
+
+      tracks_started is the number of tracks whose start is known,
+      which the decoder adds to as it reaches each one,
+      and track_read is the index of the track
+      whose PCM frames were last returned by dvda_read()*/
+    struct reader_track* tracks;
+    unsigned track_count;
+    unsigned tracks_started;
+    unsigned track_read;
+
     union {
         struct PCM_Track_Reader pcm;
         struct MLP_Track_Reader mlp;
     } reader;
 
-    aa_int* channel_data;
+    /*a FIFO of decoded samples, interleaved in RIFF WAVE order
+
+      each call to decode() refills it with a single packet's worth
+      of PCM frames once the previous contents have been drained,
+      so its size is bounded by the largest packet in the stream
+      (or the largest segment, when MLP is decoded in parallel)
+
+      channel_data_pos is the index of the first PCM frame
+      not yet returned by dvda_read()
+      and channel_data_start is the PCM frame of the stream
+      at the start of the FIFO*/
+    a_int* channel_data;
+    unsigned channel_data_pos;
+    uint64_t channel_data_start;
+
+    /*the reader's own counts for dvda_reader_stats(),
+      which gathers the rest from its packet reader and decoder
+
+      decode_ns is the time spent in decode()
+      less that spent reading packets*/
+    uint64_t sync_bytes_scanned;
+    uint64_t decode_ns;
 
     unsigned
-    (*decode)(struct DVDA_Track_Reader_s* self, aa_int* samples);
+    (*decode)(struct DVDA_Track_Reader_s* self, a_int* samples);
 
     void
     (*close)(struct DVDA_Track_Reader_s* self);
@@ -208,7 +295,9 @@ parse_ats_XX_0_ifo_title(BitstreamReader* reader,
   audio_packet is all the data in the packet after
   the pad 2 size value once the stream has been probed
 
-  PTS length is the total length of the track from the index
+  tracks are the track_count tracks to be returned, in stream order,
+  which the reader takes ownership of
+  and whose PTS lengths are their total lengths from the index
 
   pad 2 size is pulled from the packet header
 
@@ -217,19 +306,94 @@ parse_ats_XX_0_ifo_title(BitstreamReader* reader,
 static DVDA_Track_Reader*
 open_pcm_track_reader(Packet_Reader* packet_reader,
                       BitstreamReader* audio_packet,
-                      unsigned pts_length,
+                      struct reader_track* tracks,
+                      unsigned track_count,
                       unsigned pad_2_size);
 
 /*samples is a buffer to place decoded samples
 
   returns the aount of PCM frames read*/
 static unsigned
-decode_pcm_audio(DVDA_Track_Reader* self, aa_int* samples);
+decode_pcm_audio(DVDA_Track_Reader* self, a_int* samples);
+
+/*marks the reader's next track as started
+  after the samples decoded so far
+  and sets its PCM frames remaining from its PTS length*/
+static void
+start_next_pcm_track(DVDA_Track_Reader* self, const a_int* samples);
 
 static void
 close_pcm_track_reader(DVDA_Track_Reader *reader);
 
 
+/*given a track's PTS length and the sample rate of its stream
+  returns its length in PCM frames*/
+static uint64_t
+pts_to_pcm_frames(unsigned pts_length, unsigned sample_rate);
+
+/*opens a packet reader at the given sector of the disc's title set
+  and reads the header of its first audio packet
+
+  returns that packet, positioned just after its header,
+  or NULL if an error occurs
+
+  both the packet and packet reader must be closed when no longer needed*/
+static BitstreamReader*
+open_track_audio(const struct disc_path* disc,
+                 unsigned titleset_number,
+                 unsigned first_sector,
+                 Packet_Reader** packet_reader,
+                 unsigned* codec_id,
+                 unsigned* pad_2_size);
+
+/*as open_track_audio() but seeks an AOB reader that's already open,
+  which closing the packet reader with packet_reader_free() leaves open*/
+static BitstreamReader*
+seek_track_audio(AOB_Reader* aob_reader,
+                 unsigned first_sector,
+                 Packet_Reader** packet_reader,
+                 unsigned* codec_id,
+                 unsigned* pad_2_size);
+
+/*closes the reader's packet reader
+  and its AOB reader, if the reader owns it*/
+static void
+close_packet_reader(DVDA_Track_Reader* reader);
+
+/*returns a list of reader tracks holding just the given track*/
+static struct reader_track*
+single_reader_track(const DVDA_Track* track);
+
+/*returns a reader of the title's tracks from first_track
+  (starting from 0) to the end of the title
+  or NULL if an error occurs opening them for reading
+
+  if aob_reader is NULL, the title set's AOBs are opened for the reader,
+  otherwise the reader uses aob_reader and leaves it open when closed*/
+static DVDA_Track_Reader*
+open_title_tracks(const DVDA_Title* title,
+                  unsigned first_track,
+                  AOB_Reader* aob_reader,
+                  unsigned flags);
+
+/*passes the PCM frames of the title's tracks, from first_track onward,
+  to the sink until either the reader ends or the sink returns nonzero
+
+  next_track is updated to the first track not yet passed to the sink
+  and returns 0 on success or the sink's nonzero result*/
+static int
+read_title_tracks(DVDA_Track_Reader* reader,
+                  const DVDA_Title* title,
+                  unsigned first_track,
+                  unsigned* next_track,
+                  const dvda_track_sink_t* sink,
+                  void* sink_data);
+
+/*given a reader and the samples decoded by its current decode() call,
+  marks its next track as starting after them*/
+static void
+start_next_track(DVDA_Track_Reader* self, const a_int* samples);
+
 /******** MLP-based reader and methods ********/
 
 /*packet reader is the stream of additional packets
@@ -237,23 +401,75 @@ close_pcm_track_reader(DVDA_Track_Reader *reader);
   audio_packet is all the data in the packet after
   the pad 2 size value once the stream has been probed
 
-  PTS length is the total length of the track from the index
+  tracks are the track_count tracks to be returned, in stream order,
+  which the reader takes ownership of
+  and whose last sectors are where each track's MLP data ends
 
   pad 2 size is pulled from the packet header
 
+  flags are a set of dvda_reader_flags_t:
+  with DVDA_STEREO_ONLY and 2 substreams,
+  only substream 0's 2 channel presentation is decoded,
+  with DVDA_PARALLEL_DECODE the stream is decoded on a pool of
+  worker threads (falling back to a single thread if none can be started)
+  and with DVDA_SKIP_VERIFICATION substream checkdata is ignored
+
   returns a completed reader which must be closed
   with dvda_close_track_reader()*/
 static DVDA_Track_Reader*
 open_mlp_track_reader(Packet_Reader* packet_reader,
                       BitstreamReader* audio_packet,
-                      unsigned last_sector,
-                      unsigned pad_2_size);
+                      struct reader_track* tracks,
+                      unsigned track_count,
+                      unsigned pad_2_size,
+                      unsigned flags);
 
 /*samples is a buffer to place decoded samples
 
   returns the aount of PCM frames read*/
 static unsigned
-decode_mlp_audio(DVDA_Track_Reader* self, aa_int* samples);
+decode_mlp_audio(DVDA_Track_Reader* self, a_int* samples);
+
+/*decodes the next packet's MLP data to samples
+  and sets the reader's stream_finished flag
+  once the end of the track has been reached
+
+  returns the amount of PCM frames read,
+  which may be 0 if the packet completes no MLP frames*/
+static unsigned
+decode_mlp_packet(DVDA_Track_Reader* self, a_int* samples);
+
+/*as decode_mlp_audio, but keeps the parallel decoder's
+  worker threads busy with segments ahead of the one returned*/
+static unsigned
+decode_mlp_audio_parallel(DVDA_Track_Reader* self, a_int* samples);
+
+/*reads the next packet's MLP data into the parallel decoder
+
+  returns 1 if more packets may follow,
+  or 0 if the end of the track has been reached*/
+static int
+read_ahead_mlp_packet(DVDA_Track_Reader* self);
+
+/*marks any tracks whose first segment follows
+  those taken from the parallel decoder so far as started*/
+static void
+start_parallel_tracks(DVDA_Track_Reader* self, const a_int* samples);
+
+/*given the first packet past the end of the current track's sectors,
+  with its header not yet read,
+  places the rest of the current track's MLP data in track_data
+  and if another track follows, places its MLP data
+  from its first major sync onward in next_track_data
+
+  returns 1 if the next track continues the stream,
+  or 0 if there's no next track, its data can't be found
+  or its stream parameters differ from the current track's*/
+static int
+split_mlp_tracks(DVDA_Track_Reader* self,
+                 BitstreamReader* packet,
+                 BitstreamQueue* track_data,
+                 BitstreamQueue* next_track_data);
 
 static void
 close_mlp_track_reader(DVDA_Track_Reader *reader);
@@ -281,7 +497,7 @@ static int
 enqueue_mlp_packet(Packet_Reader* packet_reader, BitstreamQueue* mlp_data);
 
 /*given a packet reader and packet data (not including header or pad 2 block)
-  locates the first set of stream parameters
+  locates the first set of stream parameters and substream count
   and dumps the remaining MLP data in mlp_data
   for later processing
 
@@ -290,32 +506,36 @@ static unsigned
 locate_mlp_parameters(Packet_Reader* packet_reader,
                       BitstreamReader* packet_data,
                       struct stream_parameters* parameters,
+                      unsigned* substream_count,
                       BitstreamQueue* mlp_data);
 
+/*given a queue of MLP data starting at a major sync,
+  reads the stream parameters and substream count that follow it
+  without consuming any data,
+  enqueuing additional packets if more data is needed*/
+static void
+read_mlp_parameters(Packet_Reader* packet_reader,
+                    BitstreamQueue* mlp_data,
+                    struct stream_parameters* parameters,
+                    unsigned* substream_count);
+
 /*given a packet reader and initial packet data
   (not including 48 bit header)
-  enqueues all MLP data on the stream to mlp_data
-  and returns the amount of data queued*/
+  enqueues all MLP data on the stream up to the next major sync
+  to mlp_data and returns the amount of data queued
+
+  if remainder is not NULL, and a major sync is found,
+  the data from the major sync onward is enqueued to it*/
 static unsigned
 mlp_data_to_major_sync(Packet_Reader* packet_reader,
                        BitstreamReader* packet_data,
-                       BitstreamQueue* mlp_data);
-
-/*given a 4 bit packed field,
-  returns the bits-per-sample which is either 16, 20 or 24*/
-static unsigned
-unpack_bits_per_sample(unsigned packed_field);
-
-/*given a 4 bit packed field,
-  returns the sample rate in Hz which is either
-  44100, 48000, 88200, 96000 176400 or 192000*/
-static unsigned
-unpack_sample_rate(unsigned packed_field);
+                       BitstreamQueue* mlp_data,
+                       BitstreamQueue* remainder);
 
-/*given a 5 bit packed field,
-  returns the channel count which is between 1 and 6*/
-static unsigned
-unpack_channel_count(unsigned packet_field);
+/*returns the time the packet reader and its AOB reader
+  have spent since the packet reader was opened*/
+static uint64_t
+packet_reader_ns(const Packet_Reader* packet_reader);
 
 /*******************************************************************
  *                  public function implementations                *
@@ -467,6 +687,7 @@ dvda_open_title(DVDA_Titleset* titleset, unsigned title_num)
         title->tracks[i].PTS.index = track->PTS.index;
         title->tracks[i].PTS.length = track->PTS.length;
         title->tracks[i].sector.first = index->first_sector;
+        title->tracks[i].sector.end = index->last_sector;
         if (last_track) {
             const int last_title = (title_num == titleset->ifo.title_count);
             if (last_title) {
@@ -597,53 +818,160 @@ dvda_track_last_sector(const DVDA_Track* track)
 DVDA_Track_Reader*
 dvda_open_track_reader(const DVDA_Track* track)
 {
-    AOB_Reader* aob_reader;
+    return dvda_open_track_reader_ex(track, DVDA_DEFAULT);
+}
+
+uint64_t
+dvda_track_pcm_frames(const DVDA_Track* track)
+{
     Packet_Reader* packet_reader;
-    BitstreamReader* audio_packet = NULL;
-    DVDA_Track_Reader* track_reader;
+    BitstreamReader* audio_packet;
+    struct stream_parameters parameters;
     unsigned codec_id;
     unsigned pad_2_size;
-    unsigned sector;
-
-    /*open an AOB reader for the given disc*/
-    if ((aob_reader = aob_reader_open(track->disc.audio_ts,
-                                      track->disc.device,
-                                      track->titleset_number)) == NULL) {
-        return NULL;
+    uint64_t pcm_frames;
+
+    if ((audio_packet = open_track_audio(&track->disc,
+                                         track->titleset_number,
+                                         track->sector.first,
+                                         &packet_reader,
+                                         &codec_id,
+                                         &pad_2_size)) == NULL) {
+        return 0;
     }
 
-    /*seek to the track's first sector*/
-    if (aob_reader_seek(aob_reader, track->sector.first)) {
-        aob_reader_close(aob_reader);
-        return NULL;
+    switch (codec_id) {
+    case PCM_CODEC_ID:
+        {
+            /*PCM tracks are returned a whole packet at a time
+              until their PTS length is reached,
+              and unpacking PCM costs little more than reading it,
+              so simply run the PCM reader to the end*/
+            DVDA_Track_Reader* reader =
+                open_pcm_track_reader(packet_reader,
+                                      audio_packet,
+                                      single_reader_track(track),
+                                      1,
+                                      pad_2_size);
+            unsigned pcm_frames_read;
+
+            pcm_frames =
+                reader->channel_data->len / dvda_channel_count(reader);
+            do {
+                reader->channel_data->reset(reader->channel_data);
+                pcm_frames += (pcm_frames_read =
+                               reader->decode(reader, reader->channel_data));
+            } while (pcm_frames_read);
+
+            audio_packet->close(audio_packet);
+            reader->close(reader);
+            return pcm_frames;
+        }
+    case MLP_CODEC_ID:
+        {
+            BitstreamQueue* mlp_data = br_open_queue(BS_BIG_ENDIAN);
+            unsigned substream_count;
+            unsigned mlp_frames;
+            BitstreamReader* packet;
+            unsigned sector;
+
+            /*the same packets the MLP track reader decodes
+              are queued up and their frames counted as they complete*/
+            audio_packet->skip_bytes(audio_packet, pad_2_size);
+
+            locate_mlp_parameters(packet_reader,
+                                  audio_packet,
+                                  &parameters,
+                                  &substream_count,
+                                  mlp_data);
+
+            mlp_frames = dvda_mlp_skip_frames(mlp_data);
+
+            while ((packet = packet_reader_next_audio_packet(packet_reader,
+                                                             &sector))) {
+                if (sector > track->sector.last) {
+                    /*the track ends at the next major sync*/
+                    mlp_data_to_major_sync(packet_reader,
+                                           packet,
+                                           mlp_data,
+                                           NULL);
+                    packet->close(packet);
+                    mlp_frames += dvda_mlp_skip_frames(mlp_data);
+                    break;
+                }
+
+                if (!setjmp(*br_try(packet))) {
+                    read_audio_packet_header(packet, &codec_id, &pad_2_size);
+                    if (codec_id != MLP_CODEC_ID) {
+                        /*codec mismatch in stream*/
+                        br_etry(packet);
+                        packet->close(packet);
+                        break;
+                    }
+                    packet->skip_bytes(packet, pad_2_size);
+                    packet->enqueue(packet, packet->size(packet), mlp_data);
+                    br_etry(packet);
+                    packet->close(packet);
+                } else {
+                    /*I/O error reading packet*/
+                    br_etry(packet);
+                    packet->close(packet);
+                    break;
+                }
+
+                mlp_frames += dvda_mlp_skip_frames(mlp_data);
+            }
+
+            mlp_data->close(mlp_data);
+
+            pcm_frames = (uint64_t)mlp_frames *
+                         dvda_mlp_frame_size(&parameters);
+        }
+        break;
+    default:  /*unknown codec ID*/
+        pcm_frames = 0;
+        break;
     }
 
-    /*wrap AOB reader with packet reader*/
-    packet_reader = packet_reader_open(aob_reader);
+    audio_packet->close(audio_packet);
+    packet_reader_close(packet_reader);
 
-    /*get first audio packet from packet reader*/
-    audio_packet = packet_reader_next_audio_packet(packet_reader, &sector);
+    return pcm_frames;
+}
 
-    if (!audio_packet) {
-        /*got to end of stream without hitting an audio packet*/
-        packet_reader_close(packet_reader);
+DVDA_Track_Reader*
+dvda_open_track_reader_ex(const DVDA_Track* track, unsigned flags)
+{
+    Packet_Reader* packet_reader;
+    BitstreamReader* audio_packet;
+    DVDA_Track_Reader* track_reader;
+    unsigned codec_id;
+    unsigned pad_2_size;
+
+    if ((audio_packet = open_track_audio(&track->disc,
+                                         track->titleset_number,
+                                         track->sector.first,
+                                         &packet_reader,
+                                         &codec_id,
+                                         &pad_2_size)) == NULL) {
         return NULL;
     }
 
-    read_audio_packet_header(audio_packet, &codec_id, &pad_2_size);
-
     switch (codec_id) {
     case PCM_CODEC_ID:
         track_reader = open_pcm_track_reader(packet_reader,
                                              audio_packet,
-                                             track->PTS.length,
+                                             single_reader_track(track),
+                                             1,
                                              pad_2_size);
         break;
     case MLP_CODEC_ID:
         track_reader = open_mlp_track_reader(packet_reader,
                                              audio_packet,
-                                             track->sector.last,
-                                             pad_2_size);
+                                             single_reader_track(track),
+                                             1,
+                                             pad_2_size,
+                                             flags);
         break;
     default:  /*unknown codec ID*/
         track_reader = NULL;
@@ -656,12 +984,108 @@ dvda_open_track_reader(const DVDA_Track* track)
     return track_reader;
 }
 
+DVDA_Track_Reader*
+dvda_open_title_reader(const DVDA_Title* title)
+{
+    return dvda_open_title_reader_ex(title, DVDA_DEFAULT);
+}
+
+DVDA_Track_Reader*
+dvda_open_title_reader_ex(const DVDA_Title* title, unsigned flags)
+{
+    return open_title_tracks(title, 0, NULL, flags);
+}
+
+int
+dvda_read_titleset(DVDA_Titleset* titleset,
+                   unsigned flags,
+                   const dvda_track_sink_t* sink,
+                   void* sink_data)
+{
+    AOB_Reader* aob_reader;
+    DVDA_Title** titles;
+    unsigned title_count = 0;
+    unsigned i;
+    int result = 0;
+
+    if ((aob_reader = aob_reader_open(titleset->disc.audio_ts,
+                                      titleset->disc.device,
+                                      titleset->titleset_number)) == NULL) {
+        return -1;
+    }
+
+    /*sort the title set's titles by their first sector
+      so the AOBs are read from start to end*/
+    titles = malloc(sizeof(DVDA_Title*) * titleset->ifo.title_count);
+    for (i = 1; i <= titleset->ifo.title_count; i++) {
+        DVDA_Title* title = dvda_open_title(titleset, i);
+        unsigned j;
+
+        if (title->track_count == 0) {
+            dvda_close_title(title);
+            continue;
+        }
+
+        for (j = title_count;
+             (j > 0) &&
+             (titles[j - 1]->tracks[0].sector.first >
+              title->tracks[0].sector.first);
+             j--) {
+            titles[j] = titles[j - 1];
+        }
+        titles[j] = title;
+        title_count++;
+    }
+
+    for (i = 0; i < title_count; i++) {
+        DVDA_Title* title = titles[i];
+        unsigned next_track = 0;
+
+        /*a title's tracks are usually read by a single reader
+          but should a track's stream attributes change,
+          another reader continues from that track*/
+        while ((result == 0) && (next_track < title->track_count)) {
+            const unsigned first_track = next_track;
+            DVDA_Track_Reader* reader =
+                open_title_tracks(title, first_track, aob_reader, flags);
+
+            if (reader) {
+                result = read_title_tracks(reader,
+                                           title,
+                                           first_track,
+                                           &next_track,
+                                           sink,
+                                           sink_data);
+                dvda_close_track_reader(reader);
+            }
+
+            if (next_track == first_track) {
+                /*unable to read the track, so skip it*/
+                next_track++;
+            }
+        }
+
+        dvda_close_title(title);
+    }
+
+    free(titles);
+    aob_reader_close(aob_reader);
+
+    return result;
+}
+
 void
 dvda_close_track_reader(DVDA_Track_Reader* reader)
 {
     reader->close(reader);
 }
 
+unsigned
+dvda_reader_track_number(const DVDA_Track_Reader* reader)
+{
+    return reader->tracks[reader->track_read].number;
+}
+
 dvda_codec_t
 dvda_codec(const DVDA_Track_Reader* reader)
 {
@@ -671,19 +1095,19 @@ dvda_codec(const DVDA_Track_Reader* reader)
 unsigned
 dvda_bits_per_sample(const DVDA_Track_Reader* reader)
 {
-    return unpack_bits_per_sample(reader->parameters.group_0_bps);
+    return dvda_unpack_bits_per_sample(reader->parameters.group_0_bps);
 }
 
 unsigned
 dvda_sample_rate(const DVDA_Track_Reader* reader)
 {
-    return unpack_sample_rate(reader->parameters.group_0_rate);
+    return dvda_unpack_sample_rate(reader->parameters.group_0_rate);
 }
 
 unsigned
 dvda_channel_count(const DVDA_Track_Reader* reader)
 {
-    return unpack_channel_count(reader->parameters.channel_assignment);
+    return dvda_unpack_channel_count(reader->parameters.channel_assignment);
 }
 
 unsigned
@@ -754,44 +1178,115 @@ dvda_read(DVDA_Track_Reader* reader,
           int buffer[])
 {
     const unsigned channel_count = dvda_channel_count(reader);
-    aa_int* channel_data = reader->channel_data;
-    unsigned amount_read;
-    unsigned c;
-
-    if (!pcm_frames) {
-        return 0;
-    }
+    a_int* channel_data = reader->channel_data;
+    unsigned amount_read = 0;
+
+    DVDA_PROBE2(read__start, reader, pcm_frames);
+
+    while (amount_read < pcm_frames) {
+        const unsigned buffered =
+            (channel_data->len / channel_count) - reader->channel_data_pos;
+        unsigned track_remaining = UINT_MAX;
+
+        if ((reader->track_read + 1) < reader->tracks_started) {
+            /*the end of the track being read is known*/
+            const uint64_t position =
+                reader->channel_data_start + reader->channel_data_pos;
+            const uint64_t next_track_start =
+                reader->tracks[reader->track_read + 1].start;
+
+            if (position >= next_track_start) {
+                if (amount_read) {
+                    /*return only a single track's PCM frames at a time*/
+                    break;
+                } else {
+                    reader->track_read += 1;
+                    continue;
+                }
+            } else if ((next_track_start - position) < UINT_MAX) {
+                track_remaining = (unsigned)(next_track_start - position);
+            }
+        }
 
-    /*populate per-channel buffer with samples as needed*/
-    if (!reader->stream_finished) {
-        while (channel_data->_[0]->len < pcm_frames) {
-            const unsigned pcm_frames_read =
-                reader->decode(reader, channel_data);
-            if (!pcm_frames_read) {
+        if (buffered) {
+            /*transfer contents of interleaved buffer to output buffer*/
+            const unsigned to_transfer =
+                MIN(MIN(buffered, pcm_frames - amount_read),
+                    track_remaining);
+
+            memcpy(buffer + (amount_read * channel_count),
+                   channel_data->_ + (reader->channel_data_pos *
+                                      channel_count),
+                   to_transfer * channel_count * sizeof(int));
+
+            reader->channel_data_pos += to_transfer;
+            amount_read += to_transfer;
+        } else if (!reader->stream_finished) {
+            const uint64_t packets_start =
+                packet_reader_ns(reader->packet_reader);
+            uint64_t decode_start;
+            unsigned decoded;
+
+            /*buffer is drained,
+              so reuse its space for the next batch of samples*/
+            reader->channel_data_start += channel_data->len / channel_count;
+            channel_data->reset(channel_data);
+            reader->channel_data_pos = 0;
+
+            decode_start = dvda_clock_ns();
+            decoded = reader->decode(reader, channel_data);
+            reader->decode_ns +=
+                (dvda_clock_ns() - decode_start) -
+                (packet_reader_ns(reader->packet_reader) - packets_start);
+
+            if (!decoded) {
                 /*no more data in stream*/
                 reader->stream_finished = 1;
-                break;
             }
+        } else {
+            /*no more data in stream or buffer*/
+            break;
         }
     }
 
-    amount_read = MIN(pcm_frames, channel_data->_[0]->len);
+    DVDA_PROBE2(read__done, reader, amount_read);
 
-    /*transfer contents of per-channel buffer to output buffer*/
-    for (c = 0; c < channel_count; c++) {
-        a_int* channel = channel_data->_[c];
-        unsigned i;
-        assert(channel->len >= amount_read);
+    return amount_read;
+}
 
-        for (i = 0; i < amount_read; i++) {
-            buffer[i * channel_count + c] = channel->_[i];
-        }
+void
+dvda_reader_stats(const DVDA_Track_Reader* reader,
+                  dvda_reader_stats_t* stats)
+{
+    const struct packet_reader_stats* packet_stats =
+        packet_reader_stats(reader->packet_reader);
+    struct aob_reader_stats aob_stats;
+    struct mlp_decoder_stats mlp_stats = {0, 0, 0, 0};
+
+    packet_reader_aob_stats(reader->packet_reader, &aob_stats);
 
-        /*remove output buffer contents from per-channel buffer*/
-        channel->de_head(channel, amount_read, channel);
+    if (reader->codec == DVDA_MLP) {
+        if (reader->reader.mlp.parallel_decoder) {
+            dvda_mlp_parallel_decoder_stats(
+                reader->reader.mlp.parallel_decoder, &mlp_stats);
+        } else {
+            dvda_mlpdecoder_stats(reader->reader.mlp.decoder, &mlp_stats);
+        }
     }
 
-    return amount_read;
+    stats->sectors_read = aob_stats.sectors_read;
+    stats->bytes_decrypted = aob_stats.bytes_decrypted;
+    stats->packets_demuxed = packet_stats->packets_demuxed;
+    stats->packets_skipped = packet_stats->packets_skipped;
+    stats->mlp_frames = mlp_stats.frames;
+    stats->mlp_blocks = mlp_stats.blocks;
+    stats->mlp_restart_headers = mlp_stats.restart_headers;
+    stats->mlp_check_failures = mlp_stats.check_failures;
+    stats->sync_bytes_scanned = reader->sync_bytes_scanned;
+    stats->read_ns = aob_stats.read_ns;
+    stats->decrypt_ns = aob_stats.decrypt_ns;
+    stats->demux_ns = packet_stats->demux_ns;
+    stats->decode_ns = reader->decode_ns;
 }
 
 /*******************************************************************
@@ -952,17 +1447,17 @@ parse_ats_XX_0_ifo_title(BitstreamReader* reader,
 static DVDA_Track_Reader*
 open_pcm_track_reader(Packet_Reader* packet_reader,
                       BitstreamReader* audio_packet,
-                      unsigned pts_length,
+                      struct reader_track* tracks,
+                      unsigned track_count,
                       unsigned pad_2_size)
 {
     unsigned channel_count;
-    unsigned c;
-    double pts_length_d = pts_length;
     uint64_t total_pcm_frames;
     unsigned pcm_frames_read;
 
     DVDA_Track_Reader* track_reader = malloc(sizeof(DVDA_Track_Reader));
     track_reader->packet_reader = packet_reader;
+    track_reader->owns_aob_reader = 1;
 
     /*FIXME - check for I/O errors?*/
 
@@ -971,29 +1466,34 @@ open_pcm_track_reader(Packet_Reader* packet_reader,
       track's first sector and PCM data doesn't cross packet boundaries*/
     track_reader->codec = DVDA_PCM;
     track_reader->stream_finished = 0;
+    track_reader->sync_bytes_scanned = 0;
+    track_reader->decode_ns = 0;
     dvda_pcmdecoder_decode_params(audio_packet, &(track_reader->parameters));
 
-    pts_length_d *= unpack_sample_rate(track_reader->parameters.group_0_rate);
-    pts_length_d /= PTS_PER_SECOND;
+    track_reader->tracks = tracks;
+    track_reader->track_count = track_count;
+    track_reader->tracks_started = 1;
+    track_reader->track_read = 0;
 
-    total_pcm_frames = lround(pts_length_d);
+    total_pcm_frames = pts_to_pcm_frames(
+        tracks[0].pts_length,
+        dvda_unpack_sample_rate(track_reader->parameters.group_0_rate));
 
     track_reader->reader.pcm.total_pcm_frames =
         track_reader->reader.pcm.remaining_pcm_frames =
         total_pcm_frames;
 
     channel_count =
-        unpack_channel_count(track_reader->parameters.channel_assignment);
+        dvda_unpack_channel_count(track_reader->parameters.channel_assignment);
 
     track_reader->reader.pcm.decoder = dvda_open_pcmdecoder(
-        unpack_bits_per_sample(track_reader->parameters.group_0_bps),
+        dvda_unpack_bits_per_sample(track_reader->parameters.group_0_bps),
         channel_count);
 
-    /*setup initial channels*/
-    track_reader->channel_data = aa_int_new();
-    for (c = 0; c < channel_count; c++) {
-        (void)track_reader->channel_data->append(track_reader->channel_data);
-    }
+    /*setup initial sample buffer*/
+    track_reader->channel_data = a_int_new();
+    track_reader->channel_data_pos = 0;
+    track_reader->channel_data_start = 0;
 
     /*decode remaining bytes in packet to buffer*/
     audio_packet->skip_bytes(audio_packet, pad_2_size - 9);
@@ -1013,171 +1513,543 @@ open_pcm_track_reader(Packet_Reader* packet_reader,
     return track_reader;
 }
 
-static unsigned
-decode_pcm_audio(DVDA_Track_Reader* self, aa_int* samples)
+static uint64_t
+pts_to_pcm_frames(unsigned pts_length, unsigned sample_rate)
 {
-    BitstreamReader* packet;
-    unsigned sector;
+    double pts_length_d = pts_length;
 
-    if (!self->reader.pcm.remaining_pcm_frames) {
-        /*no more data to output*/
-        return 0;
-    }
+    pts_length_d *= sample_rate;
+    pts_length_d /= PTS_PER_SECOND;
 
-    packet = packet_reader_next_audio_packet(self->packet_reader, &sector);
+    return lround(pts_length_d);
+}
 
-    if (!packet) {
-        /*no more packets in stream*/
-        return 0;
+static BitstreamReader*
+open_track_audio(const struct disc_path* disc,
+                 unsigned titleset_number,
+                 unsigned first_sector,
+                 Packet_Reader** packet_reader,
+                 unsigned* codec_id,
+                 unsigned* pad_2_size)
+{
+    AOB_Reader* aob_reader;
+    BitstreamReader* audio_packet;
+
+    /*open an AOB reader for the given disc*/
+    if ((aob_reader = aob_reader_open(disc->audio_ts,
+                                      disc->device,
+                                      titleset_number)) == NULL) {
+        return NULL;
     }
 
-    if (!setjmp(*br_try(packet))) {
-        unsigned codec_id;
-        unsigned pad_2_size;
-        struct stream_parameters parameters;
-        unsigned pcm_frames_read;
+    if ((audio_packet = seek_track_audio(aob_reader,
+                                         first_sector,
+                                         packet_reader,
+                                         codec_id,
+                                         pad_2_size)) == NULL) {
+        aob_reader_close(aob_reader);
+    }
 
-        read_audio_packet_header(packet, &codec_id, &pad_2_size);
+    return audio_packet;
+}
 
-        if (codec_id != PCM_CODEC_ID) {
-            /*codec mismatch in stream*/
-            br_etry(packet);
-            packet->close(packet);
-            return 0;
-        }
+static BitstreamReader*
+seek_track_audio(AOB_Reader* aob_reader,
+                 unsigned first_sector,
+                 Packet_Reader** packet_reader,
+                 unsigned* codec_id,
+                 unsigned* pad_2_size)
+{
+    BitstreamReader* audio_packet;
+    unsigned sector;
 
-        dvda_pcmdecoder_decode_params(packet, &parameters);
+    /*seek to the track's first sector*/
+    if (aob_reader_seek(aob_reader, first_sector)) {
+        return NULL;
+    }
 
-        if (!dvda_params_equal(&self->parameters, &parameters)) {
-            /*stream parameters mismatch*/
-            br_etry(packet);
-            packet->close(packet);
-            return 0;
-        }
+    /*wrap AOB reader with packet reader*/
+    *packet_reader = packet_reader_open(aob_reader);
 
-        packet->skip_bytes(packet, pad_2_size - 9);
+    /*get first audio packet from packet reader*/
+    audio_packet = packet_reader_next_audio_packet(*packet_reader, &sector);
 
-        pcm_frames_read =
-            dvda_pcmdecoder_decode_packet(self->reader.pcm.decoder,
-                                          packet,
-                                          samples);
+    if (!audio_packet) {
+        /*got to end of stream without hitting an audio packet*/
+        packet_reader_free(*packet_reader);
+        return NULL;
+    }
 
-        br_etry(packet);
-        packet->close(packet);
+    read_audio_packet_header(audio_packet, codec_id, pad_2_size);
 
-        /*FIXME - handle the case of PCM frames not falling
-          on packet boundaries?*/
-        self->reader.pcm.remaining_pcm_frames -=
-            MIN(pcm_frames_read,
-                self->reader.pcm.remaining_pcm_frames);
+    return audio_packet;
+}
 
-        /*return all samples*/
-        return pcm_frames_read;
+static void
+close_packet_reader(DVDA_Track_Reader* reader)
+{
+    if (reader->owns_aob_reader) {
+        packet_reader_close(reader->packet_reader);
     } else {
-        /*some I/O error reading packet*/
-        br_etry(packet);
-        packet->close(packet);
-        return 0;
+        packet_reader_free(reader->packet_reader);
     }
 }
 
-static void
-close_pcm_track_reader(DVDA_Track_Reader *reader)
+static uint64_t
+packet_reader_ns(const Packet_Reader* packet_reader)
 {
-    packet_reader_close(reader->packet_reader);
-    dvda_close_pcmdecoder(reader->reader.pcm.decoder);
-    reader->channel_data->del(reader->channel_data);
-    free(reader);
-}
+    struct aob_reader_stats aob_stats;
 
+    packet_reader_aob_stats(packet_reader, &aob_stats);
+    return packet_reader_stats(packet_reader)->demux_ns +
+           aob_stats.read_ns +
+           aob_stats.decrypt_ns;
+}
 
-static DVDA_Track_Reader*
-open_mlp_track_reader(Packet_Reader* packet_reader,
-                      BitstreamReader* audio_packet,
-                      unsigned last_sector,
-                      unsigned pad_2_size)
+static struct reader_track*
+single_reader_track(const DVDA_Track* track)
 {
-    unsigned channel_count;
-    unsigned c;
-    BitstreamQueue* mlp_data;
+    struct reader_track* tracks = malloc(sizeof(struct reader_track));
 
-    DVDA_Track_Reader* track_reader = malloc(sizeof(DVDA_Track_Reader));
-    track_reader->packet_reader = packet_reader;
+    tracks->number = track->track_number;
+    tracks->pts_length = track->PTS.length;
+    tracks->first_sector = track->sector.first;
+    tracks->last_sector = track->sector.last;
+    tracks->end_sector = track->sector.last;
+    tracks->start = 0;
+    tracks->segment = 0;
 
-    track_reader->codec = DVDA_MLP;
-    track_reader->stream_finished = 0;
+    return tracks;
+}
 
-    /*FIXME - check for I/O errors?*/
+static DVDA_Track_Reader*
+open_title_tracks(const DVDA_Title* title,
+                  unsigned first_track,
+                  AOB_Reader* aob_reader,
+                  unsigned flags)
+{
+    const unsigned track_count = title->track_count - first_track;
+    Packet_Reader* packet_reader;
+    BitstreamReader* audio_packet;
+    DVDA_Track_Reader* title_reader;
+    struct reader_track* tracks;
+    unsigned codec_id;
+    unsigned pad_2_size;
+    unsigned i;
 
-    /*skip initial padding*/
-    audio_packet->skip_bytes(audio_packet, pad_2_size);
+    if (first_track >= title->track_count) {
+        /*no tracks to read*/
+        return NULL;
+    }
 
-    mlp_data = br_open_queue(BS_BIG_ENDIAN);
+    if (aob_reader) {
+        audio_packet = seek_track_audio(
+            aob_reader,
+            title->tracks[first_track].sector.first,
+            &packet_reader,
+            &codec_id,
+            &pad_2_size);
+    } else {
+        audio_packet = open_track_audio(
+            &title->disc,
+            title->titleset_number,
+            title->tracks[first_track].sector.first,
+            &packet_reader,
+            &codec_id,
+            &pad_2_size);
+    }
+    if (!audio_packet) {
+        return NULL;
+    }
 
-    /*FIXME - save offset somewhere?*/
-    locate_mlp_parameters(packet_reader,
-                          audio_packet,
-                          &track_reader->parameters,
-                          mlp_data);
+    tracks = malloc(sizeof(struct reader_track) * track_count);
+    for (i = 0; i < track_count; i++) {
+        tracks[i].number = first_track + i + 1;
+        tracks[i].pts_length = title->tracks[first_track + i].PTS.length;
+        tracks[i].first_sector = title->tracks[first_track + i].sector.first;
+        tracks[i].last_sector = title->tracks[first_track + i].sector.last;
+        tracks[i].end_sector =
+            MAX(title->tracks[first_track + i].sector.last,
+                title->tracks[first_track + i].sector.end);
+        tracks[i].start = 0;
+        tracks[i].segment = 0;
+    }
 
-    channel_count =
-        unpack_channel_count(track_reader->parameters.channel_assignment);
+    switch (codec_id) {
+    case PCM_CODEC_ID:
+        title_reader = open_pcm_track_reader(packet_reader,
+                                             audio_packet,
+                                             tracks,
+                                             track_count,
+                                             pad_2_size);
+        break;
+    case MLP_CODEC_ID:
+        title_reader = open_mlp_track_reader(packet_reader,
+                                             audio_packet,
+                                             tracks,
+                                             track_count,
+                                             pad_2_size,
+                                             flags);
+        break;
+    default:  /*unknown codec ID*/
+        title_reader = NULL;
+        free(tracks);
+        if (aob_reader) {
+            packet_reader_free(packet_reader);
+        } else {
+            packet_reader_close(packet_reader);
+        }
+        break;
+    }
+
+    if (title_reader && aob_reader) {
+        title_reader->owns_aob_reader = 0;
+    }
+
+    audio_packet->close(audio_packet);
 
-    track_reader->reader.mlp.last_sector = last_sector;
-    track_reader->reader.mlp.decoder =
-        dvda_open_mlpdecoder(&(track_reader->parameters));
+    return title_reader;
+}
 
-    /*setup initial channels*/
-    track_reader->channel_data = aa_int_new();
-    for (c = 0; c < channel_count; c++) {
-        (void)track_reader->channel_data->append(track_reader->channel_data);
+static int
+read_title_tracks(DVDA_Track_Reader* reader,
+                  const DVDA_Title* title,
+                  unsigned first_track,
+                  unsigned* next_track,
+                  const dvda_track_sink_t* sink,
+                  void* sink_data)
+{
+    const unsigned channel_count = dvda_channel_count(reader);
+    int* buffer = malloc(sizeof(int) * channel_count * TRACK_SINK_FRAMES);
+    unsigned pcm_frames;
+    unsigned last_track;
+    int result = 0;
+
+    /*start the reader's first track, even if it turns out to be empty*/
+    if ((result = sink->start_track(sink_data,
+                                    title->title_number,
+                                    first_track + 1,
+                                    reader)) != 0) {
+        goto finished;
     }
+    *next_track = first_track + 1;
+
+    while ((pcm_frames = dvda_read(reader,
+                                   TRACK_SINK_FRAMES,
+                                   buffer)) > 0) {
+        const unsigned track = dvda_reader_track_number(reader);
+
+        /*finish the previous track and start this one,
+          along with any empty tracks in between*/
+        while (*next_track < track) {
+            if (((result = sink->finish_track(sink_data)) != 0) ||
+                ((result = sink->start_track(sink_data,
+                                             title->title_number,
+                                             *next_track + 1,
+                                             reader)) != 0)) {
+                goto finished;
+            }
+            *next_track += 1;
+        }
 
-    /*decode remaining bytes in packet to buffer*/
-    /*decode remaining MLP frames in packet to buffer*/
-    dvda_mlpdecoder_decode_packet(track_reader->reader.mlp.decoder,
-                                  (BitstreamReader*)mlp_data,
-                                  track_reader->channel_data);
+        if ((result = sink->write(sink_data, buffer, pcm_frames)) != 0) {
+            goto finished;
+        }
+    }
+
+    /*any tracks the reader started but returned no PCM frames for
+      are empty, while the tracks after them are left for another reader*/
+    last_track = first_track + reader->tracks_started;
+    while (*next_track < last_track) {
+        if (((result = sink->finish_track(sink_data)) != 0) ||
+            ((result = sink->start_track(sink_data,
+                                         title->title_number,
+                                         *next_track + 1,
+                                         reader)) != 0)) {
+            goto finished;
+        }
+        *next_track += 1;
+    }
+
+    result = sink->finish_track(sink_data);
+
+finished:
+    free(buffer);
+    return result;
+}
+
+static void
+start_next_track(DVDA_Track_Reader* self, const a_int* samples)
+{
+    self->tracks[self->tracks_started].start =
+        self->channel_data_start + samples->len / dvda_channel_count(self);
+    self->tracks_started += 1;
+}
+
+static unsigned
+decode_pcm_audio(DVDA_Track_Reader* self, a_int* samples)
+{
+    const unsigned tracks_started = self->tracks_started;
+    BitstreamReader* packet;
+    unsigned sector;
+
+    for (;;) {
+        if (!self->reader.pcm.remaining_pcm_frames) {
+            if (self->tracks_started == self->track_count) {
+                /*no more data to output*/
+                return 0;
+            } else {
+                /*move on to the title's next track*/
+                start_next_pcm_track(self, samples);
+                continue;
+            }
+        }
+
+        packet = packet_reader_next_audio_packet(self->packet_reader,
+                                                 &sector);
+
+        if (!packet) {
+            /*no more packets in stream*/
+            return 0;
+        }
+
+        /*a packet past the current track's sectors starts the next track
+          even if the current track is short of its PTS length,
+          but a sector shared with the next track's start
+          is still the current track's until it has all its PCM frames*/
+        while ((self->tracks_started < self->track_count) &&
+               (sector > self->tracks[self->tracks_started - 1].end_sector)) {
+            start_next_pcm_track(self, samples);
+        }
+
+        if (sector < self->tracks[self->tracks_started - 1].first_sector) {
+            /*skip any packets between the end of the previous track
+              and the start of the current one*/
+            packet->close(packet);
+        } else {
+            break;
+        }
+    }
+
+    if (!setjmp(*br_try(packet))) {
+        unsigned codec_id;
+        unsigned pad_2_size;
+        struct stream_parameters parameters;
+        unsigned pcm_frames_read;
+
+        read_audio_packet_header(packet, &codec_id, &pad_2_size);
+
+        if (codec_id != PCM_CODEC_ID) {
+            /*codec mismatch in stream,
+              so any tracks started along the way are left unread*/
+            br_etry(packet);
+            packet->close(packet);
+            self->tracks_started = tracks_started;
+            return 0;
+        }
+
+        dvda_pcmdecoder_decode_params(packet, &parameters);
+
+        if (!dvda_params_equal(&self->parameters, &parameters)) {
+            /*stream parameters mismatch,
+              so any tracks started along the way are left unread*/
+            br_etry(packet);
+            packet->close(packet);
+            self->tracks_started = tracks_started;
+            return 0;
+        }
+
+        packet->skip_bytes(packet, pad_2_size - 9);
+
+        pcm_frames_read =
+            dvda_pcmdecoder_decode_packet(self->reader.pcm.decoder,
+                                          packet,
+                                          samples);
+
+        br_etry(packet);
+        packet->close(packet);
+
+        /*FIXME - handle the case of PCM frames not falling
+          on packet boundaries?*/
+        self->reader.pcm.remaining_pcm_frames -=
+            MIN(pcm_frames_read,
+                self->reader.pcm.remaining_pcm_frames);
+
+        /*return all samples*/
+        return pcm_frames_read;
+    } else {
+        /*some I/O error reading packet*/
+        br_etry(packet);
+        packet->close(packet);
+        return 0;
+    }
+}
+
+static void
+start_next_pcm_track(DVDA_Track_Reader* self, const a_int* samples)
+{
+    start_next_track(self, samples);
+
+    self->reader.pcm.total_pcm_frames =
+        self->reader.pcm.remaining_pcm_frames =
+        pts_to_pcm_frames(
+            self->tracks[self->tracks_started - 1].pts_length,
+            dvda_unpack_sample_rate(self->parameters.group_0_rate));
+}
+
+static void
+close_pcm_track_reader(DVDA_Track_Reader *reader)
+{
+    close_packet_reader(reader);
+    dvda_close_pcmdecoder(reader->reader.pcm.decoder);
+    reader->channel_data->del(reader->channel_data);
+    free(reader->tracks);
+    free(reader);
+}
+
+
+static DVDA_Track_Reader*
+open_mlp_track_reader(Packet_Reader* packet_reader,
+                      BitstreamReader* audio_packet,
+                      struct reader_track* tracks,
+                      unsigned track_count,
+                      unsigned pad_2_size,
+                      unsigned flags)
+{
+    const int stereo_only = (flags & DVDA_STEREO_ONLY) != 0;
+    const int verify = (flags & DVDA_SKIP_VERIFICATION) == 0;
+    BitstreamQueue* mlp_data;
+    unsigned substream_count;
+
+    DVDA_Track_Reader* track_reader = malloc(sizeof(DVDA_Track_Reader));
+    track_reader->packet_reader = packet_reader;
+    track_reader->owns_aob_reader = 1;
+
+    track_reader->codec = DVDA_MLP;
+    track_reader->stream_finished = 0;
+    track_reader->decode_ns = 0;
+
+    track_reader->tracks = tracks;
+    track_reader->track_count = track_count;
+    track_reader->tracks_started = 1;
+    track_reader->track_read = 0;
+
+    /*FIXME - check for I/O errors?*/
+
+    /*skip initial padding*/
+    audio_packet->skip_bytes(audio_packet, pad_2_size);
+
+    mlp_data = br_open_queue(BS_BIG_ENDIAN);
+
+    track_reader->sync_bytes_scanned =
+        locate_mlp_parameters(packet_reader,
+                              audio_packet,
+                              &track_reader->parameters,
+                              &substream_count,
+                              mlp_data);
+
+    track_reader->reader.mlp.track = 0;
+    track_reader->reader.mlp.parameters = track_reader->parameters;
+    track_reader->reader.mlp.substream_count = substream_count;
+    track_reader->reader.mlp.decoder = NULL;
+    track_reader->reader.mlp.parallel_decoder = NULL;
+    track_reader->reader.mlp.segments_ahead = 0;
+    track_reader->reader.mlp.packets_finished = 0;
+    track_reader->reader.mlp.segments_taken = 0;
+
+    if (flags & DVDA_PARALLEL_DECODE) {
+        const long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        const unsigned threads = processors > 1 ? (unsigned)processors : 1;
+
+        track_reader->reader.mlp.parallel_decoder =
+            dvda_open_mlp_parallel_decoder(&(track_reader->parameters),
+                                           stereo_only,
+                                           verify,
+                                           threads);
+        track_reader->reader.mlp.segments_ahead = threads * 2;
+    }
+    if (!track_reader->reader.mlp.parallel_decoder) {
+        track_reader->reader.mlp.decoder =
+            dvda_open_mlpdecoder(&(track_reader->parameters),
+                                 stereo_only,
+                                 verify);
+    }
+
+    if (stereo_only && (substream_count == 2)) {
+        /*the decoder returns only front left and front right*/
+        track_reader->parameters.channel_assignment = 1;
+    }
+
+    /*setup initial sample buffer*/
+    track_reader->channel_data = a_int_new();
+    track_reader->channel_data_pos = 0;
+    track_reader->channel_data_start = 0;
+
+    if (track_reader->reader.mlp.parallel_decoder) {
+        /*queue remaining MLP data in packet for decoding*/
+        dvda_mlp_parallel_decoder_enqueue(
+            track_reader->reader.mlp.parallel_decoder,
+            (BitstreamReader*)mlp_data);
+    } else {
+        /*decode remaining bytes in packet to buffer*/
+        /*decode remaining MLP frames in packet to buffer*/
+        dvda_mlpdecoder_decode_packet(track_reader->reader.mlp.decoder,
+                                      (BitstreamReader*)mlp_data,
+                                      track_reader->channel_data);
+    }
 
     mlp_data->close(mlp_data);
 
     /*setup reader's methods*/
-    track_reader->decode = decode_mlp_audio;
+    track_reader->decode = track_reader->reader.mlp.parallel_decoder ?
+        decode_mlp_audio_parallel : decode_mlp_audio;
     track_reader->close = close_mlp_track_reader;
 
     return track_reader;
 }
 
 static unsigned
-decode_mlp_audio(DVDA_Track_Reader* self, aa_int* samples)
+decode_mlp_audio(DVDA_Track_Reader* self, a_int* samples)
+{
+    /*a packet may not complete any MLP frames,
+      so keep going until one does or the track is finished*/
+    while (!self->stream_finished) {
+        const unsigned pcm_frames_read = decode_mlp_packet(self, samples);
+        if (pcm_frames_read) {
+            return pcm_frames_read;
+        }
+    }
+
+    return 0;
+}
+
+static unsigned
+decode_mlp_packet(DVDA_Track_Reader* self, a_int* samples)
 {
     BitstreamReader* packet;
     unsigned sector;
 
-    if (self->stream_finished) {
-        return 0;
-    }
-
     packet = packet_reader_next_audio_packet(self->packet_reader, &sector);
 
     if (!packet) {
+        self->stream_finished = 1;
         return 0;
     }
 
     /*if the current sector is outside the track's range of sectors*/
     /*process only until the next major sync*/
-    if (sector > self->reader.mlp.last_sector) {
+    if (sector > self->tracks[self->reader.mlp.track].last_sector) {
         BitstreamQueue* mlp_data = br_open_queue(BS_BIG_ENDIAN);
-        unsigned extra_bytes = mlp_data_to_major_sync(self->packet_reader,
-                                                      packet,
-                                                      mlp_data);
+        BitstreamQueue* next_track_data = br_open_queue(BS_BIG_ENDIAN);
+        const int next_track = split_mlp_tracks(self,
+                                                packet,
+                                                mlp_data,
+                                                next_track_data);
         unsigned pcm_frames_read;
 
         packet->close(packet);
 
-        if (extra_bytes) {
-            assert(extra_bytes == mlp_data->size(mlp_data));
-
+        if (mlp_data->size(mlp_data)) {
             pcm_frames_read =
                 dvda_mlpdecoder_decode_packet(self->reader.mlp.decoder,
                                               (BitstreamReader*)mlp_data,
@@ -1186,9 +2058,23 @@ decode_mlp_audio(DVDA_Track_Reader* self, aa_int* samples)
             pcm_frames_read = 0;
         }
 
-        mlp_data->close(mlp_data);
+        if (next_track) {
+            /*the next track continues from its major sync
+              with the same decoder*/
+            start_next_track(self, samples);
+            self->reader.mlp.track += 1;
+
+            pcm_frames_read +=
+                dvda_mlpdecoder_decode_packet(
+                    self->reader.mlp.decoder,
+                    (BitstreamReader*)next_track_data,
+                    samples);
+        } else {
+            self->stream_finished = 1;
+        }
 
-        self->stream_finished = 1;
+        mlp_data->close(mlp_data);
+        next_track_data->close(next_track_data);
 
         return pcm_frames_read;
     }
@@ -1204,6 +2090,7 @@ decode_mlp_audio(DVDA_Track_Reader* self, aa_int* samples)
             /*codec mismatch in stream*/
             br_etry(packet);
             packet->close(packet);
+            self->stream_finished = 1;
             return 0;
         }
 
@@ -1218,6 +2105,119 @@ decode_mlp_audio(DVDA_Track_Reader* self, aa_int* samples)
         packet->close(packet);
 
         return pcm_frames_read;
+    } else {
+        /*I/O error reading packet*/
+        br_etry(packet);
+        packet->close(packet);
+        self->stream_finished = 1;
+        return 0;
+    }
+}
+
+static unsigned
+decode_mlp_audio_parallel(DVDA_Track_Reader* self, a_int* samples)
+{
+    MLPParallelDecoder* decoder = self->reader.mlp.parallel_decoder;
+
+    for (;;) {
+        unsigned pcm_frames_read;
+
+        /*read ahead until all the worker threads have segments to decode*/
+        while (!self->reader.mlp.packets_finished &&
+               (dvda_mlp_parallel_decoder_pending(decoder) <
+                self->reader.mlp.segments_ahead)) {
+            if (!read_ahead_mlp_packet(self)) {
+                dvda_mlp_parallel_decoder_finish(decoder);
+                self->reader.mlp.packets_finished = 1;
+            }
+        }
+
+        if (!dvda_mlp_parallel_decoder_pending(decoder)) {
+            /*all segments have been returned*/
+            start_parallel_tracks(self, samples);
+            return 0;
+        }
+
+        pcm_frames_read = dvda_mlp_parallel_decoder_take(decoder, samples);
+        self->reader.mlp.segments_taken += 1;
+        start_parallel_tracks(self, samples);
+
+        /*skip over any segments which decode to no PCM frames*/
+        if (pcm_frames_read > 0) {
+            return pcm_frames_read;
+        }
+    }
+}
+
+static int
+read_ahead_mlp_packet(DVDA_Track_Reader* self)
+{
+    MLPParallelDecoder* decoder = self->reader.mlp.parallel_decoder;
+    BitstreamReader* packet;
+    unsigned sector;
+
+    packet = packet_reader_next_audio_packet(self->packet_reader, &sector);
+
+    if (!packet) {
+        return 0;
+    }
+
+    /*if the current sector is outside the track's range of sectors*/
+    /*process only until the next major sync*/
+    if (sector > self->tracks[self->reader.mlp.track].last_sector) {
+        BitstreamQueue* mlp_data = br_open_queue(BS_BIG_ENDIAN);
+        BitstreamQueue* next_track_data = br_open_queue(BS_BIG_ENDIAN);
+        const int next_track = split_mlp_tracks(self,
+                                                packet,
+                                                mlp_data,
+                                                next_track_data);
+
+        packet->close(packet);
+
+        if (mlp_data->size(mlp_data)) {
+            dvda_mlp_parallel_decoder_enqueue(decoder,
+                                              (BitstreamReader*)mlp_data);
+        }
+
+        if (next_track) {
+            /*end the current segment at the track boundary
+              so the next track starts a segment of its own*/
+            dvda_mlp_parallel_decoder_finish(decoder);
+            self->reader.mlp.track += 1;
+            self->tracks[self->reader.mlp.track].segment =
+                self->reader.mlp.segments_taken +
+                dvda_mlp_parallel_decoder_pending(decoder);
+
+            dvda_mlp_parallel_decoder_enqueue(
+                decoder,
+                (BitstreamReader*)next_track_data);
+        }
+
+        mlp_data->close(mlp_data);
+        next_track_data->close(next_track_data);
+        return next_track;
+    }
+
+    if (!setjmp(*br_try(packet))) {
+        unsigned codec_id;
+        unsigned pad_2_size;
+
+        read_audio_packet_header(packet, &codec_id, &pad_2_size);
+
+        if (codec_id != MLP_CODEC_ID) {
+            /*codec mismatch in stream*/
+            br_etry(packet);
+            packet->close(packet);
+            return 0;
+        }
+
+        packet->skip_bytes(packet, pad_2_size);
+
+        dvda_mlp_parallel_decoder_enqueue(decoder, packet);
+
+        br_etry(packet);
+        packet->close(packet);
+        return 1;
     } else {
         /*I/O error reading packet*/
         br_etry(packet);
@@ -1229,12 +2229,67 @@ decode_mlp_audio(DVDA_Track_Reader* self, aa_int* samples)
 static void
 close_mlp_track_reader(DVDA_Track_Reader *reader)
 {
-    packet_reader_close(reader->packet_reader);
-    dvda_close_mlpdecoder(reader->reader.mlp.decoder);
+    close_packet_reader(reader);
+    if (reader->reader.mlp.parallel_decoder) {
+        dvda_close_mlp_parallel_decoder(reader->reader.mlp.parallel_decoder);
+    } else {
+        dvda_close_mlpdecoder(reader->reader.mlp.decoder);
+    }
     reader->channel_data->del(reader->channel_data);
+    free(reader->tracks);
     free(reader);
 }
 
+static void
+start_parallel_tracks(DVDA_Track_Reader* self, const a_int* samples)
+{
+    while ((self->tracks_started <= self->reader.mlp.track) &&
+           (self->tracks[self->tracks_started].segment <=
+            self->reader.mlp.segments_taken)) {
+        start_next_track(self, samples);
+    }
+}
+
+static int
+split_mlp_tracks(DVDA_Track_Reader* self,
+                 BitstreamReader* packet,
+                 BitstreamQueue* track_data,
+                 BitstreamQueue* next_track_data)
+{
+    struct stream_parameters parameters;
+    unsigned substream_count;
+
+    if ((self->reader.mlp.track + 1) == self->track_count) {
+        /*the last track ends at the next major sync*/
+        self->sync_bytes_scanned +=
+            mlp_data_to_major_sync(self->packet_reader,
+                                   packet,
+                                   track_data,
+                                   NULL);
+        return 0;
+    }
+
+    /*otherwise, the next track starts from it*/
+    self->sync_bytes_scanned +=
+        mlp_data_to_major_sync(self->packet_reader,
+                               packet,
+                               track_data,
+                               next_track_data);
+
+    if (!next_track_data->size(next_track_data)) {
+        /*no major sync found*/
+        return 0;
+    }
+
+    read_mlp_parameters(self->packet_reader,
+                        next_track_data,
+                        &parameters,
+                        &substream_count);
+
+    return (dvda_params_equal(&parameters, &self->reader.mlp.parameters) &&
+            (substream_count == self->reader.mlp.substream_count));
+}
+
 static void
 read_audio_packet_header(BitstreamReader* packet_reader,
                          unsigned *codec_id,
@@ -1242,43 +2297,54 @@ read_audio_packet_header(BitstreamReader* packet_reader,
 {
     unsigned pad_1_size;
 
-    packet_reader->parse(packet_reader, "16p 8u", &pad_1_size);
+    /*read field by field, since this is done once per audio packet*/
+    packet_reader->skip(packet_reader, 16);
+    pad_1_size = packet_reader->read(packet_reader, 8);
     packet_reader->skip_bytes(packet_reader, pad_1_size);
-    packet_reader->parse(packet_reader, "8u 8p 8p 8u", codec_id, pad_2_size);
+    *codec_id = packet_reader->read(packet_reader, 8);
+    packet_reader->skip(packet_reader, 16);
+    *pad_2_size = packet_reader->read(packet_reader, 8);
 }
 
 static int
 find_major_sync(BitstreamReader* mlp_data, unsigned *bytes_skipped)
 {
-    while (mlp_data->size(mlp_data) >= 8) {
-        unsigned sync_words;
-        unsigned stream_type;
-        br_pos_t* mlp_frame_start;
-
-        /*look for major sync*/
-        mlp_frame_start = mlp_data->getpos(mlp_data);
+    /*sync words and stream type, which follow a frame's first 4 bytes*/
+    static const uint8_t MAJOR_SYNC[] = {0xF8, 0x72, 0x6F, 0xBB};
+    uint8_t chunk[4096];
 
-        mlp_data->parse(mlp_data, "4p 12p 16p 24u 8u",
-                        &sync_words, &stream_type);
-
-        /*if major sync is found*/
-        if ((sync_words == 0xF8726F) && (stream_type == 0xBB)) {
-            /*rewind to start of frame and return success*/
-            mlp_data->setpos(mlp_data, mlp_frame_start);
-            mlp_frame_start->del(mlp_frame_start);
-
-            return 1;
-        } else {  /*if major sync is not found*/
-            /*rewind to start of data*/
-            mlp_data->setpos(mlp_data, mlp_frame_start);
-            mlp_frame_start->del(mlp_frame_start);
-
-            /*advance 1 byte*/
-            mlp_data->skip(mlp_data, 8);
-
-            /*and continue looking*/
-            *bytes_skipped += 1;
+    while (mlp_data->size(mlp_data) >= 8) {
+        const unsigned chunk_size = MIN(mlp_data->size(mlp_data),
+                                        sizeof(chunk));
+        const uint8_t* candidate = chunk + 4;
+        const uint8_t* const end = chunk + chunk_size - 3;
+        br_pos_t* chunk_start;
+
+        /*copy out a chunk of data to search with memchr
+          rather than parsing the stream 1 byte at a time*/
+        chunk_start = mlp_data->getpos(mlp_data);
+        mlp_data->read_bytes(mlp_data, chunk, chunk_size);
+        mlp_data->setpos(mlp_data, chunk_start);
+        chunk_start->del(chunk_start);
+
+        while ((candidate = memchr(candidate, 0xF8, end - candidate))) {
+            /*if major sync is found*/
+            if (!memcmp(candidate, MAJOR_SYNC, sizeof(MAJOR_SYNC))) {
+                /*advance to start of frame and return success*/
+                const unsigned skipped = (unsigned)(candidate - chunk) - 4;
+                mlp_data->skip_bytes(mlp_data, skipped);
+                *bytes_skipped += skipped;
+                DVDA_PROBE1(major__sync, *bytes_skipped);
+                return 1;
+            } else {
+                candidate++;
+            }
         }
+
+        /*no frame starts in the chunk's first "chunk_size - 7" bytes
+          so advance past them and continue looking*/
+        mlp_data->skip_bytes(mlp_data, chunk_size - 7);
+        *bytes_skipped += chunk_size - 7;
     }
 
     /*not enough data to contain a major sync*/
@@ -1319,11 +2385,11 @@ static unsigned
 locate_mlp_parameters(Packet_Reader* packet_reader,
                       BitstreamReader* packet_data,
                       struct stream_parameters* parameters,
+                      unsigned* substream_count,
                       BitstreamQueue* mlp_data)
 {
     unsigned bytes_skipped = 0;
     BitstreamReader* mlp_reader = (BitstreamReader*)mlp_data;
-    br_pos_t* mlp_frame_start;
 
     packet_data->enqueue(packet_data,
                          packet_data->size(packet_data),
@@ -1338,7 +2404,23 @@ locate_mlp_parameters(Packet_Reader* packet_reader,
         }
     }
 
-    while (mlp_data->size(mlp_data) < 18) {
+    /*finally, grab stream data after major sync*/
+    read_mlp_parameters(packet_reader, mlp_data, parameters, substream_count);
+
+    /*return amount of bytes skipped*/
+    return bytes_skipped;
+}
+
+static void
+read_mlp_parameters(Packet_Reader* packet_reader,
+                    BitstreamQueue* mlp_data,
+                    struct stream_parameters* parameters,
+                    unsigned* substream_count)
+{
+    BitstreamReader* mlp_reader = (BitstreamReader*)mlp_data;
+    br_pos_t* mlp_frame_start;
+
+    while (mlp_data->size(mlp_data) < 21) {
         if (!enqueue_mlp_packet(packet_reader, mlp_data)) {
             /*FIXME - ran out of additional packets*/
             assert(0);
@@ -1346,33 +2428,33 @@ locate_mlp_parameters(Packet_Reader* packet_reader,
         }
     }
 
-    /*finally, grab stream data after major sync*/
     mlp_frame_start = mlp_reader->getpos(mlp_reader);
     mlp_reader->parse(mlp_reader,
                       "4p 12p 16p" /*total frame size (* 2)*/
                       "24p 8p"     /*sync words, stream type*/
-                      "4u 4u 4u 4u 11p 5u 48p",
+                      "4u 4u 4u 4u 11p 5u 48p"
+                      "16p 4u",    /*VBR, peak bitrate, substream count*/
                       &parameters->group_0_bps,
                       &parameters->group_1_bps,
                       &parameters->group_0_rate,
                       &parameters->group_1_rate,
-                      &parameters->channel_assignment);
+                      &parameters->channel_assignment,
+                      substream_count);
     mlp_reader->setpos(mlp_reader, mlp_frame_start);
     mlp_frame_start->del(mlp_frame_start);
-
-    /*return amount of bytes skipped*/
-    return bytes_skipped;
 }
 
 static unsigned
 mlp_data_to_major_sync(Packet_Reader* packet_reader,
                        BitstreamReader* packet_data,
-                       BitstreamQueue* mlp_data)
+                       BitstreamQueue* mlp_data,
+                       BitstreamQueue* remainder)
 {
     BitstreamQueue* packet_queue = br_open_queue(BS_BIG_ENDIAN);
     br_pos_t* queue_start =
         packet_queue->getpos((BitstreamReader*)packet_queue);
     unsigned bytes_queued = 0;
+    int major_sync_found;
 
     unsigned codec_id;
     unsigned pad_2_size;
@@ -1396,7 +2478,9 @@ mlp_data_to_major_sync(Packet_Reader* packet_reader,
                          packet_queue);
 
     /*while no major sync is found*/
-    while (!find_major_sync((BitstreamReader*)packet_queue, &bytes_queued)) {
+    while (!(major_sync_found =
+             find_major_sync((BitstreamReader*)packet_queue,
+                             &bytes_queued))) {
         /*continue populating queue with packet data*/
         if (!enqueue_mlp_packet(packet_reader, packet_queue)) {
             /*FIXME - ran out of additional MLP packets*/
@@ -1414,83 +2498,345 @@ mlp_data_to_major_sync(Packet_Reader* packet_reader,
                           bytes_queued,
                           mlp_data);
 
+    if (remainder && major_sync_found) {
+        /*and everything from the major sync onward to remainder*/
+        packet_queue->enqueue((BitstreamReader*)packet_queue,
+                              packet_queue->size(packet_queue),
+                              remainder);
+    }
+
     packet_queue->close(packet_queue);
 
     /*then return amount actually queued*/
     return bytes_queued;
 }
 
+#ifdef EXECUTABLE
+
+/*a stress test which decodes every track of a disc on several threads
+  at once and checks each against the track decoded on its own,
+  then decodes each title with a title reader
+  and checks its PCM tracks' lengths against their own readers
+
+  usage: dvd-audio <AUDIO_TS> [threads]*/
+
+#include <pthread.h>
+
+#define STRESS_ROUNDS 4
+
+struct stress_track {
+    DVDA_Track* track;
+    unsigned pcm_frames;
+    uint32_t checksum;
+};
+
+struct stress_test {
+    struct stress_track* tracks;
+    unsigned track_count;
+
+    /*the next of track_count * STRESS_ROUNDS decodes to perform,
+      guarded by lock along with mismatches*/
+    unsigned next_decode;
+    unsigned mismatches;
+    pthread_mutex_t lock;
+};
+
+/*decodes the whole track with the given flags
+  and returns 1 on success, 0 with an error message if it can't be opened*/
+static int
+checksum_track(const DVDA_Track* track,
+               unsigned flags,
+               unsigned* pcm_frames,
+               uint32_t* checksum);
+
+static void*
+stress_worker(void* data);
+
+/*decodes the whole title with a title reader and checks that
+  its first track matches the track decoded on its own
+  if both have the same length
+  and that each PCM track ending in the next track's first sector
+  has at least the PCM frames of its PTS length, as its own reader does,
+  returning the number of tracks which don't*/
 static unsigned
-unpack_bits_per_sample(unsigned packed_field)
-{
-    switch (packed_field) {
-    case 0:
-        return 16;
-    case 1:
-        return 20;
-    case 2:
-        return 24;
-    default:
-        return 0;
+check_title_reader(DVDA_Title* title,
+                   const struct stress_track* tracks,
+                   unsigned track_count);
+
+int main(int argc, char *argv[]) {
+    DVDA* dvda;
+    struct stress_test test;
+    unsigned title_mismatches = 0;
+    unsigned open_errors = 0;
+    unsigned thread_count = 4;
+    pthread_t* threads;
+    unsigned titleset_num;
+    unsigned i;
+
+    if (argc < 2) {
+        fprintf(stderr, "*** Usage: %s <AUDIO_TS> [threads]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2) {
+        thread_count = (unsigned)strtoul(argv[2], NULL, 10);
+    }
+    if ((dvda = dvda_open(argv[1], NULL)) == NULL) {
+        fprintf(stderr, "*** Error: unable to open \"%s\"\n", argv[1]);
+        return 1;
+    }
+
+    /*gather every track on the disc and decode each on its own*/
+    test.tracks = NULL;
+    test.track_count = 0;
+    for (titleset_num = 1;
+         titleset_num <= dvda_titleset_count(dvda);
+         titleset_num++) {
+        DVDA_Titleset* titleset = dvda_open_titleset(dvda, titleset_num);
+        unsigned title_num;
+
+        if (!titleset) {
+            continue;
+        }
+        for (title_num = 1;
+             title_num <= dvda_title_count(titleset);
+             title_num++) {
+            DVDA_Title* title = dvda_open_title(titleset, title_num);
+            const unsigned title_start = test.track_count;
+            unsigned track_num;
+
+            if (!title) {
+                fprintf(stderr,
+                        "*** Error: unable to open titleset %u title %u\n",
+                        titleset_num,
+                        title_num);
+                open_errors += 1;
+                continue;
+            }
+
+            for (track_num = 1;
+                 track_num <= dvda_track_count(title);
+                 track_num++) {
+                DVDA_Track* track = dvda_open_track(title, track_num);
+                struct stress_track* stress_track;
+
+                if (!track) {
+                    fprintf(stderr,
+                            "*** Error: unable to open title %u track %u\n",
+                            title_num,
+                            track_num);
+                    open_errors += 1;
+                    continue;
+                }
+
+                test.tracks = realloc(
+                    test.tracks,
+                    sizeof(struct stress_track) * (test.track_count + 1));
+                stress_track = &test.tracks[test.track_count];
+                stress_track->track = track;
+                if (checksum_track(track,
+                                   DVDA_DEFAULT,
+                                   &stress_track->pcm_frames,
+                                   &stress_track->checksum)) {
+                    test.track_count += 1;
+                } else {
+                    dvda_close_track(track);
+                    open_errors += 1;
+                }
+            }
+            title_mismatches +=
+                check_title_reader(title,
+                                   test.tracks + title_start,
+                                   test.track_count - title_start);
+            dvda_close_title(title);
+        }
+        dvda_close_titleset(titleset);
     }
+
+    /*then decode them all again concurrently*/
+    test.next_decode = 0;
+    test.mismatches = 0;
+    pthread_mutex_init(&test.lock, NULL);
+    threads = malloc(sizeof(pthread_t) * thread_count);
+    for (i = 0; i < thread_count; i++) {
+        if (pthread_create(&threads[i], NULL, stress_worker, &test)) {
+            fprintf(stderr, "*** Error: unable to start thread\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&test.lock);
+    free(threads);
+
+    printf("%u tracks decoded %u times on %u threads with %u mismatches\n",
+           test.track_count,
+           STRESS_ROUNDS,
+           thread_count,
+           test.mismatches);
+    printf("title readers with %u mismatches\n", title_mismatches);
+    if (open_errors) {
+        printf("%u titles or tracks couldn't be opened\n", open_errors);
+    }
+
+    for (i = 0; i < test.track_count; i++) {
+        dvda_close_track(test.tracks[i].track);
+    }
+    free(test.tracks);
+    dvda_close(dvda);
+
+    return (test.mismatches || title_mismatches || open_errors) ? 1 : 0;
 }
 
-static unsigned
-unpack_sample_rate(unsigned packed_field)
-{
-    switch (packed_field) {
-    case 0:
-        return 48000;
-    case 1:
-        return 96000;
-    case 2:
-        return 192000;
-    case 8:
-        return 44100;
-    case 9:
-        return 88200;
-    case 10:
-        return 176400;
-    default:
+static int
+checksum_track(const DVDA_Track* track,
+               unsigned flags,
+               unsigned* pcm_frames,
+               uint32_t* checksum)
+{
+    DVDA_Track_Reader* reader;
+    int* buffer;
+    unsigned frames_read;
+
+    if ((reader = dvda_open_track_reader_ex(track, flags)) == NULL) {
+        fprintf(stderr, "*** Error: unable to open title %u track %u reader\n",
+                track->title_number,
+                dvda_track_number(track));
         return 0;
     }
+
+    buffer = malloc(sizeof(int) *
+                    TRACK_SINK_FRAMES *
+                    dvda_channel_count(reader));
+    *pcm_frames = 0;
+    *checksum = 2166136261u;
+    while ((frames_read = dvda_read(reader,
+                                    TRACK_SINK_FRAMES,
+                                    buffer)) > 0) {
+        const unsigned samples = frames_read * dvda_channel_count(reader);
+        unsigned i;
+        for (i = 0; i < samples; i++) {
+            *checksum = (*checksum ^ (uint32_t)buffer[i]) * 16777619u;
+        }
+        *pcm_frames += frames_read;
+    }
+
+    free(buffer);
+    dvda_close_track_reader(reader);
+    return 1;
 }
 
 static unsigned
-unpack_channel_count(unsigned packed_field)
+check_title_reader(DVDA_Title* title,
+                   const struct stress_track* tracks,
+                   unsigned track_count)
 {
-    switch (packed_field) {
-    case 0:  /*front center*/
-        return 1;
-    case 1:  /*front left, front right*/
-        return 2;
-    case 2:  /*front left, front right, back center*/
-    case 4:  /*front left, front right, LFE*/
-    case 7:  /*front left, front right, front center*/
-        return 3;
-    case 3:  /*front left, front right, back left, back right*/
-    case 5:  /*front left, front right, LFE, back center*/
-    case 8:  /*front left, front right, front center, back center*/
-    case 10: /*front left, front right, front center, LFE*/
-    case 13: /*front left, front right, front center, back center*/
-    case 15: /*front left, front right, front center, LFE*/
-        return 4;
-    case 6:  /*front left, front right, LFE, back left, back right*/
-    case 9:  /*front left, front right, front center, back left, back right*/
-    case 11: /*front left, front right, front center, LFE, back center*/
-    case 14: /*front left, front right, front center, back left, back right*/
-    case 16: /*front left, front right, front center, LFE, back center*/
-    case 18: /*front left, front right, back left, back right, LFE*/
-    case 19: /*front left, front right, back left, back right, front center*/
-        return 5;
-    case 12: /*front left, front right, front center,
-               LFE, back left, back right*/
-    case 17: /*front left, front right, front center,
-               LFE, back left, back right*/
-    case 20: /*front left, front right, back left, back right,
-               front center, LFE*/
-        return 6;
-    default:
+    DVDA_Track_Reader* reader;
+    unsigned* pcm_frames;
+    int* buffer;
+    unsigned frames_read;
+    unsigned last_track = 0;
+    uint32_t checksum = 2166136261u;
+    unsigned mismatches = 0;
+    unsigned i;
+
+    if ((track_count == 0) || (dvda_track_number(tracks[0].track) != 1)) {
+        /*nothing to compare the title reader's first track with*/
         return 0;
     }
+    if ((reader = dvda_open_title_reader(title)) == NULL) {
+        fprintf(stderr, "*** Error: unable to open title %u reader\n",
+                dvda_title_number(title));
+        return 1;
+    }
+
+    pcm_frames = calloc(dvda_track_count(title) + 1, sizeof(unsigned));
+    buffer = malloc(sizeof(int) *
+                    TRACK_SINK_FRAMES *
+                    dvda_channel_count(reader));
+    while ((frames_read = dvda_read(reader,
+                                    TRACK_SINK_FRAMES,
+                                    buffer)) > 0) {
+        last_track = dvda_reader_track_number(reader);
+        if (last_track == 1) {
+            const unsigned samples = frames_read * dvda_channel_count(reader);
+            for (i = 0; i < samples; i++) {
+                checksum = (checksum ^ (uint32_t)buffer[i]) * 16777619u;
+            }
+        }
+        pcm_frames[last_track] += frames_read;
+    }
+
+    /*a track's own reader reads past its last sector
+      if the track is short of its PTS length, but a title reader doesn't*/
+    if ((pcm_frames[1] == tracks[0].pcm_frames) &&
+        (checksum != tracks[0].checksum)) {
+        fprintf(stderr, "*** title %u track 1 differs from its own reader\n",
+                dvda_title_number(title));
+        mismatches += 1;
+    }
+
+    /*tracks after the last one reached are left for another reader,
+      as when a title's stream attributes change*/
+    for (i = 0; (dvda_codec(reader) == DVDA_PCM) && (i < track_count); i++) {
+        const unsigned number = dvda_track_number(tracks[i].track);
+        const unsigned pts_frames = (unsigned)lround(
+            (double)dvda_track_pts_length(tracks[i].track) *
+            dvda_sample_rate(reader) / PTS_PER_SECOND);
+
+        if ((number < last_track) &&
+            (title->tracks[number - 1].sector.end >=
+             title->tracks[number].sector.first) &&
+            (pcm_frames[number] < MIN(pts_frames, tracks[i].pcm_frames))) {
+            fprintf(stderr,
+                    "*** title %u track %u has %u PCM frames, not %u\n",
+                    dvda_title_number(title),
+                    number,
+                    pcm_frames[number],
+                    MIN(pts_frames, tracks[i].pcm_frames));
+            mismatches += 1;
+        }
+    }
+
+    free(buffer);
+    free(pcm_frames);
+    dvda_close_track_reader(reader);
+    return mismatches;
+}
+
+static void*
+stress_worker(void* data)
+{
+    struct stress_test* test = data;
+
+    for (;;) {
+        unsigned decode;
+        const struct stress_track* track;
+        unsigned pcm_frames;
+        uint32_t checksum;
+
+        pthread_mutex_lock(&test->lock);
+        decode = test->next_decode++;
+        pthread_mutex_unlock(&test->lock);
+
+        if (decode >= (test->track_count * STRESS_ROUNDS)) {
+            return NULL;
+        }
+
+        /*alternate rounds also run each reader's own worker threads*/
+        track = &test->tracks[decode % test->track_count];
+        if (!checksum_track(track->track,
+                            ((decode / test->track_count) % 2) ?
+                            DVDA_PARALLEL_DECODE : DVDA_DEFAULT,
+                            &pcm_frames,
+                            &checksum) ||
+            (pcm_frames != track->pcm_frames) ||
+            (checksum != track->checksum)) {
+            pthread_mutex_lock(&test->lock);
+            test->mismatches += 1;
+            pthread_mutex_unlock(&test->lock);
+        }
+    }
 }
+
+#endif
@@ -595,10 +595,39 @@ struct huffman_frequency* json_to_frequencies(const char* path,
 
 struct huffman_frequency parse_json_pair(JSON_Array* bit_list, double value);
 
+/*a single entry of a flat Huffman lookup table*/
+typedef struct {
+    int value;          /*the value of the code at the start of the index*/
+    unsigned length;    /*the length of that code in bits*/
+} huffman_lookup_t;
+
+/*given a set of huffman_frequency values,
+  the total number of frequency values
+  and BS_BIG_ENDIAN or BS_LITTLE_ENDIAN,
+  compiles the Huffman tree into a flat lookup table
+  of (1 << peek_bits) entries, where peek_bits is the longest code length
+
+  the table is indexed by the next peek_bits bits of the stream
+  (the first bit read being the most-significant bit when big-endian
+   or the least-significant bit when little-endian)
+  and yields the code's value and its actual length,
+  which suits readers that can peek at bits without consuming them
+
+  the table must be deallocated with free(table) when no longer needed
+
+  returns peek_bits on success,
+  or a negative value if there's an error
+*/
+int compile_huffman_lookup_table(huffman_lookup_t** table,
+                                 struct huffman_frequency* frequencies,
+                                 unsigned int total_frequencies,
+                                 bs_endianness endianness);
+
 int main(int argc, char* argv[]) {
     /*option handling variables*/
     static int little_endian_arg = 0;
     static int write_arg = 0;
+    static int lookup_arg = 0;
     bs_endianness endianness;
     char* input_file = NULL;
 
@@ -607,6 +636,7 @@ int main(int argc, char* argv[]) {
         {"help", no_argument, 0, 'h'},
         {"le", no_argument, &little_endian_arg, 1},
         {"write", no_argument, &write_arg, 1},
+        {"lookup", no_argument, &lookup_arg, 1},
         {0, 0, 0, 0}
     };
 
@@ -630,6 +660,8 @@ int main(int argc, char* argv[]) {
                    "generate little-endian jump table\n");
             printf("  --write                "
                    "generate a write table\n");
+            printf("  --lookup               "
+                   "generate a flat lookup table\n");
             return 0;
         case 'i':
             input_file = optarg;
@@ -652,7 +684,50 @@ int main(int argc, char* argv[]) {
 
     frequencies = json_to_frequencies(input_file, &total_frequencies);
 
-    if (!write_arg) {
+    if (lookup_arg) {
+        huffman_lookup_t* table;
+        const int peek_bits = compile_huffman_lookup_table(&table,
+                                                           frequencies,
+                                                           total_frequencies,
+                                                           endianness);
+        int index;
+
+        if (peek_bits < 0) {
+            switch (peek_bits) {
+            case HUFFMAN_MISSING_LEAF:
+                fprintf(stderr, "Huffman table missing leaf node\n");
+                free(frequencies);
+                return 1;
+            case HUFFMAN_DUPLICATE_LEAF:
+                fprintf(stderr, "Huffman table has duplicate leaf node\n");
+                free(frequencies);
+                return 1;
+            case HUFFMAN_ORPHANED_LEAF:
+                fprintf(stderr, "Huffman table has orphaned leaf nodes\n");
+                free(frequencies);
+                return 1;
+            default:
+                fprintf(stderr, "Unknown error\n");
+                free(frequencies);
+                return 1;
+            }
+        }
+
+        printf("/*indexed by the next %d bits*/\n", peek_bits);
+        printf("{\n");
+        for (index = 0; index < (1 << peek_bits); index++) {
+            printf("  {%d, %u}",
+                   table[index].value,
+                   table[index].length);
+            if (index < ((1 << peek_bits) - 1))
+                printf(",\n");
+            else
+                printf("\n");
+        }
+        printf("}\n");
+
+        free(table);
+    } else if (!write_arg) {
         br_huffman_table_t* table;
         const int total_rows = compile_br_huffman_table(&table,
                                                         frequencies,
@@ -814,4 +889,52 @@ struct huffman_frequency parse_json_pair(JSON_Array* bit_list, double value) {
     return frequency;
 }
 
+int compile_huffman_lookup_table(huffman_lookup_t** table,
+                                 struct huffman_frequency* frequencies,
+                                 unsigned int total_frequencies,
+                                 bs_endianness endianness) {
+    int error = 0;
+    struct huffman_node* tree;
+    unsigned int peek_bits = 0;
+    unsigned int i;
+    huffman_lookup_t* new_table;
+
+    /*ensure the tree is complete and well-formed before flattening it*/
+    tree = build_huffman_tree(frequencies, total_frequencies, &error);
+    if (tree == NULL)
+        return error;
+    free_huffman_tree(tree);
+
+    for (i = 0; i < total_frequencies; i++) {
+        if (frequencies[i].length > peek_bits)
+            peek_bits = frequencies[i].length;
+    }
+
+    new_table = calloc(1 << peek_bits, sizeof(huffman_lookup_t));
+
+    /*each code of "length" bits fills every index
+      whose first "length" bits match it*/
+    for (i = 0; i < total_frequencies; i++) {
+        const unsigned int length = frequencies[i].length;
+        const unsigned int padding = peek_bits - length;
+        unsigned int j;
+
+        for (j = 0; j < (1 << padding); j++) {
+            unsigned int index;
+            if (endianness == BS_BIG_ENDIAN) {
+                index = (frequencies[i].bits << padding) | j;
+            } else {
+                index = swap_bits(frequencies[i].bits, length) |
+                        (j << length);
+            }
+            new_table[index].value = frequencies[i].value;
+            new_table[index].length = length;
+        }
+    }
+
+    *table = new_table;
+
+    return peek_bits;
+}
+
 #endif
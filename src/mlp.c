@@ -17,7 +17,11 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 *******************************************************/
 
+#include <string.h>
+#include <pthread.h>
 #include "mlp.h"
+#include "clock.h"
+#include "probes.h"
 
 #define SECTOR_SIZE 2048
 
@@ -29,8 +33,39 @@
 /*6 channels + 2 matrix channels*/
 #define MAX_MLP_CHANNELS 8
 
-#define a_reset(a)((a)->reset((a)))
-#define a_del(a)((a)->del((a)))
+/*FIR and IIR filters have at most 8 taps between them*/
+#define MAX_FILTER_ORDER 8
+
+/*MLP frames hold 40 PCM frames per multiple of 48kHz or 44.1kHz,
+  so at most 160 at 192kHz, and no block may be larger than its frame*/
+#define MAX_MLP_FRAME_SIZE 160
+#define MAX_MLP_BLOCK_SIZE MAX_MLP_FRAME_SIZE
+
+/*rematrixing works through a frame this many PCM frames at a time*/
+#define REMATRIX_CHUNK_SIZE 256
+
+/*the parallel decoder only splits the stream at a restart point
+  once the current segment holds at least this many bytes*/
+#define MIN_SEGMENT_SIZE (1 << 16)
+
+/*substream sizes are 12 bit counts of 16-bit words*/
+#define MAX_MLP_SUBSTREAM_SIZE (0xFFF * 2)
+
+/*the longest code in any of the MLP Huffman codebooks*/
+#define MLP_HUFFMAN_PEEK_BITS 9
+
+/*runs STATEMENT and adds the time it takes to the given stage's total
+  when built with MLP_STAGE_TIMING, otherwise just runs STATEMENT*/
+#ifdef MLP_STAGE_TIMING
+#define TIME_STAGE(STAGE, STATEMENT)                                  \
+    do {                                                              \
+        const uint64_t stage_start = dvda_clock_ns();                 \
+        STATEMENT;                                                    \
+        dvda_mlp_stage_timing.STAGE += dvda_clock_ns() - stage_start; \
+    } while (0)
+#else
+#define TIME_STAGE(STAGE, STATEMENT) do { STATEMENT; } while (0)
+#endif
 
 /*******************************************************************
  *                      structure definitions                      *
@@ -67,19 +102,41 @@ struct matrix_parameters {
     unsigned factional_bits;
     unsigned LSB_bypass;
     int coeff[MAX_MLP_CHANNELS];
-    a_int* bypassed_LSB;
+
+    /*the bypassed LSB of each PCM frame in the current MLP frame*/
+    int bypassed_LSB[MAX_MLP_FRAME_SIZE];
 };
 
 struct filter_parameters {
+    unsigned order;
     unsigned shift;
-    a_int* coeff;
-    a_int* state;
+    int coeff[MAX_FILTER_ORDER];
+
+    /*the filter's 8 most recent state values, oldest first,
+      which are 0 until that many values have been filtered*/
+    int state[MAX_FILTER_ORDER];
 };
 
+/*a FIR/IIR prediction filter specialized for a pair of orders
+  which filters "block_size" residuals to "filtered"
+  and updates both filters' state*/
+typedef void (*filter_f)(const int* residuals,
+                         unsigned block_size,
+                         unsigned shift,
+                         unsigned quant_step_size,
+                         struct filter_parameters* FIR,
+                         struct filter_parameters* IIR,
+                         int* filtered);
+
 struct channel_parameters {
     struct filter_parameters FIR;
     struct filter_parameters IIR;
 
+    /*the filter for the current FIR and IIR orders
+      or NULL if their combined order is too large,
+      selected whenever the channel's decoding parameters change*/
+    filter_f filter;
+
     int huffman_offset;
     unsigned codebook;
     unsigned huffman_lsbs;
@@ -107,11 +164,45 @@ struct substream {
 
     struct decoding_parameters parameters;
 
-    /*residuals[c][i] where c is channel and i is PCM frame*/
-    aa_int* residuals;
+    /*residuals[c][i] where c is channel and i is PCM frame
+      for the current block*/
+    int residuals[MAX_MLP_CHANNELS][MAX_MLP_BLOCK_SIZE];
+
+    /*the number of blocks and restart headers decoded so far*/
+    uint64_t blocks_decoded;
+    uint64_t restart_headers;
+};
+
+/*the channel data of a single MLP frame, across all its substreams
 
-    /*a temporary buffer of filtered residual data*/
-    a_int* filtered;
+  channel[c][i] where c is channel and i is PCM frame
+  with len[c] PCM frames decoded so far in each channel*/
+struct framelist {
+    unsigned len[MAX_MLP_CHANNELS];
+    int channel[MAX_MLP_CHANNELS][MAX_MLP_FRAME_SIZE];
+};
+
+/*a big-endian bit reader over a substream's contiguous bytes
+
+  up to 64 bits of upcoming data are held in a local cache
+  so most reads are a shift rather than a call through
+  a BitstreamReader's methods and its byte-state tables
+
+  reading beyond the end of the data yields 0 bits
+  and sets "overrun", which the decoder checks per block*/
+struct mlp_bitreader {
+    const uint8_t* data;  /*the next byte not yet in the cache*/
+    const uint8_t* end;
+    uint64_t cache;       /*upcoming bits, most-significant first*/
+    unsigned cache_bits;  /*the number of valid bits in the cache*/
+    int overrun;
+};
+
+/*a single entry of a codebook's lookup table,
+  indexed by the next MLP_HUFFMAN_PEEK_BITS bits of the stream*/
+struct mlp_codebook_entry {
+    int8_t MSB;       /*the code's value, or -1 if invalid*/
+    uint8_t length;   /*the code's length in bits*/
 };
 
 struct MLPDecoder_s {
@@ -121,9 +212,79 @@ struct MLPDecoder_s {
     struct major_sync major_sync;
     int major_sync_read;
 
+    /*whether to decode only substream 0's stereo presentation*/
+    int stereo_only;
+
+    /*whether to check substream parity and CRC-8 when present*/
+    int verify;
+
     struct substream substream[MAX_MLP_SUBSTREAMS];
 
-    aa_int* framelist;
+    /*the bytes of the substream currently being decoded*/
+    uint8_t substream_data[MAX_MLP_SUBSTREAM_SIZE];
+
+    struct framelist framelist;
+
+    /*frames and check failures so far,
+      with blocks and restart headers counted per substream*/
+    struct mlp_decoder_stats stats;
+
+    /*frame header, major sync and substream info formats,
+      compiled once per decoder*/
+    bs_format_t* frame_header_format;
+    bs_format_t* major_sync_format;
+    bs_format_t* substream_info_format;
+};
+
+/*a run of MLP frames starting at a restart point,
+  decoded independently by one of the parallel decoder's workers*/
+struct mlp_segment {
+    uint8_t* data;
+    unsigned size;
+
+    /*interleaved output, valid once "decoded" is set*/
+    a_int* samples;
+    unsigned pcm_frames;
+    int decoded;
+
+    struct mlp_segment* next;
+};
+
+struct MLPParallelDecoder_s {
+    struct stream_parameters parameters;
+    int stereo_only;
+    int verify;
+
+    /*MLP data not yet handed off as a segment*/
+    uint8_t* data;
+    unsigned data_size;
+    unsigned data_capacity;
+
+    /*the offset of the next whole MLP frame in "data" to be scanned
+      for a restart point*/
+    unsigned scan_offset;
+
+    /*set if the stream has stopped parsing as MLP frames,
+      in which case all remaining data goes to the final segment*/
+    int scan_failed;
+
+    /*all segments handed off whose output hasn't been taken, in order,
+      and the first of those no worker has started on yet*/
+    struct mlp_segment* head;
+    struct mlp_segment* tail;
+    struct mlp_segment* next_job;
+    unsigned pending;
+
+    pthread_t* workers;
+    unsigned worker_count;
+    int closing;
+
+    /*the counts of every segment decoded so far*/
+    struct mlp_decoder_stats stats;
+
+    pthread_mutex_t lock;
+    pthread_cond_t job_available;
+    pthread_cond_t job_finished;
 };
 
 struct checkdata {
@@ -137,54 +298,72 @@ struct checkdata {
  *******************************************************************/
 
 static unsigned
-mlpdecoder_decode(MLPDecoder* decoder, aa_int* samples);
+mlpdecoder_decode(MLPDecoder* decoder, a_int* samples);
 
 /*returns a single MLP frame from the stream of MLP data
   or NULL of no more MLP frames can be retrieved*/
 static BitstreamReader*
-read_mlp_frame(BitstreamReader* mlp_data);
+read_mlp_frame(BitstreamReader* mlp_data,
+               const bs_format_t* frame_header_format);
 
 /*decodes a single MLP frame to a set of samples
   and returns the number of PCM frames decoded*/
 static unsigned
 decode_mlp_frame(MLPDecoder* decoder,
                  BitstreamReader* mlp_frame,
-                 aa_int* samples);
+                 a_int* samples);
 
 /*attemps to read a major sync from the MLP frame
   returns 1 if successful
   returns 0 if unsuccessful and leaves the stream unchanged*/
 static int
-read_major_sync(BitstreamReader *mlp_frame, struct major_sync *major_sync);
+read_major_sync(BitstreamReader *mlp_frame,
+                const bs_format_t *major_sync_format,
+                struct major_sync *major_sync);
 
 /*attempts to read a substream info block from the MLP frame*/
 static void
 read_substream_info(BitstreamReader *mlp_frame,
+                    const bs_format_t *substream_info_format,
                     struct substream_info *substream_info);
 
-/*returns a frame's substream data
-  or NULL if a parity or CRC-8 mismatch occurs*/
-static BitstreamReader*
+/*reads a frame's substream data to "data"
+  and sets up "sr" to read from it
+
+  if checkdata is present and verify is set,
+  the data's parity and CRC-8 are checked
+
+  returns 1 on success or 0 if a parity or CRC-8 mismatch occurs*/
+static int
 read_substream(BitstreamReader *mlp_frame,
                unsigned substream_length,
-               unsigned checkdata_present);
+               unsigned checkdata_present,
+               int verify,
+               uint8_t *data,
+               struct mlp_bitreader *sr);
 
 static unsigned
 decode_substream(struct substream* substream,
-                 BitstreamReader* substream_reader,
-                 aa_int* framelist);
+                 struct mlp_bitreader* sr,
+                 struct framelist* framelist);
 
+/*decodes a block of PCM frames to the end of framelist's channels,
+  where "offset" is the number of PCM frames
+  already decoded from the substream's current MLP frame
+
+  returns the block's size, or 0 if an error occurs*/
 static unsigned
 decode_block(struct substream* substream,
-             BitstreamReader* substream_reader,
-             aa_int* framelist);
+             struct mlp_bitreader* sr,
+             unsigned offset,
+             struct framelist* framelist);
 
 static int
-decode_restart_header(BitstreamReader* substream_reader,
+decode_restart_header(struct mlp_bitreader* sr,
                       struct restart_header* restart_header);
 
 static int
-decode_decoding_parameters(BitstreamReader* substream_reader,
+decode_decoding_parameters(struct mlp_bitreader* sr,
                            unsigned header_present,
                            unsigned min_channel,
                            unsigned max_channel,
@@ -192,36 +371,45 @@ decode_decoding_parameters(BitstreamReader* substream_reader,
                            struct decoding_parameters* p);
 
 static int
-decode_matrix_parameters(BitstreamReader* substream_reader,
+decode_matrix_parameters(struct mlp_bitreader* sr,
                          unsigned max_matrix_channel,
                          unsigned* matrix_len,
                          struct matrix_parameters* mp);
 
 static int
-decode_FIR_parameters(BitstreamReader* substream_reader,
+decode_FIR_parameters(struct mlp_bitreader* sr,
                       struct filter_parameters* FIR);
 
 static int
-decode_IIR_parameters(BitstreamReader* substream_reader,
+decode_IIR_parameters(struct mlp_bitreader* sr,
                       struct filter_parameters* IIR);
 
+/*reads a block's residuals and its matrices' bypassed LSBs,
+  which are placed "offset" PCM frames into each bypassed_LSB array*/
 static int
-decode_residual_data(BitstreamReader* substream_reader,
+decode_residual_data(struct mlp_bitreader* sr,
                      unsigned min_channel,
                      unsigned max_channel,
                      unsigned block_size,
+                     unsigned offset,
                      unsigned matrix_len,
-                     const struct matrix_parameters* matrix,
+                     struct matrix_parameters* matrix,
                      const unsigned* quant_step_size,
                      const struct channel_parameters* channel,
-                     aa_int* residuals);
+                     int residuals[][MAX_MLP_BLOCK_SIZE]);
+
+/*returns the filter specialized for the given FIR and IIR orders
+  or NULL if their combination is invalid*/
+static filter_f
+select_filter(unsigned FIR_order, unsigned IIR_order);
 
+/*filters "block_size" residuals to "filtered"*/
 static int
-filter_channel(const a_int* residuals,
-               struct filter_parameters* FIR,
-               struct filter_parameters* IIR,
+filter_channel(const int* residuals,
+               unsigned block_size,
+               struct channel_parameters* channel,
                unsigned quant_step_size,
-               a_int* filtered);
+               int* filtered);
 
 /*given a list of filtered residuals across all substreams
   max_matrix_channel, noise_shift, noise_gen_seed from the restart header
@@ -232,7 +420,7 @@ filter_channel(const a_int* residuals,
   when 2 substreams are present in an MLP stream,
   one typically uses the parameters from the second substream*/
 static void
-rematrix_channels(aa_int* channels,
+rematrix_channels(struct framelist* channels,
                   unsigned max_matrix_channel,
                   unsigned noise_shift,
                   unsigned* noise_gen_seed,
@@ -240,8 +428,60 @@ rematrix_channels(aa_int* channels,
                   const struct matrix_parameters* matrix,
                   const unsigned* quant_step_size);
 
+/*given a list of rematrixed channel data in MLP order,
+  applies each channel's output shift, reorders the channels
+  to RIFF WAVE order via wave_channel and appends "pcm_frames"
+  of interleaved samples to the end of "samples"
+
+  this is a single pass over the decoded data
+  which is read once and written once*/
 static void
-checkdata_callback(uint8_t byte, struct checkdata *checkdata);
+output_channels(const struct framelist* channels,
+                unsigned channel_count,
+                const int* wave_channel,
+                unsigned max_matrix_channel,
+                const unsigned* output_shift,
+                unsigned pcm_frames,
+                a_int* samples);
+
+/*updates checkdata with "size" bytes of substream data
+  which are processed 8 bytes at a time where possible*/
+static void
+update_checkdata(struct checkdata *checkdata,
+                 const uint8_t *data,
+                 unsigned size);
+
+/*returns 1 if the complete MLP frame at "frame"
+  has a major sync and restart headers in all of its substreams*/
+static int
+is_restart_point(const uint8_t* frame, unsigned frame_size);
+
+/*scans the parallel decoder's complete MLP frames
+  and hands off a segment ending at each suitable restart point*/
+static void
+split_segments(MLPParallelDecoder* decoder);
+
+/*hands off the first "size" bytes of the parallel decoder's data
+  as a new segment to be decoded*/
+static void
+dispatch_segment(MLPParallelDecoder* decoder, unsigned size);
+
+static void*
+mlp_worker(MLPParallelDecoder* decoder);
+
+static inline void
+add_mlp_stats(struct mlp_decoder_stats* total,
+              const struct mlp_decoder_stats* stats)
+{
+    total->frames += stats->frames;
+    total->blocks += stats->blocks;
+    total->restart_headers += stats->restart_headers;
+    total->check_failures += stats->check_failures;
+}
+
+#ifdef MLP_STAGE_TIMING
+struct mlp_stage_timing dvda_mlp_stage_timing;
+#endif
 
 static inline int
 mask(int x, unsigned q)
@@ -252,10 +492,143 @@ mask(int x, unsigned q)
         return (x >> q) << q;
 }
 
+static inline void
+mbr_open(struct mlp_bitreader* sr, const uint8_t* data, unsigned size)
+{
+    sr->data = data;
+    sr->end = data + size;
+    sr->cache = 0;
+    sr->cache_bits = 0;
+    sr->overrun = 0;
+}
+
+/*tops up the cache to at least 57 bits while data remains*/
+static inline void
+mbr_refill(struct mlp_bitreader* sr)
+{
+    if ((sr->end - sr->data) >= 8) {
+        /*load 8 bytes at once and keep as many whole bytes as fit
+
+          any partial byte past those is loaded again
+          with the same bits on the next refill*/
+        const uint8_t* d = sr->data;
+        const uint64_t word = (((uint64_t)d[0] << 56) |
+                               ((uint64_t)d[1] << 48) |
+                               ((uint64_t)d[2] << 40) |
+                               ((uint64_t)d[3] << 32) |
+                               ((uint64_t)d[4] << 24) |
+                               ((uint64_t)d[5] << 16) |
+                               ((uint64_t)d[6] << 8) |
+                               (uint64_t)d[7]);
+        const unsigned bytes = (64 - sr->cache_bits) >> 3;
+
+        sr->cache |= word >> sr->cache_bits;
+        sr->data += bytes;
+        sr->cache_bits += bytes << 3;
+    } else {
+        /*at the end of the substream, so load one byte at a time*/
+        while ((sr->cache_bits <= 56) && (sr->data < sr->end)) {
+            sr->cache |= (uint64_t)(*(sr->data++)) << (56 - sr->cache_bits);
+            sr->cache_bits += 8;
+        }
+    }
+}
+
+/*reads an unsigned value of up to 32 bits*/
+static inline unsigned
+mbr_read(struct mlp_bitreader* sr, unsigned bits)
+{
+    unsigned value;
+
+    if (bits == 0) {
+        return 0;
+    }
+    if (sr->cache_bits < bits) {
+        mbr_refill(sr);
+        if (sr->cache_bits < bits) {
+            /*out of data, so missing bits are read as 0*/
+            sr->overrun = 1;
+            sr->cache_bits = bits;
+        }
+    }
+    value = (unsigned)(sr->cache >> (64 - bits));
+    sr->cache <<= bits;
+    sr->cache_bits -= bits;
+    return value;
+}
+
+/*reads a two's complement signed value of up to 31 bits*/
+static inline int
+mbr_read_signed(struct mlp_bitreader* sr, unsigned bits)
+{
+    unsigned value;
+
+    if (bits == 0) {
+        /*a signed value needs at least a sign bit*/
+        sr->overrun = 1;
+        return 0;
+    }
+    value = mbr_read(sr, bits);
+    if (value & (1u << (bits - 1))) {
+        return (int)value - (1 << bits);
+    } else {
+        return (int)value;
+    }
+}
+
+/*reads a residual's Huffman-coded MSB value
+  along with the "LSB_bits" of LSB value which follow it
+
+  since the code and its LSBs are at most 9 + 24 bits
+  they always fit in the cache together,
+  so both are resolved from a single table lookup and consumed at once
+
+  returns the MSB value, or -1 if the code is invalid*/
+static inline int
+mbr_read_residual(struct mlp_bitreader* sr,
+                  const struct mlp_codebook_entry* codebook,
+                  unsigned LSB_bits,
+                  unsigned* LSB)
+{
+    const struct mlp_codebook_entry* entry;
+    unsigned total_bits;
+
+    if (sr->cache_bits < (MLP_HUFFMAN_PEEK_BITS + LSB_bits)) {
+        mbr_refill(sr);
+    }
+    entry = codebook + (sr->cache >> (64 - MLP_HUFFMAN_PEEK_BITS));
+    total_bits = entry->length + LSB_bits;
+    if (sr->cache_bits < total_bits) {
+        /*out of data, so missing bits are read as 0*/
+        sr->overrun = 1;
+        sr->cache_bits = total_bits;
+    }
+    *LSB = LSB_bits ?
+        (unsigned)((sr->cache << entry->length) >> (64 - LSB_bits)) : 0;
+    sr->cache <<= total_bits;
+    sr->cache_bits -= total_bits;
+    return entry->MSB;
+}
+
+static inline void
+mbr_byte_align(struct mlp_bitreader* sr)
+{
+    const unsigned partial_bits = sr->cache_bits % 8;
+    sr->cache <<= partial_bits;
+    sr->cache_bits -= partial_bits;
+}
+
+/*returns the number of whole bytes remaining*/
+static inline unsigned
+mbr_size(const struct mlp_bitreader* sr)
+{
+    return (unsigned)(sr->end - sr->data) + (sr->cache_bits / 8);
+}
+
 static inline unsigned
-flag_set(BitstreamReader* reader)
+flag_set(struct mlp_bitreader* sr)
 {
-    return reader->read(reader, 1);
+    return mbr_read(sr, 1);
 }
 
 /*******************************************************************
@@ -263,7 +636,9 @@ flag_set(BitstreamReader* reader)
  *******************************************************************/
 
 MLPDecoder*
-dvda_open_mlpdecoder(const struct stream_parameters* parameters)
+dvda_open_mlpdecoder(const struct stream_parameters* parameters,
+                     int stereo_only,
+                     int verify)
 {
     unsigned c;
     unsigned s;
@@ -274,34 +649,30 @@ dvda_open_mlpdecoder(const struct stream_parameters* parameters)
     decoder->mlp_data = br_open_queue(BS_BIG_ENDIAN);
 
     decoder->major_sync_read = 0;
+    decoder->stereo_only = stereo_only;
+    decoder->verify = verify;
 
-    /*initialize placeholder framelist*/
-    decoder->framelist = aa_int_new();
-    for (c = 0; c < MAX_MLP_CHANNELS; c++)
-        (void)decoder->framelist->append(decoder->framelist);
+    /*initialize empty framelist*/
+    memset(decoder->framelist.len, 0, sizeof(decoder->framelist.len));
 
-    for (s = 0; s < MAX_MLP_SUBSTREAMS; s++) {
-        unsigned m;
+    memset(&(decoder->stats), 0, sizeof(struct mlp_decoder_stats));
 
-        decoder->substream[s].residuals = aa_int_new();
-        decoder->substream[s].filtered = a_int_new();
+    decoder->frame_header_format = bs_compile_format("4p 12u 16p");
+    decoder->major_sync_format = bs_compile_format(
+        "24u 8u 4u 4u 4u 4u 11p 5u 48p 1u 15u 4u 92p");
+    decoder->substream_info_format = bs_compile_format("1u 1u 1u 1p 12u");
 
-        /*init matrix parameters*/
-        for (m = 0; m < MAX_MLP_MATRICES; m++) {
-            decoder->substream[s].parameters.matrix[m].bypassed_LSB =
-                a_int_new();
-        }
+    for (s = 0; s < MAX_MLP_SUBSTREAMS; s++) {
+        decoder->substream[s].blocks_decoded = 0;
+        decoder->substream[s].restart_headers = 0;
 
         /*init channel parameters*/
         for (c = 0; c < MAX_MLP_CHANNELS; c++) {
-            decoder->substream[s].parameters.channel[c].FIR.coeff =
-                a_int_new();
-            decoder->substream[s].parameters.channel[c].FIR.state =
-                a_int_new();
-            decoder->substream[s].parameters.channel[c].IIR.coeff =
-                a_int_new();
-            decoder->substream[s].parameters.channel[c].IIR.state =
-                a_int_new();
+            struct channel_parameters* channel =
+                &(decoder->substream[s].parameters.channel[c]);
+            memset(&(channel->FIR), 0, sizeof(struct filter_parameters));
+            memset(&(channel->IIR), 0, sizeof(struct filter_parameters));
+            channel->filter = select_filter(0, 0);
         }
     }
 
@@ -311,46 +682,231 @@ dvda_open_mlpdecoder(const struct stream_parameters* parameters)
 void
 dvda_close_mlpdecoder(MLPDecoder* decoder)
 {
-    unsigned s;
-
     decoder->mlp_data->close(decoder->mlp_data);
 
-    decoder->framelist->del(decoder->framelist);
+    free(decoder->frame_header_format);
+    free(decoder->major_sync_format);
+    free(decoder->substream_info_format);
+    free(decoder);
+}
 
+unsigned
+dvda_mlpdecoder_decode_packet(MLPDecoder* decoder,
+                              BitstreamReader* packet_reader,
+                              a_int* samples)
+{
+    packet_reader->enqueue(packet_reader,
+                           packet_reader->size(packet_reader),
+                           decoder->mlp_data);
+
+    return mlpdecoder_decode(decoder, samples);
+}
+
+void
+dvda_mlpdecoder_stats(const MLPDecoder* decoder,
+                      struct mlp_decoder_stats* stats)
+{
+    unsigned s;
+
+    add_mlp_stats(stats, &(decoder->stats));
     for (s = 0; s < MAX_MLP_SUBSTREAMS; s++) {
-        unsigned c;
-        unsigned m;
+        stats->blocks += decoder->substream[s].blocks_decoded;
+        stats->restart_headers += decoder->substream[s].restart_headers;
+    }
+}
+
+unsigned
+dvda_mlp_frame_size(const struct stream_parameters* parameters)
+{
+    /*40 PCM frames at 48kHz or 44.1kHz, doubling with each rate multiple
+      (rates 0-2 are 48kHz-192kHz, 8-10 are 44.1kHz-176.4kHz)*/
+    return 40 << (parameters->group_0_rate & 0x7);
+}
+
+unsigned
+dvda_mlp_skip_frames(BitstreamQueue* mlp_data)
+{
+    BitstreamReader* reader = (BitstreamReader*)mlp_data;
+    unsigned frames = 0;
+
+    while (mlp_data->size(mlp_data) >= 4) {
+        br_pos_t* frame_start = reader->getpos(reader);
+        unsigned total_frame_size;
 
-        a_del(decoder->substream[s].residuals);
-        a_del(decoder->substream[s].filtered);
+        reader->parse(reader, "4p 12u", &total_frame_size);
+        reader->setpos(reader, frame_start);
+        frame_start->del(frame_start);
+
+        total_frame_size *= 2;
 
-        /*free matrix parameters*/
-        for (m = 0; m < MAX_MLP_MATRICES; m++) {
-            a_del(decoder->substream[s].parameters.matrix[m].bypassed_LSB);
+        if (total_frame_size < 4) {
+            /*not a valid MLP frame, which the decoder stops at*/
+            break;
+        } else if (total_frame_size > mlp_data->size(mlp_data)) {
+            /*frame not yet complete*/
+            break;
+        } else {
+            reader->skip_bytes(reader, total_frame_size);
+            frames++;
         }
+    }
 
-        /*free channel parameters*/
-        for (c = 0; c < MAX_MLP_CHANNELS; c++) {
-            a_del(decoder->substream[s].parameters.channel[c].FIR.coeff);
-            a_del(decoder->substream[s].parameters.channel[c].FIR.state);
-            a_del(decoder->substream[s].parameters.channel[c].IIR.coeff);
-            a_del(decoder->substream[s].parameters.channel[c].IIR.state);
+    return frames;
+}
+
+MLPParallelDecoder*
+dvda_open_mlp_parallel_decoder(const struct stream_parameters* parameters,
+                               int stereo_only,
+                               int verify,
+                               unsigned threads)
+{
+    MLPParallelDecoder* decoder = malloc(sizeof(MLPParallelDecoder));
+    unsigned i;
+
+    decoder->parameters = *parameters;
+    decoder->stereo_only = stereo_only;
+    decoder->verify = verify;
+
+    decoder->data = NULL;
+    decoder->data_size = 0;
+    decoder->data_capacity = 0;
+    decoder->scan_offset = 0;
+    decoder->scan_failed = 0;
+
+    decoder->head = decoder->tail = decoder->next_job = NULL;
+    decoder->pending = 0;
+    decoder->closing = 0;
+    memset(&(decoder->stats), 0, sizeof(struct mlp_decoder_stats));
+
+    pthread_mutex_init(&decoder->lock, NULL);
+    pthread_cond_init(&decoder->job_available, NULL);
+    pthread_cond_init(&decoder->job_finished, NULL);
+
+    decoder->workers = malloc(sizeof(pthread_t) * threads);
+    decoder->worker_count = 0;
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&(decoder->workers[decoder->worker_count]),
+                           NULL,
+                           (void*(*)(void*))mlp_worker,
+                           decoder) == 0) {
+            decoder->worker_count++;
         }
     }
 
+    if (decoder->worker_count == 0) {
+        /*unable to start any workers*/
+        dvda_close_mlp_parallel_decoder(decoder);
+        return NULL;
+    }
+
+    return decoder;
+}
+
+void
+dvda_close_mlp_parallel_decoder(MLPParallelDecoder* decoder)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&decoder->lock);
+    decoder->closing = 1;
+    pthread_cond_broadcast(&decoder->job_available);
+    pthread_mutex_unlock(&decoder->lock);
+
+    for (i = 0; i < decoder->worker_count; i++) {
+        pthread_join(decoder->workers[i], NULL);
+    }
+    free(decoder->workers);
+
+    while (decoder->head) {
+        struct mlp_segment* segment = decoder->head;
+        decoder->head = segment->next;
+        free(segment->data);
+        segment->samples->del(segment->samples);
+        free(segment);
+    }
+
+    pthread_cond_destroy(&decoder->job_finished);
+    pthread_cond_destroy(&decoder->job_available);
+    pthread_mutex_destroy(&decoder->lock);
+
+    free(decoder->data);
     free(decoder);
 }
 
+void
+dvda_mlp_parallel_decoder_enqueue(MLPParallelDecoder* decoder,
+                                  BitstreamReader* packet_reader)
+{
+    const unsigned size = packet_reader->size(packet_reader);
+
+    if ((decoder->data_size + size) > decoder->data_capacity) {
+        decoder->data_capacity = MAX(decoder->data_capacity * 2,
+                                     decoder->data_size + size);
+        decoder->data = realloc(decoder->data, decoder->data_capacity);
+    }
+    packet_reader->read_bytes(packet_reader,
+                              decoder->data + decoder->data_size,
+                              size);
+    decoder->data_size += size;
+
+    split_segments(decoder);
+}
+
+void
+dvda_mlp_parallel_decoder_finish(MLPParallelDecoder* decoder)
+{
+    if (decoder->data_size) {
+        dispatch_segment(decoder, decoder->data_size);
+    }
+}
+
 unsigned
-dvda_mlpdecoder_decode_packet(MLPDecoder* decoder,
-                              BitstreamReader* packet_reader,
-                              aa_int* samples)
+dvda_mlp_parallel_decoder_pending(MLPParallelDecoder* decoder)
 {
-    packet_reader->enqueue(packet_reader,
-                           packet_reader->size(packet_reader),
-                           decoder->mlp_data);
+    return decoder->pending;
+}
 
-    return mlpdecoder_decode(decoder, samples);
+unsigned
+dvda_mlp_parallel_decoder_take(MLPParallelDecoder* decoder,
+                               a_int* samples)
+{
+    struct mlp_segment* segment;
+    unsigned pcm_frames;
+
+    pthread_mutex_lock(&decoder->lock);
+    if ((segment = decoder->head) == NULL) {
+        pthread_mutex_unlock(&decoder->lock);
+        return 0;
+    }
+    while (!segment->decoded) {
+        pthread_cond_wait(&decoder->job_finished, &decoder->lock);
+    }
+    if ((decoder->head = segment->next) == NULL) {
+        decoder->tail = NULL;
+    }
+    decoder->pending--;
+    pthread_mutex_unlock(&decoder->lock);
+
+    if (samples->len == 0) {
+        samples->swap(samples, segment->samples);
+    } else {
+        samples->extend(samples, segment->samples);
+    }
+    pcm_frames = segment->pcm_frames;
+
+    segment->samples->del(segment->samples);
+    free(segment);
+
+    return pcm_frames;
+}
+
+void
+dvda_mlp_parallel_decoder_stats(MLPParallelDecoder* decoder,
+                                struct mlp_decoder_stats* stats)
+{
+    pthread_mutex_lock(&decoder->lock);
+    add_mlp_stats(stats, &(decoder->stats));
+    pthread_mutex_unlock(&decoder->lock);
 }
 
 /*******************************************************************
@@ -358,17 +914,23 @@ dvda_mlpdecoder_decode_packet(MLPDecoder* decoder,
  *******************************************************************/
 
 static unsigned
-mlpdecoder_decode(MLPDecoder* decoder, aa_int* samples)
+mlpdecoder_decode(MLPDecoder* decoder, a_int* samples)
 {
     unsigned pcm_frames_decoded = 0;
     BitstreamReader* mlp_frame;
 
     while ((mlp_frame =
-            read_mlp_frame((BitstreamReader*)decoder->mlp_data)) != NULL) {
+            read_mlp_frame((BitstreamReader*)decoder->mlp_data,
+                           decoder->frame_header_format)) != NULL) {
         if (!setjmp(*br_try(mlp_frame))) {
-            pcm_frames_decoded += decode_mlp_frame(decoder,
-                                                   mlp_frame,
-                                                   samples);
+            unsigned frame_pcm_frames;
+
+            DVDA_PROBE1(mlp__frame__start, mlp_frame->size(mlp_frame));
+            frame_pcm_frames = decode_mlp_frame(decoder, mlp_frame, samples);
+            DVDA_PROBE1(mlp__frame__done, frame_pcm_frames);
+
+            pcm_frames_decoded += frame_pcm_frames;
+            decoder->stats.frames += 1;
             br_etry(mlp_frame);
             mlp_frame->close(mlp_frame);
         } else {
@@ -382,14 +944,17 @@ mlpdecoder_decode(MLPDecoder* decoder, aa_int* samples)
 }
 
 static BitstreamReader*
-read_mlp_frame(BitstreamReader* mlp_data)
+read_mlp_frame(BitstreamReader* mlp_data,
+               const bs_format_t* frame_header_format)
 {
     br_pos_t* start = mlp_data->getpos(mlp_data);  /*should always succeed*/
     if (!setjmp(*br_try(mlp_data))) {
         unsigned total_frame_size;
         BitstreamReader* mlp_frame;
 
-        mlp_data->parse(mlp_data, "4p 12u 16p", &total_frame_size);
+        mlp_data->parse_compiled(mlp_data,
+                                 frame_header_format,
+                                 &total_frame_size);
         total_frame_size *= 2;
         mlp_frame = mlp_data->substream(mlp_data, total_frame_size - 4);
         br_etry(mlp_data);
@@ -407,12 +972,13 @@ read_mlp_frame(BitstreamReader* mlp_data)
 static unsigned
 decode_mlp_frame(MLPDecoder* decoder,
                  BitstreamReader* mlp_frame,
-                 aa_int* samples)
+                 a_int* samples)
 {
 
     /*WAVE_CHANEL[a][c] where a is 5 bit channel assignment field
       and c is the MLP channel index
       yields the RIFF WAVE channel index*/
+    const static int STEREO_WAVE_CHANNEL[6] = {0, 1, -1, -1, -1, -1};
     const static int WAVE_CHANNEL[][6] = {
         /* 0x00 */ {  0, -1, -1, -1, -1, -1},
         /* 0x01 */ {  0,  1, -1, -1, -1, -1},
@@ -439,14 +1005,17 @@ decode_mlp_frame(MLPDecoder* decoder,
     struct major_sync major_sync;
     struct substream* substream0 = &(decoder->substream[0]);
     struct substream* substream1 = &(decoder->substream[1]);
+    struct substream* rematrix_substream;
+    const int* wave_channel;
+    unsigned channel_count;
+    int stereo_only;
     unsigned s;
-    unsigned m;
     unsigned c;
     unsigned pcm_frames[2];
-    BitstreamReader *substream_reader;
+    struct mlp_bitreader sr;
 
     /*check for major sync*/
-    if (read_major_sync(mlp_frame, &major_sync)) {
+    if (read_major_sync(mlp_frame, decoder->major_sync_format, &major_sync)) {
         if (decoder->major_sync_read) {
             /*ensure new major sync matches previously read one*/
             if (!dvda_params_equal(&(decoder->major_sync.parameters),
@@ -459,177 +1028,147 @@ decode_mlp_frame(MLPDecoder* decoder,
         }
     }
 
+    /*substream 0 of a 2 substream stream
+      carries a 2 channel presentation of the full channel set*/
+    stereo_only = (decoder->stereo_only &&
+                   (decoder->major_sync.substream_count == 2));
+
+    if (stereo_only) {
+        wave_channel = STEREO_WAVE_CHANNEL;
+    } else {
+        wave_channel =
+            WAVE_CHANNEL[decoder->major_sync.parameters.channel_assignment];
+    }
+    for (channel_count = 0;
+         (channel_count < 6) && (wave_channel[channel_count] != -1);
+         channel_count++)
+        /*count the channels in use*/;
+
     /*read 1 substream info per substream*/
     for (s = 0; s < decoder->major_sync.substream_count; s++) {
-        read_substream_info(mlp_frame, &(decoder->substream[s].info));
+        read_substream_info(mlp_frame,
+                            decoder->substream_info_format,
+                            &(decoder->substream[s].info));
         if (decoder->substream[s].info.extraword_present) {
             mlp_frame->skip(mlp_frame, 16);
         }
     }
 
     /*read substream 0, which will always be present*/
-    if ((substream_reader =
-         read_substream(mlp_frame,
+    if (!read_substream(mlp_frame,
                         substream0->info.substream_end,
-                        substream0->info.checkdata_present)) == NULL) {
-        /*error in substream's parity or CRC-8*/
-        assert(0);
+                        substream0->info.checkdata_present,
+                        decoder->verify,
+                        decoder->substream_data,
+                        &sr)) {
+        /*error in substream's parity or CRC-8,
+          which is counted rather than treated as a bug*/
+        decoder->stats.check_failures += 1;
         return 0;
     }
 
-    /*clear the bypassed LSB values in substream 0's matrix data*/
-    for (m = 0; m < MAX_MLP_MATRICES; m++)
-        a_reset(substream0->parameters.matrix[m].bypassed_LSB);
-
     /*decode substream 0 bytes to channel data*/
-    if (!setjmp(*br_try(substream_reader))) {
-        pcm_frames[0] = decode_substream(substream0,
-                                         substream_reader,
-                                         decoder->framelist);
-        br_etry(substream_reader);
-        substream_reader->close(substream_reader);
-    } else {
-        /*I/O error decoding substream*/
-        br_etry(substream_reader);
-        substream_reader->close(substream_reader);
+    if (!(pcm_frames[0] = decode_substream(substream0,
+                                           &sr,
+                                           &(decoder->framelist)))) {
+        /*I/O error decoding substream,
+          so drop any blocks it left for the next frame*/
+        memset(decoder->framelist.len, 0, sizeof(decoder->framelist.len));
         assert(0);
         return 0;
     }
 
-    if (!pcm_frames[0]) {
-        assert(0);
-        return 0;
-    }
-
-    if (decoder->major_sync.substream_count == 1) {
-        /*rematrix substream 0*/
-        rematrix_channels(decoder->framelist,
-                          substream0->header.max_matrix_channel,
-                          substream0->header.noise_shift,
-                          &(substream0->header.noise_gen_seed),
-                          substream0->parameters.matrix_len,
-                          substream0->parameters.matrix,
-                          substream0->parameters.quant_step_size);
-
-        /*apply output shifts to substream 0*/
-        for (c = 0; c <= substream0->header.max_matrix_channel; c++) {
-            const unsigned output_shift =
-                substream0->parameters.output_shift[c];
-            if (output_shift) {
-                const unsigned block_size = decoder->framelist->_[c]->len;
-                unsigned i;
-                for (i = 0; i < block_size; i++) {
-                    decoder->framelist->_[c]->_[i] <<= output_shift;
-                }
-            }
-        }
-
-        /*append rematrixed data to output in RIFF WAVE order*/
-        for (c = 0; c < samples->len; c++) {
-            a_int* out_channel = samples->_[
-                WAVE_CHANNEL[
-                    decoder->major_sync.parameters.channel_assignment][c]];
-            out_channel->extend(out_channel, decoder->framelist->_[c]);
-        }
-
-        /*clear out framelist for next run*/
-        for (c = 0; c < decoder->framelist->len; c++) {
-            decoder->framelist->_[c]->reset(decoder->framelist->_[c]);
-        }
-    } else {
+    if ((decoder->major_sync.substream_count == 2) && !stereo_only) {
         /*read substream 1*/
-        if ((substream_reader =
-             read_substream(mlp_frame,
+        if (!read_substream(mlp_frame,
                             substream1->info.substream_end -
                             substream0->info.substream_end,
-                            substream0->info.checkdata_present)) == NULL) {
-            /*error in substream's parity or CRC-8*/
-            assert(0);
+                            substream0->info.checkdata_present,
+                            decoder->verify,
+                            decoder->substream_data,
+                            &sr)) {
+            /*error in substream's parity or CRC-8,
+              so drop substream 0's blocks for the next frame*/
+            decoder->stats.check_failures += 1;
+            memset(decoder->framelist.len, 0, sizeof(decoder->framelist.len));
             return 0;
         }
 
-        /*clear the bypassed LSB values in substream 1's matrix data*/
-        for (m = 0; m < MAX_MLP_MATRICES; m++)
-            a_reset(substream1->parameters.matrix[m].bypassed_LSB);
-
         /*decode substream 1 bytes to channel data*/
-        if (!setjmp(*br_try(substream_reader))) {
-            pcm_frames[1] = decode_substream(substream1,
-                                             substream_reader,
-                                             decoder->framelist);
-            br_etry(substream_reader);
-            substream_reader->close(substream_reader);
-        } else {
-            /*I/O error decoding substream*/
-            br_etry(substream_reader);
-            substream_reader->close(substream_reader);
-            assert(0);
-            return 0;
-        }
-
-        if (!pcm_frames[1]) {
+        if (!(pcm_frames[1] = decode_substream(substream1,
+                                               &sr,
+                                               &(decoder->framelist)))) {
+            /*I/O error decoding substream,
+              so drop any blocks left for the next frame*/
+            memset(decoder->framelist.len, 0, sizeof(decoder->framelist.len));
             assert(0);
             return 0;
         }
 
-        /*rematrix substreams 0 and 1*/
-        rematrix_channels(decoder->framelist,
-                          substream1->header.max_matrix_channel,
-                          substream1->header.noise_shift,
-                          &(substream1->header.noise_gen_seed),
-                          substream1->parameters.matrix_len,
-                          substream1->parameters.matrix,
-                          substream1->parameters.quant_step_size);
-
-        /*apply output shifts to substreams 0 and 1*/
-        for (c = 0; c <= substream1->header.max_matrix_channel; c++) {
-            const unsigned output_shift =
-                substream1->parameters.output_shift[c];
-            if (output_shift) {
-                const unsigned block_size = decoder->framelist->_[c]->len;
-                unsigned i;
-                for (i = 0; i < block_size; i++) {
-                    decoder->framelist->_[c]->_[i] <<= output_shift;
-                }
-            }
-        }
+        /*rematrix substreams 0 and 1 using substream 1's parameters*/
+        rematrix_substream = substream1;
+    } else {
+        /*rematrix substream 0 using its own parameters
+          and leave any substream 1 data unread*/
+        rematrix_substream = substream0;
+    }
 
-        /*append rematrixed data to output in RIFF WAVE order*/
-        for (c = 0; c < samples->len; c++) {
-            a_int* out_channel = samples->_[
-                WAVE_CHANNEL[
-                    decoder->major_sync.parameters.channel_assignment][c]];
-            out_channel->extend(out_channel, decoder->framelist->_[c]);
+    TIME_STAGE(rematrix,
+               rematrix_channels(&(decoder->framelist),
+                                 rematrix_substream->header.max_matrix_channel,
+                                 rematrix_substream->header.noise_shift,
+                                 &(rematrix_substream->header.noise_gen_seed),
+                                 rematrix_substream->parameters.matrix_len,
+                                 rematrix_substream->parameters.matrix,
+                                 rematrix_substream->parameters.quant_step_size));
+
+    /*ensure every output channel holds a complete frame*/
+    for (c = 0; c < channel_count; c++) {
+        if (decoder->framelist.len[c] != pcm_frames[0]) {
+            pcm_frames[0] = 0;
+            break;
         }
+    }
 
-        /*clear out framelist for next run*/
-        for (c = 0; c < decoder->framelist->len; c++) {
-            decoder->framelist->_[c]->reset(decoder->framelist->_[c]);
-        }
+    /*apply output shifts and append data to output in RIFF WAVE order*/
+    if (pcm_frames[0]) {
+        TIME_STAGE(output,
+                   output_channels(&(decoder->framelist),
+                                   channel_count,
+                                   wave_channel,
+                                   rematrix_substream->header.max_matrix_channel,
+                                   rematrix_substream->parameters.output_shift,
+                                   pcm_frames[0],
+                                   samples));
     }
 
+    /*clear out framelist for next run*/
+    memset(decoder->framelist.len, 0, sizeof(decoder->framelist.len));
+
     return pcm_frames[0];
 }
 
 static int
-read_major_sync(BitstreamReader *mlp_frame, struct major_sync *major_sync)
+read_major_sync(BitstreamReader *mlp_frame,
+                const bs_format_t *major_sync_format,
+                struct major_sync *major_sync)
 {
     br_pos_t* frame_start = mlp_frame->getpos(mlp_frame);
     if (!setjmp(*br_try(mlp_frame))) {
         int valid_major_sync;
 
-        mlp_frame->parse(mlp_frame,
-                         "24u 8u 4u 4u 4u 4u 11p 5u 48p 1u 15u 4u 92p",
-                         &(major_sync->sync_words),
-                         &(major_sync->stream_type),
-                         &(major_sync->parameters.group_0_bps),
-                         &(major_sync->parameters.group_1_bps),
-                         &(major_sync->parameters.group_0_rate),
-                         &(major_sync->parameters.group_1_rate),
-                         &(major_sync->parameters.channel_assignment),
-                         &(major_sync->is_VBR),
-                         &(major_sync->peak_bitrate),
-                         &(major_sync->substream_count));
+        mlp_frame->parse_compiled(mlp_frame,
+                                  major_sync_format,
+                                  &(major_sync->sync_words),
+                                  &(major_sync->stream_type),
+                                  &(major_sync->parameters.group_0_bps),
+                                  &(major_sync->parameters.group_1_bps),
+                                  &(major_sync->parameters.group_0_rate),
+                                  &(major_sync->parameters.group_1_rate),
+                                  &(major_sync->parameters.channel_assignment),
+                                  &(major_sync->is_VBR),
+                                  &(major_sync->peak_bitrate),
+                                  &(major_sync->substream_count));
 
         br_etry(mlp_frame);
 
@@ -655,82 +1194,104 @@ read_major_sync(BitstreamReader *mlp_frame, struct major_sync *major_sync)
 
 static void
 read_substream_info(BitstreamReader *mlp_frame,
+                    const bs_format_t *substream_info_format,
                     struct substream_info *substream_info)
 {
-    mlp_frame->parse(mlp_frame,
-                     "1u 1u 1u 1p 12u",
-                     &(substream_info->extraword_present),
-                     &(substream_info->nonrestart_substream),
-                     &(substream_info->checkdata_present),
-                     &(substream_info->substream_end));
+    mlp_frame->parse_compiled(mlp_frame,
+                              substream_info_format,
+                              &(substream_info->extraword_present),
+                              &(substream_info->nonrestart_substream),
+                              &(substream_info->checkdata_present),
+                              &(substream_info->substream_end));
 
     substream_info->substream_end *= 2;
 }
 
-static BitstreamReader*
+static int
 read_substream(BitstreamReader *mlp_frame,
                unsigned substream_length,
-               unsigned checkdata_present)
+               unsigned checkdata_present,
+               int verify,
+               uint8_t *data,
+               struct mlp_bitreader *sr)
 {
     if (checkdata_present) {
         /*checkdata present, so last 2 bytes are CRC-8/parity*/
+        const unsigned data_size = substream_length - 2;
         struct checkdata checkdata = {0, 0x3C, 0};
         uint8_t parity;
         uint8_t CRC8;
-        BitstreamReader* substream;
-
-        mlp_frame->add_callback(mlp_frame,
-                                (bs_callback_f)checkdata_callback,
-                                &checkdata);
 
-        substream = mlp_frame->substream(mlp_frame, substream_length - 2);
+        if ((substream_length < 2) ||
+            (data_size > MAX_MLP_SUBSTREAM_SIZE)) {
+            /*substream can't fit in its frame*/
+            br_abort(mlp_frame);
+        }
 
-        mlp_frame->pop_callback(mlp_frame, NULL);
+        mlp_frame->read_bytes(mlp_frame, data, data_size);
 
         parity = (uint8_t)mlp_frame->read(mlp_frame, 8);
 
+        CRC8 = (uint8_t)mlp_frame->read(mlp_frame, 8);
+
+        mbr_open(sr, data, data_size);
+
+        if (!verify) {
+            return 1;
+        }
+
+        update_checkdata(&checkdata, data, data_size);
+
         if ((parity ^ checkdata.parity) != 0xA9) {
-            substream->close(substream);
             /*parity mismatch*/
             fprintf(stderr, "parity mismatch\n");
-            return NULL;
+            return 0;
         }
 
-        CRC8 = (uint8_t)mlp_frame->read(mlp_frame, 8);
-
         if (checkdata.final_crc != CRC8) {
-            substream->close(substream);
             /*CRC-8 mismatch*/
             fprintf(stderr, "CRC-8 mismatch\n");
-            return NULL;
+            return 0;
         }
 
-        return substream;
+        return 1;
     } else {
-        return mlp_frame->substream(mlp_frame, substream_length);
+        if (substream_length > MAX_MLP_SUBSTREAM_SIZE) {
+            /*substream can't fit in its frame*/
+            br_abort(mlp_frame);
+        }
+
+        mlp_frame->read_bytes(mlp_frame, data, substream_length);
+
+        mbr_open(sr, data, substream_length);
+        return 1;
     }
 }
 
 static unsigned
 decode_substream(struct substream* substream,
-                 BitstreamReader* substream_reader,
-                 aa_int* framelist)
+                 struct mlp_bitreader* sr,
+                 struct framelist* framelist)
 {
     unsigned pcm_frames_decoded = 0;
 
     do {
         const unsigned block_frames =
-            decode_block(substream, substream_reader, framelist);
-        if (block_frames > 0) {
+            decode_block(substream, sr, pcm_frames_decoded, framelist);
+        if (sr->overrun) {
+            /*ran out of substream data mid-block*/
+            return 0;
+        } else if (block_frames > 0) {
             pcm_frames_decoded += block_frames;
+            substream->blocks_decoded += 1;
         } else {
             return pcm_frames_decoded;
         }
-    } while (flag_set(substream_reader) == 0);
+    } while (flag_set(sr) == 0);
 
-    substream_reader->byte_align(substream_reader);
-    if (substream_reader->size(substream_reader) >= 4) {
-        if (substream_reader->read(substream_reader, 32) == 0xD234D234) {
+    mbr_byte_align(sr);
+    if (mbr_size(sr) >= 4) {
+        if (mbr_read(sr, 32) == 0xD234D234) {
             /*end of stream indicated*/
         }
     }
@@ -740,10 +1301,13 @@ decode_substream(struct substream* substream,
 
 static unsigned
 decode_block(struct substream* substream,
-             BitstreamReader* sr,
-             aa_int* framelist)
+             struct mlp_bitreader* sr,
+             unsigned offset,
+             struct framelist* framelist)
 {
     unsigned c;
+    int residuals_read;
+    int filtered;
 
     /*decoding parameters present*/
     if (flag_set(sr)) {
@@ -756,6 +1320,10 @@ decode_block(struct substream* substream,
                 assert(0);
                 return 0;
             }
+            substream->restart_headers += 1;
+            DVDA_PROBE2(mlp__restart__header,
+                        substream->header.min_channel,
+                        substream->header.max_channel);
         }
 
         if (!decode_decoding_parameters(sr,
@@ -770,66 +1338,85 @@ decode_block(struct substream* substream,
         }
     }
 
+    if ((offset + substream->parameters.block_size) > MAX_MLP_FRAME_SIZE) {
+        /*block runs past the end of the largest possible MLP frame*/
+        return 0;
+    }
+
     /*perform residuals decoding*/
-    if (!decode_residual_data(sr,
-                              substream->header.min_channel,
-                              substream->header.max_channel,
-                              substream->parameters.block_size,
-                              substream->parameters.matrix_len,
-                              substream->parameters.matrix,
-                              substream->parameters.quant_step_size,
-                              substream->parameters.channel,
-                              substream->residuals)) {
+    TIME_STAGE(residuals,
+               residuals_read = decode_residual_data(
+                   sr,
+                   substream->header.min_channel,
+                   substream->header.max_channel,
+                   substream->parameters.block_size,
+                   offset,
+                   substream->parameters.matrix_len,
+                   substream->parameters.matrix,
+                   substream->parameters.quant_step_size,
+                   substream->parameters.channel,
+                   substream->residuals));
+    if (!residuals_read) {
         /*error reading residuals*/
         assert(0);
         return 0;
     }
 
+    if (sr->overrun) {
+        /*ran out of data before the end of the block*/
+        return 0;
+    }
+
 
-    /*filter residuals based on FIR/IIR parameters*/
+    /*filter residuals based on FIR/IIR parameters
+      directly onto the end of the framelist*/
     for (c = substream->header.min_channel;
          c <= substream->header.max_channel;
          c++) {
-        if (!filter_channel(substream->residuals->_[c],
-                            &(substream->parameters.channel[c].FIR),
-                            &(substream->parameters.channel[c].IIR),
-                            substream->parameters.quant_step_size[c],
-                            substream->filtered)) {
+        const unsigned block_size = substream->parameters.block_size;
+
+        if ((framelist->len[c] + block_size) > MAX_MLP_FRAME_SIZE) {
+            return 0;
+        }
+
+        TIME_STAGE(filtering,
+                   filtered = filter_channel(
+                       substream->residuals[c],
+                       block_size,
+                       &(substream->parameters.channel[c]),
+                       substream->parameters.quant_step_size[c],
+                       framelist->channel[c] + framelist->len[c]));
+        if (!filtered) {
             assert(0);
             return 0;
         }
 
-        /*append filtered data to framelist*/
-        framelist->_[c]->extend(framelist->_[c], substream->filtered);
+        framelist->len[c] += block_size;
     }
 
     return substream->parameters.block_size;
 }
 
 static int
-decode_restart_header(BitstreamReader* sr,
+decode_restart_header(struct mlp_bitreader* sr,
                       struct restart_header* restart_header)
 {
     unsigned header_sync;
     unsigned noise_type;
-    unsigned output_timestamp;
-    unsigned check_data_present;
-    unsigned lossless_check;
     unsigned c;
-    unsigned unknown1;
-    unsigned unknown2;
-
-    sr->parse(sr, "13u 1u 16u 4u 4u 4u 4u 23u 19u 1u 8u 16u",
-              &header_sync, &noise_type, &output_timestamp,
-              &(restart_header->min_channel),
-              &(restart_header->max_channel),
-              &(restart_header->max_matrix_channel),
-              &(restart_header->noise_shift),
-              &(restart_header->noise_gen_seed),
-              &unknown1,
-              &check_data_present,
-              &lossless_check,
-              &unknown2);
+
+    header_sync = mbr_read(sr, 13);
+    noise_type = mbr_read(sr, 1);
+    (void)mbr_read(sr, 16);  /*output timestamp*/
+    restart_header->min_channel = mbr_read(sr, 4);
+    restart_header->max_channel = mbr_read(sr, 4);
+    restart_header->max_matrix_channel = mbr_read(sr, 4);
+    restart_header->noise_shift = mbr_read(sr, 4);
+    restart_header->noise_gen_seed = mbr_read(sr, 23);
+    (void)mbr_read(sr, 19);  /*unknown*/
+    (void)mbr_read(sr, 1);   /*check data present*/
+    (void)mbr_read(sr, 8);   /*lossless check*/
+    (void)mbr_read(sr, 16);  /*unknown*/
 
     if (header_sync != 0x18F5)
         return 0;
@@ -842,19 +1429,19 @@ decode_restart_header(BitstreamReader* sr,
 
     for (c = 0; c <= restart_header->max_matrix_channel; c++) {
         if ((restart_header->channel_assignment[c] =
-             sr->read(sr, 6)) >
+             mbr_read(sr, 6)) >
             restart_header->max_matrix_channel) {
             return 0;
         }
     }
 
-    restart_header->checksum = sr->read(sr, 8);
+    restart_header->checksum = mbr_read(sr, 8);
 
     return 1;
 }
 
 static int
-decode_decoding_parameters(BitstreamReader* sr,
+decode_decoding_parameters(struct mlp_bitreader* sr,
                            unsigned header_present,
                            unsigned min_channel,
                            unsigned max_channel,
@@ -866,15 +1453,8 @@ decode_decoding_parameters(BitstreamReader* sr,
     /*parameter presence flags*/
     if (header_present) {
         if (flag_set(sr)) {
-            sr->parse(sr, "8*1u",
-                      &(p->flags[0]),
-                      &(p->flags[1]),
-                      &(p->flags[2]),
-                      &(p->flags[3]),
-                      &(p->flags[4]),
-                      &(p->flags[5]),
-                      &(p->flags[6]),
-                      &(p->flags[7]));
+            for (c = 0; c < 8; c++)
+                p->flags[c] = flag_set(sr);
         } else {
             p->flags[0] =
             p->flags[1] =
@@ -886,20 +1466,14 @@ decode_decoding_parameters(BitstreamReader* sr,
             p->flags[7] = 1;
         }
     } else if (p->flags[0] && flag_set(sr)) {
-        sr->parse(sr, "8*1u",
-                  &(p->flags[0]),
-                  &(p->flags[1]),
-                  &(p->flags[2]),
-                  &(p->flags[3]),
-                  &(p->flags[4]),
-                  &(p->flags[5]),
-                  &(p->flags[6]),
-                  &(p->flags[7]));
+        for (c = 0; c < 8; c++)
+            p->flags[c] = flag_set(sr);
     }
 
     /*block size*/
     if (p->flags[7] && flag_set(sr)) {
-        if ((p->block_size = sr->read(sr, 9)) < 8)
+        if (((p->block_size = mbr_read(sr, 9)) < 8) ||
+            (p->block_size > MAX_MLP_BLOCK_SIZE))
             return 0;
     } else if (header_present) {
         p->block_size = 8;
@@ -920,7 +1494,7 @@ decode_decoding_parameters(BitstreamReader* sr,
     if (p->flags[5] && flag_set(sr)) {
         for (c = 0; c <= max_matrix_channel; c++)
             p->output_shift[c] =
-                sr->read_signed(sr, 4);
+                mbr_read_signed(sr, 4);
     } else if (header_present) {
         for (c = 0; c < MAX_MLP_CHANNELS; c++)
             p->output_shift[c] = 0;
@@ -929,7 +1503,7 @@ decode_decoding_parameters(BitstreamReader* sr,
     /*quant step sizes*/
     if (p->flags[4] && flag_set(sr)) {
         for (c = 0; c <= max_channel; c++) {
-            p->quant_step_size[c] = sr->read(sr, 4);
+            p->quant_step_size[c] = mbr_read(sr, 4);
         }
     } else if (header_present) {
         for (c = 0; c < MAX_MLP_CHANNELS; c++) {
@@ -948,7 +1522,7 @@ decode_decoding_parameters(BitstreamReader* sr,
             } else if (header_present) {
                 /*default FIR filter parameters*/
                 p->channel[c].FIR.shift = 0;
-                a_reset(p->channel[c].FIR.coeff);
+                p->channel[c].FIR.order = 0;
             }
 
             if (p->flags[2] && flag_set(sr)) {
@@ -959,63 +1533,69 @@ decode_decoding_parameters(BitstreamReader* sr,
             } else if (header_present) {
                 /*default IIR filter parameters*/
                 p->channel[c].IIR.shift = 0;
-                a_reset(p->channel[c].IIR.coeff);
-                a_reset(p->channel[c].IIR.state);
+                p->channel[c].IIR.order = 0;
+                memset(p->channel[c].IIR.state, 0,
+                       sizeof(p->channel[c].IIR.state));
             }
 
             if (p->flags[1] && flag_set(sr)) {
-                p->channel[c].huffman_offset = sr->read_signed(sr, 15);
+                p->channel[c].huffman_offset = mbr_read_signed(sr, 15);
             } else if (header_present) {
                 p->channel[c].huffman_offset = 0;
             }
 
             p->channel[c].codebook =
-                sr->read(sr, 2);
+                mbr_read(sr, 2);
 
-            if ((p->channel[c].huffman_lsbs = sr->read(sr, 5)) > 24) {
+            if ((p->channel[c].huffman_lsbs = mbr_read(sr, 5)) > 24) {
                 return 0;
             }
 
         } else if (header_present) {
             /*default channel parameters*/
             p->channel[c].FIR.shift = 0;
-            a_reset(p->channel[c].FIR.coeff);
+            p->channel[c].FIR.order = 0;
             p->channel[c].IIR.shift = 0;
-            a_reset(p->channel[c].IIR.coeff);
-            a_reset(p->channel[c].IIR.state);
+            p->channel[c].IIR.order = 0;
+            memset(p->channel[c].IIR.state, 0,
+                   sizeof(p->channel[c].IIR.state));
             p->channel[c].huffman_offset = 0;
             p->channel[c].codebook = 0;
             p->channel[c].huffman_lsbs = 24;
         }
+
+        /*pick the filter for the channel's FIR/IIR orders*/
+        p->channel[c].filter = select_filter(p->channel[c].FIR.order,
+                                             p->channel[c].IIR.order);
     }
 
     return 1;
 }
 
 static int
-decode_matrix_parameters(BitstreamReader* sr,
+decode_matrix_parameters(struct mlp_bitreader* sr,
                          unsigned max_matrix_channel,
                          unsigned* matrix_len,
                          struct matrix_parameters* mp)
 {
     unsigned m;
 
-    *matrix_len = sr->read(sr, 4);
+    *matrix_len = mbr_read(sr, 4);
 
     for (m = 0; m < *matrix_len; m++) {
         unsigned c;
         unsigned fractional_bits;
 
         if ((mp[m].out_channel =
-             sr->read(sr, 4)) > max_matrix_channel)
+             mbr_read(sr, 4)) > max_matrix_channel)
             return 0;
         if ((fractional_bits =
-             sr->read(sr, 4)) > 14)
+             mbr_read(sr, 4)) > 14)
             return 0;
         mp[m].LSB_bypass = flag_set(sr);
         for (c = 0; c < max_matrix_channel + 3; c++) {
             if (flag_set(sr)) {
-                const int v = sr->read_signed(sr, fractional_bits + 2);
+                const int v = mbr_read_signed(sr, fractional_bits + 2);
                 mp[m].coeff[c] = v << (14 - fractional_bits);
             } else {
                 mp[m].coeff[c] = 0;
@@ -1027,31 +1607,31 @@ decode_matrix_parameters(BitstreamReader* sr,
 }
 
 static int
-decode_FIR_parameters(BitstreamReader* sr,
+decode_FIR_parameters(struct mlp_bitreader* sr,
                       struct filter_parameters* FIR)
 {
-    const unsigned order = sr->read(sr, 4);
+    const unsigned order = mbr_read(sr, 4);
 
     if (order > 8) {
         return 0;
     } else if (order > 0) {
         unsigned coeff_bits;
 
-        FIR->shift = sr->read(sr, 4);
-        coeff_bits = sr->read(sr, 5);
+        FIR->shift = mbr_read(sr, 4);
+        coeff_bits = mbr_read(sr, 5);
 
         if ((1 <= coeff_bits) && (coeff_bits <= 16)) {
-            const unsigned coeff_shift = sr->read(sr, 3);
+            const unsigned coeff_shift = mbr_read(sr, 3);
             unsigned i;
 
             if ((coeff_bits + coeff_shift) > 16) {
                 return 0;
             }
 
-            FIR->coeff->reset(FIR->coeff);
+            FIR->order = order;
             for (i = 0; i < order; i++) {
-                const int v = sr->read_signed(sr, coeff_bits);
-                FIR->coeff->append(FIR->coeff, v << coeff_shift);
+                const int v = mbr_read_signed(sr, coeff_bits);
+                FIR->coeff[i] = v << coeff_shift;
             }
             if (flag_set(sr)) {
                 return 0;
@@ -1063,48 +1643,48 @@ decode_FIR_parameters(BitstreamReader* sr,
         }
     } else {
         FIR->shift = 0;
-        FIR->coeff->reset(FIR->coeff);
+        FIR->order = 0;
         return 1;
     }
 }
 
 static int
-decode_IIR_parameters(BitstreamReader* sr,
+decode_IIR_parameters(struct mlp_bitreader* sr,
                       struct filter_parameters* IIR)
 {
-    const unsigned order = sr->read(sr, 4);
+    const unsigned order = mbr_read(sr, 4);
 
     if (order > 8) {
         return 0;
     } else if (order > 0) {
         unsigned coeff_bits;
 
-        IIR->shift = sr->read(sr, 4);
-        coeff_bits = sr->read(sr, 5);
+        IIR->shift = mbr_read(sr, 4);
+        coeff_bits = mbr_read(sr, 5);
 
         if ((1 <= coeff_bits) && (coeff_bits <= 16)) {
-            const unsigned coeff_shift = sr->read(sr, 3);
+            const unsigned coeff_shift = mbr_read(sr, 3);
             unsigned i;
 
             if ((coeff_bits + coeff_shift) > 16) {
                 return 0;
             }
 
-            IIR->coeff->reset(IIR->coeff);
+            IIR->order = order;
             for (i = 0; i < order; i++) {
-                const int v = sr->read_signed(sr, coeff_bits);
-                IIR->coeff->append(IIR->coeff, v << coeff_shift);
+                const int v = mbr_read_signed(sr, coeff_bits);
+                IIR->coeff[i] = v << coeff_shift;
             }
-            IIR->state->reset(IIR->state);
+            memset(IIR->state, 0, sizeof(IIR->state));
             if (flag_set(sr)) {
-                const unsigned state_bits = sr->read(sr, 4);
-                const unsigned state_shift = sr->read(sr, 4);
+                const unsigned state_bits = mbr_read(sr, 4);
+                const unsigned state_shift = mbr_read(sr, 4);
 
+                /*state values are given most recent first*/
                 for (i = 0; i < order; i++) {
-                    const int v = sr->read_signed(sr, state_bits);
-                    IIR->state->append(IIR->state, v << state_shift);
+                    const int v = mbr_read_signed(sr, state_bits);
+                    IIR->state[MAX_FILTER_ORDER - 1 - i] = v << state_shift;
                 }
-                IIR->state->reverse(IIR->state);
             }
 
             return 1;
@@ -1113,44 +1693,67 @@ decode_IIR_parameters(BitstreamReader* sr,
         }
     } else {
         IIR->shift = 0;
-        IIR->coeff->reset(IIR->coeff);
-        IIR->state->reset(IIR->state);
+        IIR->order = 0;
+        memset(IIR->state, 0, sizeof(IIR->state));
         return 1;
     }
 }
 
 static int
-decode_residual_data(BitstreamReader* sr,
+decode_residual_data(struct mlp_bitreader* sr,
                      unsigned min_channel,
                      unsigned max_channel,
                      unsigned block_size,
+                     unsigned offset,
                      unsigned matrix_len,
-                     const struct matrix_parameters* matrix,
+                     struct matrix_parameters* matrix,
                      const unsigned* quant_step_size,
                      const struct channel_parameters* channel,
-                     aa_int* residuals)
+                     int residuals[][MAX_MLP_BLOCK_SIZE])
 {
     int signed_huffman_offset[MAX_MLP_CHANNELS];
     unsigned LSB_bits[MAX_MLP_CHANNELS];
-    static br_huffman_table_t mlp_codebook1[] =
+    const struct mlp_codebook_entry* codebook[MAX_MLP_CHANNELS];
+    static const struct mlp_codebook_entry
+        mlp_codebook1[1 << MLP_HUFFMAN_PEEK_BITS] =
 #include "mlp_codebook1.h"
         ;
-    static br_huffman_table_t mlp_codebook2[] =
+    static const struct mlp_codebook_entry
+        mlp_codebook2[1 << MLP_HUFFMAN_PEEK_BITS] =
 #include "mlp_codebook2.h"
         ;
-    static br_huffman_table_t mlp_codebook3[] =
+    static const struct mlp_codebook_entry
+        mlp_codebook3[1 << MLP_HUFFMAN_PEEK_BITS] =
 #include "mlp_codebook3.h"
         ;
 
+    /*a local copy of the reader's state
+      which the compiler can keep entirely in registers*/
+    struct mlp_bitreader r = *sr;
     unsigned c;
     unsigned m;
     unsigned i;
-    br_read_f read = sr->read;
-    br_read_huffman_code_f read_huffman_code = sr->read_huffman_code;
 
     /*calculate signed Huffman offset for each channel*/
     for (c = min_channel; c <= max_channel; c++) {
+        if (channel[c].huffman_lsbs < quant_step_size[c]) {
+            return 0;
+        }
         LSB_bits[c] = channel[c].huffman_lsbs - quant_step_size[c];
+        switch (channel[c].codebook) {
+        case 1:
+            codebook[c] = mlp_codebook1;
+            break;
+        case 2:
+            codebook[c] = mlp_codebook2;
+            break;
+        case 3:
+            codebook[c] = mlp_codebook3;
+            break;
+        default:
+            codebook[c] = NULL;
+            break;
+        }
         if (channel[c].codebook) {
             const int sign_shift = LSB_bits[c] + 2 - channel[c].codebook;
             if (sign_shift >= 0) {
@@ -1175,138 +1778,246 @@ decode_residual_data(BitstreamReader* sr,
         }
     }
 
-    /*reset residuals arrays*/
-    residuals->reset(residuals);
-
-    for (i = 0; i <= max_channel; i++) {
-        /*residual channels 0 to "min_channel"
-          will be initialized but not actually used*/
-        a_int* channel = residuals->append(residuals);
-        channel->resize(channel, block_size);
-    }
-
-    /*resize bypassed_LSB arrays for additional values*/
-    for (m = 0; m < matrix_len; m++) {
-        a_int* bypassed_LSB = matrix[m].bypassed_LSB;
-        bypassed_LSB->resize(bypassed_LSB, bypassed_LSB->len + block_size);
+    /*matrices not used by this block have no bypassed LSBs*/
+    for (m = matrix_len; m < MAX_MLP_MATRICES; m++) {
+        memset(matrix[m].bypassed_LSB + offset, 0, sizeof(int) * block_size);
     }
 
     for (i = 0; i < block_size; i++) {
         /*read bypassed LSBs for each matrix*/
         for (m = 0; m < matrix_len; m++) {
-            a_int* bypassed_LSB = matrix[m].bypassed_LSB;
-            if (matrix[m].LSB_bypass) {
-                a_append(bypassed_LSB, sr->read(sr, 1));
-            } else {
-                a_append(bypassed_LSB, 0);
-            }
+            matrix[m].bypassed_LSB[offset + i] =
+                matrix[m].LSB_bypass ? mbr_read(&r, 1) : 0;
         }
 
         /*read residuals for each channel*/
         for (c = min_channel; c <= max_channel; c++) {
-            a_int* residual = residuals->_[c];
             register int MSB;
-            register unsigned LSB;
+            unsigned LSB;
 
-            switch (channel[c].codebook) {
-            case 0:
+            if (codebook[c]) {
+                MSB = mbr_read_residual(&r, codebook[c], LSB_bits[c], &LSB);
+                if (MSB == -1) {
+                    *sr = r;
+                    return 0;
+                }
+            } else {
                 MSB = 0;
-                break;
-            case 1:
-                MSB = read_huffman_code(sr, mlp_codebook1);
-                break;
-            case 2:
-                MSB = read_huffman_code(sr, mlp_codebook2);
-                break;
-            case 3:
-                MSB = read_huffman_code(sr, mlp_codebook3);
-                break;
-            default:
-                MSB = -1;
-                break;
+                LSB = mbr_read(&r, LSB_bits[c]);
             }
-            if (MSB == -1)
-                return 0;
-
-            LSB = read(sr, LSB_bits[c]);
 
-            a_append(residual,
-                     ((MSB << LSB_bits[c]) +
-                      LSB +
-                      signed_huffman_offset[c]) << quant_step_size[c]);
+            residuals[c][i] = ((MSB << LSB_bits[c]) +
+                               LSB +
+                               signed_huffman_offset[c]) << quant_step_size[c];
         }
     }
 
+    *sr = r;
     return 1;
 }
 
+/*filters a block of residuals with a FIR_order/IIR_order pair
+  which are constants in each of its specializations below,
+  so the coefficient loops unroll to straight-line code
+
+  both filters' state is kept in a sliding window on the stack
+  whose first 8 values are the state from the previous block*/
+static inline void
+filter_block(const int* residuals,
+             unsigned block_size,
+             unsigned shift,
+             unsigned quant_step_size,
+             struct filter_parameters* FIR,
+             struct filter_parameters* IIR,
+             int* filtered,
+             const unsigned FIR_order,
+             const unsigned IIR_order)
+{
+    int FIR_window[MAX_FILTER_ORDER + MAX_MLP_BLOCK_SIZE];
+    int IIR_window[MAX_FILTER_ORDER + MAX_MLP_BLOCK_SIZE];
+    int FIR_coeff[MAX_FILTER_ORDER];
+    int IIR_coeff[MAX_FILTER_ORDER];
+    unsigned i;
+
+    memcpy(FIR_coeff, FIR->coeff, sizeof(FIR_coeff));
+    memcpy(IIR_coeff, IIR->coeff, sizeof(IIR_coeff));
+    memcpy(FIR_window, FIR->state, sizeof(FIR->state));
+    memcpy(IIR_window, IIR->state, sizeof(IIR->state));
+
+    for (i = 0; i < block_size; i++) {
+        /*FIR_state[-1] and IIR_state[-1] are the most recent values*/
+        const int* FIR_state = FIR_window + MAX_FILTER_ORDER + i;
+        const int* IIR_state = IIR_window + MAX_FILTER_ORDER + i;
+        register int64_t sum = 0;
+        int shifted_sum;
+        int value;
+
+        switch (FIR_order) {
+        case 8: sum += (int64_t)FIR_coeff[7] * FIR_state[-8];
+        case 7: sum += (int64_t)FIR_coeff[6] * FIR_state[-7];
+        case 6: sum += (int64_t)FIR_coeff[5] * FIR_state[-6];
+        case 5: sum += (int64_t)FIR_coeff[4] * FIR_state[-5];
+        case 4: sum += (int64_t)FIR_coeff[3] * FIR_state[-4];
+        case 3: sum += (int64_t)FIR_coeff[2] * FIR_state[-3];
+        case 2: sum += (int64_t)FIR_coeff[1] * FIR_state[-2];
+        case 1: sum += (int64_t)FIR_coeff[0] * FIR_state[-1];
+        default: break;
+        }
+
+        switch (IIR_order) {
+        case 8: sum += (int64_t)IIR_coeff[7] * IIR_state[-8];
+        case 7: sum += (int64_t)IIR_coeff[6] * IIR_state[-7];
+        case 6: sum += (int64_t)IIR_coeff[5] * IIR_state[-6];
+        case 5: sum += (int64_t)IIR_coeff[4] * IIR_state[-5];
+        case 4: sum += (int64_t)IIR_coeff[3] * IIR_state[-4];
+        case 3: sum += (int64_t)IIR_coeff[2] * IIR_state[-3];
+        case 2: sum += (int64_t)IIR_coeff[1] * IIR_state[-2];
+        case 1: sum += (int64_t)IIR_coeff[0] * IIR_state[-1];
+        default: break;
+        }
+
+        shifted_sum = (int)(sum >> shift);
+
+        value = mask(shifted_sum + residuals[i], quant_step_size);
+
+        filtered[i] = value;
+        FIR_window[MAX_FILTER_ORDER + i] = value;
+        IIR_window[MAX_FILTER_ORDER + i] = value - shifted_sum;
+    }
+
+    /*keep the 8 most recent values as state for the next block*/
+    memcpy(FIR->state, FIR_window + block_size, sizeof(FIR->state));
+    memcpy(IIR->state, IIR_window + block_size, sizeof(IIR->state));
+}
+
+#define FILTER(FIR_ORDER, IIR_ORDER)                                \
+    static void                                                     \
+    filter_##FIR_ORDER##_##IIR_ORDER(const int* residuals,          \
+                                     unsigned block_size,           \
+                                     unsigned shift,                \
+                                     unsigned quant_step_size,      \
+                                     struct filter_parameters* FIR, \
+                                     struct filter_parameters* IIR, \
+                                     int* filtered)                 \
+    {                                                               \
+        filter_block(residuals, block_size, shift, quant_step_size, \
+                     FIR, IIR, filtered, FIR_ORDER, IIR_ORDER);     \
+    }
+
+FILTER(0, 0) FILTER(0, 1) FILTER(0, 2) FILTER(0, 3) FILTER(0, 4)
+FILTER(0, 5) FILTER(0, 6) FILTER(0, 7) FILTER(0, 8)
+FILTER(1, 0) FILTER(1, 1) FILTER(1, 2) FILTER(1, 3) FILTER(1, 4)
+FILTER(1, 5) FILTER(1, 6) FILTER(1, 7)
+FILTER(2, 0) FILTER(2, 1) FILTER(2, 2) FILTER(2, 3) FILTER(2, 4)
+FILTER(2, 5) FILTER(2, 6)
+FILTER(3, 0) FILTER(3, 1) FILTER(3, 2) FILTER(3, 3) FILTER(3, 4)
+FILTER(3, 5)
+FILTER(4, 0) FILTER(4, 1) FILTER(4, 2) FILTER(4, 3) FILTER(4, 4)
+FILTER(5, 0) FILTER(5, 1) FILTER(5, 2) FILTER(5, 3)
+FILTER(6, 0) FILTER(6, 1) FILTER(6, 2)
+FILTER(7, 0) FILTER(7, 1)
+FILTER(8, 0)
+
+#undef FILTER
+
+static filter_f
+select_filter(unsigned FIR_order, unsigned IIR_order)
+{
+    /*FILTERS[FIR_order][IIR_order]*/
+    static const filter_f FILTERS[][MAX_FILTER_ORDER + 1] = {
+        {filter_0_0, filter_0_1, filter_0_2, filter_0_3, filter_0_4,
+         filter_0_5, filter_0_6, filter_0_7, filter_0_8},
+        {filter_1_0, filter_1_1, filter_1_2, filter_1_3, filter_1_4,
+         filter_1_5, filter_1_6, filter_1_7, NULL},
+        {filter_2_0, filter_2_1, filter_2_2, filter_2_3, filter_2_4,
+         filter_2_5, filter_2_6, NULL, NULL},
+        {filter_3_0, filter_3_1, filter_3_2, filter_3_3, filter_3_4,
+         filter_3_5, NULL, NULL, NULL},
+        {filter_4_0, filter_4_1, filter_4_2, filter_4_3, filter_4_4,
+         NULL, NULL, NULL, NULL},
+        {filter_5_0, filter_5_1, filter_5_2, filter_5_3,
+         NULL, NULL, NULL, NULL, NULL},
+        {filter_6_0, filter_6_1, filter_6_2,
+         NULL, NULL, NULL, NULL, NULL, NULL},
+        {filter_7_0, filter_7_1,
+         NULL, NULL, NULL, NULL, NULL, NULL, NULL},
+        {filter_8_0,
+         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL}
+    };
+
+    if ((FIR_order > MAX_FILTER_ORDER) || (IIR_order > MAX_FILTER_ORDER)) {
+        return NULL;
+    } else {
+        return FILTERS[FIR_order][IIR_order];
+    }
+}
+
 static int
-filter_channel(const a_int* residuals,
-               struct filter_parameters* FIR,
-               struct filter_parameters* IIR,
+filter_channel(const int* residuals,
+               unsigned block_size,
+               struct channel_parameters* channel,
                unsigned quant_step_size,
-               a_int* filtered)
+               int* filtered)
 {
-    const unsigned block_size = residuals->len;
-    a_int* FIR_state = FIR->state;
-    a_int* IIR_state = IIR->state;
-    a_int* FIR_coeff = FIR->coeff;
-    a_int* IIR_coeff = IIR->coeff;
-    const int FIR_order = FIR->coeff->len;
-    const int IIR_order = IIR->coeff->len;
+    const struct filter_parameters* FIR = &(channel->FIR);
+    const struct filter_parameters* IIR = &(channel->IIR);
     unsigned shift;
-    int i;
 
-    if ((FIR_order + IIR_order) > 8)
+    if (!channel->filter)
+        return 0;
+    if (block_size > MAX_MLP_BLOCK_SIZE)
         return 0;
     if ((FIR->shift > 0) && (IIR->shift > 0)) {
         if (FIR->shift != IIR->shift)
             return 0;
         shift = FIR->shift;
-    } else if (FIR_order > 0) {
+    } else if (FIR->order > 0) {
         shift = FIR->shift;
     } else {
         shift = IIR->shift;
     }
 
-    /*ensure arrays have enough space so we can use a_append*/
-    FIR_state->resize(FIR_state, FIR_state->len + block_size);
-    IIR_state->resize(IIR_state, IIR_state->len + block_size);
-    filtered->reset(filtered);
-    filtered->resize(filtered, block_size);
-
-    for (i = 0; i < block_size; i++) {
-        register int64_t sum = 0;
-        int shifted_sum;
-        int value;
-        int j;
-        int k;
-
-        for (j = 0; j < FIR_order; j++)
-            sum += (((int64_t)FIR_coeff->_[j] *
-                     (int64_t)FIR_state->_[FIR_state->len - j  - 1]));
+    channel->filter(residuals,
+                    block_size,
+                    shift,
+                    quant_step_size,
+                    &(channel->FIR),
+                    &(channel->IIR),
+                    filtered);
 
-        for (k = 0; k < IIR_order; k++)
-            sum += ((int64_t)IIR_coeff->_[k] *
-                    (int64_t)IIR_state->_[IIR_state->len - k - 1]);
-
-        shifted_sum = (int)(sum >> shift);
-
-        value = mask(shifted_sum + residuals->_[i], quant_step_size);
-
-        a_append(filtered, value);
-        a_append(FIR_state, value);
-        a_append(IIR_state, filtered->_[i] - shifted_sum);
-    }
+    return 1;
+}
 
-    FIR_state->tail(FIR_state, 8, FIR_state);
-    IIR_state->tail(IIR_state, 8, IIR_state);
+/*GCC builds an AVX2 clone of the rematrix kernel
+  alongside the generic one and picks between them at load time
+  based on the running CPU*/
+#if defined(__GNUC__) && !defined(__clang__) && \
+    defined(__x86_64__) && defined(__linux__)
+#define REMATRIX_KERNEL \
+    __attribute__((target_clones("avx2", "default"), \
+                   optimize("tree-vectorize")))
+#else
+#define REMATRIX_KERNEL
+#endif
+
+/*adds channel[i] * coeff to sum[i] for "count" samples
+
+  the products are exact 64-bit values,
+  and the loop vectorizes across samples where the CPU supports it*/
+static void REMATRIX_KERNEL
+rematrix_accumulate(int64_t* restrict sum,
+                    const int* restrict channel,
+                    int coeff,
+                    unsigned count)
+{
+    unsigned i;
 
-    return 1;
+    for (i = 0; i < count; i++)
+        sum[i] += (int64_t)channel[i] * coeff;
 }
 
 static void
-rematrix_channels(aa_int* channels,
+rematrix_channels(struct framelist* channels,
                   unsigned max_matrix_channel,
                   unsigned noise_shift,
                   unsigned* noise_gen_seed,
@@ -1314,53 +2025,267 @@ rematrix_channels(aa_int* channels,
                   const struct matrix_parameters* matrix,
                   const unsigned* quant_step_size)
 {
-    const unsigned block_size = channels->_[0]->len;
-    aa_int* noise = aa_int_new();
+    const unsigned block_size = channels->len[0];
+    int noise[2][REMATRIX_CHUNK_SIZE];
+    int64_t sum[REMATRIX_CHUNK_SIZE];
+    unsigned start;
+
+    /*since each matrix only combines values of the same PCM frame,
+      the frame is processed in fixed-size chunks
+      which need no allocated space*/
+    for (start = 0; start < block_size; start += REMATRIX_CHUNK_SIZE) {
+        const unsigned count = MIN(block_size - start, REMATRIX_CHUNK_SIZE);
+        unsigned i;
+        unsigned m;
+
+        /*generate noise channels*/
+        for (i = 0; i < count; i++) {
+            const unsigned shifted = (*noise_gen_seed >> 7) & 0xFFFF;
+            noise[0][i] = ((int8_t)(*noise_gen_seed >> 15)) << noise_shift;
+            noise[1][i] = ((int8_t)(shifted)) << noise_shift;
+            *noise_gen_seed = (((*noise_gen_seed << 16) & 0xFFFFFFFF) ^
+                               shifted ^ (shifted << 5));
+        }
+
+        /*perform channel rematrixing*/
+        for (m = 0; m < matrix_count; m++) {
+            const int* coeff = matrix[m].coeff;
+            int* output = channels->channel[matrix[m].out_channel] + start;
+            const int* bypassed_LSB = matrix[m].bypassed_LSB + start;
+            const unsigned quant = quant_step_size[matrix[m].out_channel];
+            unsigned c;
+
+            for (i = 0; i < count; i++)
+                sum[i] = 0;
+
+            for (c = 0; c <= max_matrix_channel; c++) {
+                if (coeff[c]) {
+                    rematrix_accumulate(sum,
+                                        channels->channel[c] + start,
+                                        coeff[c],
+                                        count);
+                }
+            }
+            if (coeff[max_matrix_channel + 1]) {
+                rematrix_accumulate(sum,
+                                    noise[0],
+                                    coeff[max_matrix_channel + 1],
+                                    count);
+            }
+            if (coeff[max_matrix_channel + 2]) {
+                rematrix_accumulate(sum,
+                                    noise[1],
+                                    coeff[max_matrix_channel + 2],
+                                    count);
+            }
+
+            for (i = 0; i < count; i++) {
+                output[i] = mask((int)(sum[i] >> 14), quant) +
+                            bypassed_LSB[i];
+            }
+        }
+    }
+}
+
+static void
+output_channels(const struct framelist* channels,
+                unsigned channel_count,
+                const int* wave_channel,
+                unsigned max_matrix_channel,
+                const unsigned* output_shift,
+                unsigned pcm_frames,
+                a_int* samples)
+{
+    /*channel data and output shifts indexed by RIFF WAVE channel*/
+    const int* channel_data[MAX_MLP_CHANNELS];
+    unsigned shift[MAX_MLP_CHANNELS];
+    int* output;
+    unsigned c;
     unsigned i;
-    unsigned m;
 
-    /*generate noise channels*/
-    for (i = 0; i < 2; i++) {
-        a_int* channel = noise->append(noise);
-        channel->resize(channel, block_size);
+    for (c = 0; c < channel_count; c++) {
+        channel_data[wave_channel[c]] = channels->channel[c];
+        shift[wave_channel[c]] =
+            (c <= max_matrix_channel) ? output_shift[c] : 0;
     }
-    for (i = 0; i < block_size; i++) {
-        const unsigned shifted = (*noise_gen_seed >> 7) & 0xFFFF;
-        a_append(noise->_[0],
-                 ((int8_t)(*noise_gen_seed >> 15)) << noise_shift);
-        a_append(noise->_[1],
-                 ((int8_t)(shifted)) << noise_shift);
-        *noise_gen_seed = (((*noise_gen_seed << 16) & 0xFFFFFFFF) ^
-                           shifted ^ (shifted << 5));
-    }
-
-    /*perform channel rematrixing*/
-    for (m = 0; m < matrix_count; m++) {
-        for (i = 0; i < block_size; i++) {
-            register int64_t sum = 0;
-            unsigned c;
-            for (c = 0; c <= max_matrix_channel; c++)
-                sum += ((int64_t)channels->_[c]->_[i] *
-                        (int64_t)matrix[m].coeff[c]);
-            sum += ((int64_t)noise->_[0]->_[i] *
-                    (int64_t)matrix[m].coeff[max_matrix_channel + 1]);
-            sum += ((int64_t)noise->_[1]->_[i] *
-                    (int64_t)matrix[m].coeff[max_matrix_channel + 2]);
-
-            channels->_[matrix[m].out_channel]->_[i] =
-                mask((int)(sum >> 14),
-                     quant_step_size[matrix[m].out_channel]) +
-                matrix[m].bypassed_LSB->_[i];
+
+    samples->resize_for(samples, pcm_frames * channel_count);
+    output = samples->_ + samples->len;
+
+    switch (channel_count) {
+    case 2:
+        /*stereo is common enough to be worth its own loop*/
+        for (i = 0; i < pcm_frames; i++) {
+            output[0] = channel_data[0][i] << shift[0];
+            output[1] = channel_data[1][i] << shift[1];
+            output += 2;
+        }
+        break;
+    default:
+        for (i = 0; i < pcm_frames; i++) {
+            for (c = 0; c < channel_count; c++) {
+                output[c] = channel_data[c][i] << shift[c];
+            }
+            output += channel_count;
         }
+        break;
     }
 
-    noise->del(noise);
+    samples->len += pcm_frames * channel_count;
+}
+
+static int
+is_restart_point(const uint8_t* frame, unsigned frame_size)
+{
+    unsigned substream_count;
+    unsigned offset;
+    unsigned s;
+
+    /*the 4 byte frame header is followed by a 28 byte major sync*/
+    if ((frame_size < 32) ||
+        (frame[4] != 0xF8) || (frame[5] != 0x72) ||
+        (frame[6] != 0x6F) || (frame[7] != 0xBB)) {
+        return 0;
+    }
+
+    substream_count = frame[20] >> 4;
+    if ((substream_count != 1) && (substream_count != 2)) {
+        return 0;
+    }
+
+    /*followed by 1 substream info per substream*/
+    for (offset = 32, s = 0; s < substream_count; s++) {
+        if ((offset + 2) > frame_size) {
+            return 0;
+        }
+        if (frame[offset] & 0x40) {
+            /*substream has no restart header*/
+            return 0;
+        }
+        offset += (frame[offset] & 0x80) ? 4 : 2;
+    }
+
+    return 1;
 }
 
 static void
-checkdata_callback(uint8_t byte, struct checkdata *checkdata)
+split_segments(MLPParallelDecoder* decoder)
 {
-    const static uint8_t CRC8[] =
+    while (!decoder->scan_failed &&
+           ((decoder->scan_offset + 4) <= decoder->data_size)) {
+        const uint8_t* frame = decoder->data + decoder->scan_offset;
+        const unsigned frame_size = (((frame[0] & 0x0F) << 8) | frame[1]) * 2;
+
+        if (frame_size < 4) {
+            /*not an MLP frame, so stop looking for restart points*/
+            decoder->scan_failed = 1;
+            return;
+        }
+        if ((decoder->scan_offset + frame_size) > decoder->data_size) {
+            /*wait for the rest of the frame*/
+            return;
+        }
+
+        if ((decoder->scan_offset >= MIN_SEGMENT_SIZE) &&
+            is_restart_point(frame, frame_size)) {
+            dispatch_segment(decoder, decoder->scan_offset);
+        }
+
+        decoder->scan_offset += frame_size;
+    }
+}
+
+static void
+dispatch_segment(MLPParallelDecoder* decoder, unsigned size)
+{
+    struct mlp_segment* segment = malloc(sizeof(struct mlp_segment));
+
+    segment->data = malloc(size);
+    memcpy(segment->data, decoder->data, size);
+    segment->size = size;
+    segment->samples = a_int_new();
+    segment->pcm_frames = 0;
+    segment->decoded = 0;
+    segment->next = NULL;
+
+    /*remove segment's data from the start of the stream*/
+    memmove(decoder->data, decoder->data + size, decoder->data_size - size);
+    decoder->data_size -= size;
+    decoder->scan_offset -= MIN(size, decoder->scan_offset);
+
+    pthread_mutex_lock(&decoder->lock);
+    if (decoder->tail) {
+        decoder->tail->next = segment;
+    } else {
+        decoder->head = segment;
+    }
+    decoder->tail = segment;
+    if (!decoder->next_job) {
+        decoder->next_job = segment;
+    }
+    decoder->pending++;
+    pthread_cond_signal(&decoder->job_available);
+    pthread_mutex_unlock(&decoder->lock);
+}
+
+static void*
+mlp_worker(MLPParallelDecoder* decoder)
+{
+    pthread_mutex_lock(&decoder->lock);
+    for (;;) {
+        struct mlp_segment* segment;
+        MLPDecoder* mlp_decoder;
+        BitstreamReader* segment_reader;
+        struct mlp_decoder_stats segment_stats = {0, 0, 0, 0};
+
+        while (!decoder->next_job && !decoder->closing) {
+            pthread_cond_wait(&decoder->job_available, &decoder->lock);
+        }
+        if (decoder->closing) {
+            break;
+        }
+        segment = decoder->next_job;
+        decoder->next_job = segment->next;
+        pthread_mutex_unlock(&decoder->lock);
+
+        /*each segment starts at a restart point
+          so a fresh decoder yields the same output
+          as one which has decoded all the preceding segments*/
+        mlp_decoder = dvda_open_mlpdecoder(&(decoder->parameters),
+                                           decoder->stereo_only,
+                                           decoder->verify);
+        segment_reader = br_open_buffer(segment->data,
+                                        segment->size,
+                                        BS_BIG_ENDIAN);
+        segment->pcm_frames =
+            dvda_mlpdecoder_decode_packet(mlp_decoder,
+                                          segment_reader,
+                                          segment->samples);
+        segment_reader->close(segment_reader);
+        dvda_mlpdecoder_stats(mlp_decoder, &segment_stats);
+        dvda_close_mlpdecoder(mlp_decoder);
+
+        free(segment->data);
+        segment->data = NULL;
+
+        pthread_mutex_lock(&decoder->lock);
+        add_mlp_stats(&(decoder->stats), &segment_stats);
+        segment->decoded = 1;
+        pthread_cond_broadcast(&decoder->job_finished);
+    }
+    pthread_mutex_unlock(&decoder->lock);
+
+    return NULL;
+}
+
+static void
+update_checkdata(struct checkdata *checkdata,
+                 const uint8_t *data,
+                 unsigned size)
+{
+    /*CRC8[n][x] is x run through the byte-wise CRC-8 table n + 1 times
+      which is the contribution of a byte with n more bytes following it*/
+    static const uint8_t CRC8[8][256] = {
         {0x00, 0x63, 0xC6, 0xA5, 0xEF, 0x8C, 0x29, 0x4A,
          0xBD, 0xDE, 0x7B, 0x18, 0x52, 0x31, 0x94, 0xF7,
          0x19, 0x7A, 0xDF, 0xBC, 0xF6, 0x95, 0x30, 0x53,
@@ -1392,8 +2317,264 @@ checkdata_callback(uint8_t byte, struct checkdata *checkdata)
          0x9E, 0xFD, 0x58, 0x3B, 0x71, 0x12, 0xB7, 0xD4,
          0x23, 0x40, 0xE5, 0x86, 0xCC, 0xAF, 0x0A, 0x69,
          0x87, 0xE4, 0x41, 0x22, 0x68, 0x0B, 0xAE, 0xCD,
-         0x3A, 0x59, 0xFC, 0x9F, 0xD5, 0xB6, 0x13, 0x70};
+         0x3A, 0x59, 0xFC, 0x9F, 0xD5, 0xB6, 0x13, 0x70},
+        {0x00, 0xF3, 0x85, 0x76, 0x69, 0x9A, 0xEC, 0x1F,
+         0xD2, 0x21, 0x57, 0xA4, 0xBB, 0x48, 0x3E, 0xCD,
+         0xC7, 0x34, 0x42, 0xB1, 0xAE, 0x5D, 0x2B, 0xD8,
+         0x15, 0xE6, 0x90, 0x63, 0x7C, 0x8F, 0xF9, 0x0A,
+         0xED, 0x1E, 0x68, 0x9B, 0x84, 0x77, 0x01, 0xF2,
+         0x3F, 0xCC, 0xBA, 0x49, 0x56, 0xA5, 0xD3, 0x20,
+         0x2A, 0xD9, 0xAF, 0x5C, 0x43, 0xB0, 0xC6, 0x35,
+         0xF8, 0x0B, 0x7D, 0x8E, 0x91, 0x62, 0x14, 0xE7,
+         0xB9, 0x4A, 0x3C, 0xCF, 0xD0, 0x23, 0x55, 0xA6,
+         0x6B, 0x98, 0xEE, 0x1D, 0x02, 0xF1, 0x87, 0x74,
+         0x7E, 0x8D, 0xFB, 0x08, 0x17, 0xE4, 0x92, 0x61,
+         0xAC, 0x5F, 0x29, 0xDA, 0xC5, 0x36, 0x40, 0xB3,
+         0x54, 0xA7, 0xD1, 0x22, 0x3D, 0xCE, 0xB8, 0x4B,
+         0x86, 0x75, 0x03, 0xF0, 0xEF, 0x1C, 0x6A, 0x99,
+         0x93, 0x60, 0x16, 0xE5, 0xFA, 0x09, 0x7F, 0x8C,
+         0x41, 0xB2, 0xC4, 0x37, 0x28, 0xDB, 0xAD, 0x5E,
+         0x11, 0xE2, 0x94, 0x67, 0x78, 0x8B, 0xFD, 0x0E,
+         0xC3, 0x30, 0x46, 0xB5, 0xAA, 0x59, 0x2F, 0xDC,
+         0xD6, 0x25, 0x53, 0xA0, 0xBF, 0x4C, 0x3A, 0xC9,
+         0x04, 0xF7, 0x81, 0x72, 0x6D, 0x9E, 0xE8, 0x1B,
+         0xFC, 0x0F, 0x79, 0x8A, 0x95, 0x66, 0x10, 0xE3,
+         0x2E, 0xDD, 0xAB, 0x58, 0x47, 0xB4, 0xC2, 0x31,
+         0x3B, 0xC8, 0xBE, 0x4D, 0x52, 0xA1, 0xD7, 0x24,
+         0xE9, 0x1A, 0x6C, 0x9F, 0x80, 0x73, 0x05, 0xF6,
+         0xA8, 0x5B, 0x2D, 0xDE, 0xC1, 0x32, 0x44, 0xB7,
+         0x7A, 0x89, 0xFF, 0x0C, 0x13, 0xE0, 0x96, 0x65,
+         0x6F, 0x9C, 0xEA, 0x19, 0x06, 0xF5, 0x83, 0x70,
+         0xBD, 0x4E, 0x38, 0xCB, 0xD4, 0x27, 0x51, 0xA2,
+         0x45, 0xB6, 0xC0, 0x33, 0x2C, 0xDF, 0xA9, 0x5A,
+         0x97, 0x64, 0x12, 0xE1, 0xFE, 0x0D, 0x7B, 0x88,
+         0x82, 0x71, 0x07, 0xF4, 0xEB, 0x18, 0x6E, 0x9D,
+         0x50, 0xA3, 0xD5, 0x26, 0x39, 0xCA, 0xBC, 0x4F},
+        {0x00, 0x22, 0x44, 0x66, 0x88, 0xAA, 0xCC, 0xEE,
+         0x73, 0x51, 0x37, 0x15, 0xFB, 0xD9, 0xBF, 0x9D,
+         0xE6, 0xC4, 0xA2, 0x80, 0x6E, 0x4C, 0x2A, 0x08,
+         0x95, 0xB7, 0xD1, 0xF3, 0x1D, 0x3F, 0x59, 0x7B,
+         0xAF, 0x8D, 0xEB, 0xC9, 0x27, 0x05, 0x63, 0x41,
+         0xDC, 0xFE, 0x98, 0xBA, 0x54, 0x76, 0x10, 0x32,
+         0x49, 0x6B, 0x0D, 0x2F, 0xC1, 0xE3, 0x85, 0xA7,
+         0x3A, 0x18, 0x7E, 0x5C, 0xB2, 0x90, 0xF6, 0xD4,
+         0x3D, 0x1F, 0x79, 0x5B, 0xB5, 0x97, 0xF1, 0xD3,
+         0x4E, 0x6C, 0x0A, 0x28, 0xC6, 0xE4, 0x82, 0xA0,
+         0xDB, 0xF9, 0x9F, 0xBD, 0x53, 0x71, 0x17, 0x35,
+         0xA8, 0x8A, 0xEC, 0xCE, 0x20, 0x02, 0x64, 0x46,
+         0x92, 0xB0, 0xD6, 0xF4, 0x1A, 0x38, 0x5E, 0x7C,
+         0xE1, 0xC3, 0xA5, 0x87, 0x69, 0x4B, 0x2D, 0x0F,
+         0x74, 0x56, 0x30, 0x12, 0xFC, 0xDE, 0xB8, 0x9A,
+         0x07, 0x25, 0x43, 0x61, 0x8F, 0xAD, 0xCB, 0xE9,
+         0x7A, 0x58, 0x3E, 0x1C, 0xF2, 0xD0, 0xB6, 0x94,
+         0x09, 0x2B, 0x4D, 0x6F, 0x81, 0xA3, 0xC5, 0xE7,
+         0x9C, 0xBE, 0xD8, 0xFA, 0x14, 0x36, 0x50, 0x72,
+         0xEF, 0xCD, 0xAB, 0x89, 0x67, 0x45, 0x23, 0x01,
+         0xD5, 0xF7, 0x91, 0xB3, 0x5D, 0x7F, 0x19, 0x3B,
+         0xA6, 0x84, 0xE2, 0xC0, 0x2E, 0x0C, 0x6A, 0x48,
+         0x33, 0x11, 0x77, 0x55, 0xBB, 0x99, 0xFF, 0xDD,
+         0x40, 0x62, 0x04, 0x26, 0xC8, 0xEA, 0x8C, 0xAE,
+         0x47, 0x65, 0x03, 0x21, 0xCF, 0xED, 0x8B, 0xA9,
+         0x34, 0x16, 0x70, 0x52, 0xBC, 0x9E, 0xF8, 0xDA,
+         0xA1, 0x83, 0xE5, 0xC7, 0x29, 0x0B, 0x6D, 0x4F,
+         0xD2, 0xF0, 0x96, 0xB4, 0x5A, 0x78, 0x1E, 0x3C,
+         0xE8, 0xCA, 0xAC, 0x8E, 0x60, 0x42, 0x24, 0x06,
+         0x9B, 0xB9, 0xDF, 0xFD, 0x13, 0x31, 0x57, 0x75,
+         0x0E, 0x2C, 0x4A, 0x68, 0x86, 0xA4, 0xC2, 0xE0,
+         0x7D, 0x5F, 0x39, 0x1B, 0xF5, 0xD7, 0xB1, 0x93},
+        {0x00, 0xF4, 0x8B, 0x7F, 0x75, 0x81, 0xFE, 0x0A,
+         0xEA, 0x1E, 0x61, 0x95, 0x9F, 0x6B, 0x14, 0xE0,
+         0xB7, 0x43, 0x3C, 0xC8, 0xC2, 0x36, 0x49, 0xBD,
+         0x5D, 0xA9, 0xD6, 0x22, 0x28, 0xDC, 0xA3, 0x57,
+         0x0D, 0xF9, 0x86, 0x72, 0x78, 0x8C, 0xF3, 0x07,
+         0xE7, 0x13, 0x6C, 0x98, 0x92, 0x66, 0x19, 0xED,
+         0xBA, 0x4E, 0x31, 0xC5, 0xCF, 0x3B, 0x44, 0xB0,
+         0x50, 0xA4, 0xDB, 0x2F, 0x25, 0xD1, 0xAE, 0x5A,
+         0x1A, 0xEE, 0x91, 0x65, 0x6F, 0x9B, 0xE4, 0x10,
+         0xF0, 0x04, 0x7B, 0x8F, 0x85, 0x71, 0x0E, 0xFA,
+         0xAD, 0x59, 0x26, 0xD2, 0xD8, 0x2C, 0x53, 0xA7,
+         0x47, 0xB3, 0xCC, 0x38, 0x32, 0xC6, 0xB9, 0x4D,
+         0x17, 0xE3, 0x9C, 0x68, 0x62, 0x96, 0xE9, 0x1D,
+         0xFD, 0x09, 0x76, 0x82, 0x88, 0x7C, 0x03, 0xF7,
+         0xA0, 0x54, 0x2B, 0xDF, 0xD5, 0x21, 0x5E, 0xAA,
+         0x4A, 0xBE, 0xC1, 0x35, 0x3F, 0xCB, 0xB4, 0x40,
+         0x34, 0xC0, 0xBF, 0x4B, 0x41, 0xB5, 0xCA, 0x3E,
+         0xDE, 0x2A, 0x55, 0xA1, 0xAB, 0x5F, 0x20, 0xD4,
+         0x83, 0x77, 0x08, 0xFC, 0xF6, 0x02, 0x7D, 0x89,
+         0x69, 0x9D, 0xE2, 0x16, 0x1C, 0xE8, 0x97, 0x63,
+         0x39, 0xCD, 0xB2, 0x46, 0x4C, 0xB8, 0xC7, 0x33,
+         0xD3, 0x27, 0x58, 0xAC, 0xA6, 0x52, 0x2D, 0xD9,
+         0x8E, 0x7A, 0x05, 0xF1, 0xFB, 0x0F, 0x70, 0x84,
+         0x64, 0x90, 0xEF, 0x1B, 0x11, 0xE5, 0x9A, 0x6E,
+         0x2E, 0xDA, 0xA5, 0x51, 0x5B, 0xAF, 0xD0, 0x24,
+         0xC4, 0x30, 0x4F, 0xBB, 0xB1, 0x45, 0x3A, 0xCE,
+         0x99, 0x6D, 0x12, 0xE6, 0xEC, 0x18, 0x67, 0x93,
+         0x73, 0x87, 0xF8, 0x0C, 0x06, 0xF2, 0x8D, 0x79,
+         0x23, 0xD7, 0xA8, 0x5C, 0x56, 0xA2, 0xDD, 0x29,
+         0xC9, 0x3D, 0x42, 0xB6, 0xBC, 0x48, 0x37, 0xC3,
+         0x94, 0x60, 0x1F, 0xEB, 0xE1, 0x15, 0x6A, 0x9E,
+         0x7E, 0x8A, 0xF5, 0x01, 0x0B, 0xFF, 0x80, 0x74},
+        {0x00, 0x68, 0xD0, 0xB8, 0xC3, 0xAB, 0x13, 0x7B,
+         0xE5, 0x8D, 0x35, 0x5D, 0x26, 0x4E, 0xF6, 0x9E,
+         0xA9, 0xC1, 0x79, 0x11, 0x6A, 0x02, 0xBA, 0xD2,
+         0x4C, 0x24, 0x9C, 0xF4, 0x8F, 0xE7, 0x5F, 0x37,
+         0x31, 0x59, 0xE1, 0x89, 0xF2, 0x9A, 0x22, 0x4A,
+         0xD4, 0xBC, 0x04, 0x6C, 0x17, 0x7F, 0xC7, 0xAF,
+         0x98, 0xF0, 0x48, 0x20, 0x5B, 0x33, 0x8B, 0xE3,
+         0x7D, 0x15, 0xAD, 0xC5, 0xBE, 0xD6, 0x6E, 0x06,
+         0x62, 0x0A, 0xB2, 0xDA, 0xA1, 0xC9, 0x71, 0x19,
+         0x87, 0xEF, 0x57, 0x3F, 0x44, 0x2C, 0x94, 0xFC,
+         0xCB, 0xA3, 0x1B, 0x73, 0x08, 0x60, 0xD8, 0xB0,
+         0x2E, 0x46, 0xFE, 0x96, 0xED, 0x85, 0x3D, 0x55,
+         0x53, 0x3B, 0x83, 0xEB, 0x90, 0xF8, 0x40, 0x28,
+         0xB6, 0xDE, 0x66, 0x0E, 0x75, 0x1D, 0xA5, 0xCD,
+         0xFA, 0x92, 0x2A, 0x42, 0x39, 0x51, 0xE9, 0x81,
+         0x1F, 0x77, 0xCF, 0xA7, 0xDC, 0xB4, 0x0C, 0x64,
+         0xC4, 0xAC, 0x14, 0x7C, 0x07, 0x6F, 0xD7, 0xBF,
+         0x21, 0x49, 0xF1, 0x99, 0xE2, 0x8A, 0x32, 0x5A,
+         0x6D, 0x05, 0xBD, 0xD5, 0xAE, 0xC6, 0x7E, 0x16,
+         0x88, 0xE0, 0x58, 0x30, 0x4B, 0x23, 0x9B, 0xF3,
+         0xF5, 0x9D, 0x25, 0x4D, 0x36, 0x5E, 0xE6, 0x8E,
+         0x10, 0x78, 0xC0, 0xA8, 0xD3, 0xBB, 0x03, 0x6B,
+         0x5C, 0x34, 0x8C, 0xE4, 0x9F, 0xF7, 0x4F, 0x27,
+         0xB9, 0xD1, 0x69, 0x01, 0x7A, 0x12, 0xAA, 0xC2,
+         0xA6, 0xCE, 0x76, 0x1E, 0x65, 0x0D, 0xB5, 0xDD,
+         0x43, 0x2B, 0x93, 0xFB, 0x80, 0xE8, 0x50, 0x38,
+         0x0F, 0x67, 0xDF, 0xB7, 0xCC, 0xA4, 0x1C, 0x74,
+         0xEA, 0x82, 0x3A, 0x52, 0x29, 0x41, 0xF9, 0x91,
+         0x97, 0xFF, 0x47, 0x2F, 0x54, 0x3C, 0x84, 0xEC,
+         0x72, 0x1A, 0xA2, 0xCA, 0xB1, 0xD9, 0x61, 0x09,
+         0x3E, 0x56, 0xEE, 0x86, 0xFD, 0x95, 0x2D, 0x45,
+         0xDB, 0xB3, 0x0B, 0x63, 0x18, 0x70, 0xC8, 0xA0},
+        {0x00, 0xEB, 0xB5, 0x5E, 0x09, 0xE2, 0xBC, 0x57,
+         0x12, 0xF9, 0xA7, 0x4C, 0x1B, 0xF0, 0xAE, 0x45,
+         0x24, 0xCF, 0x91, 0x7A, 0x2D, 0xC6, 0x98, 0x73,
+         0x36, 0xDD, 0x83, 0x68, 0x3F, 0xD4, 0x8A, 0x61,
+         0x48, 0xA3, 0xFD, 0x16, 0x41, 0xAA, 0xF4, 0x1F,
+         0x5A, 0xB1, 0xEF, 0x04, 0x53, 0xB8, 0xE6, 0x0D,
+         0x6C, 0x87, 0xD9, 0x32, 0x65, 0x8E, 0xD0, 0x3B,
+         0x7E, 0x95, 0xCB, 0x20, 0x77, 0x9C, 0xC2, 0x29,
+         0x90, 0x7B, 0x25, 0xCE, 0x99, 0x72, 0x2C, 0xC7,
+         0x82, 0x69, 0x37, 0xDC, 0x8B, 0x60, 0x3E, 0xD5,
+         0xB4, 0x5F, 0x01, 0xEA, 0xBD, 0x56, 0x08, 0xE3,
+         0xA6, 0x4D, 0x13, 0xF8, 0xAF, 0x44, 0x1A, 0xF1,
+         0xD8, 0x33, 0x6D, 0x86, 0xD1, 0x3A, 0x64, 0x8F,
+         0xCA, 0x21, 0x7F, 0x94, 0xC3, 0x28, 0x76, 0x9D,
+         0xFC, 0x17, 0x49, 0xA2, 0xF5, 0x1E, 0x40, 0xAB,
+         0xEE, 0x05, 0x5B, 0xB0, 0xE7, 0x0C, 0x52, 0xB9,
+         0x43, 0xA8, 0xF6, 0x1D, 0x4A, 0xA1, 0xFF, 0x14,
+         0x51, 0xBA, 0xE4, 0x0F, 0x58, 0xB3, 0xED, 0x06,
+         0x67, 0x8C, 0xD2, 0x39, 0x6E, 0x85, 0xDB, 0x30,
+         0x75, 0x9E, 0xC0, 0x2B, 0x7C, 0x97, 0xC9, 0x22,
+         0x0B, 0xE0, 0xBE, 0x55, 0x02, 0xE9, 0xB7, 0x5C,
+         0x19, 0xF2, 0xAC, 0x47, 0x10, 0xFB, 0xA5, 0x4E,
+         0x2F, 0xC4, 0x9A, 0x71, 0x26, 0xCD, 0x93, 0x78,
+         0x3D, 0xD6, 0x88, 0x63, 0x34, 0xDF, 0x81, 0x6A,
+         0xD3, 0x38, 0x66, 0x8D, 0xDA, 0x31, 0x6F, 0x84,
+         0xC1, 0x2A, 0x74, 0x9F, 0xC8, 0x23, 0x7D, 0x96,
+         0xF7, 0x1C, 0x42, 0xA9, 0xFE, 0x15, 0x4B, 0xA0,
+         0xE5, 0x0E, 0x50, 0xBB, 0xEC, 0x07, 0x59, 0xB2,
+         0x9B, 0x70, 0x2E, 0xC5, 0x92, 0x79, 0x27, 0xCC,
+         0x89, 0x62, 0x3C, 0xD7, 0x80, 0x6B, 0x35, 0xDE,
+         0xBF, 0x54, 0x0A, 0xE1, 0xB6, 0x5D, 0x03, 0xE8,
+         0xAD, 0x46, 0x18, 0xF3, 0xA4, 0x4F, 0x11, 0xFA},
+        {0x00, 0x86, 0x6F, 0xE9, 0xDE, 0x58, 0xB1, 0x37,
+         0xDF, 0x59, 0xB0, 0x36, 0x01, 0x87, 0x6E, 0xE8,
+         0xDD, 0x5B, 0xB2, 0x34, 0x03, 0x85, 0x6C, 0xEA,
+         0x02, 0x84, 0x6D, 0xEB, 0xDC, 0x5A, 0xB3, 0x35,
+         0xD9, 0x5F, 0xB6, 0x30, 0x07, 0x81, 0x68, 0xEE,
+         0x06, 0x80, 0x69, 0xEF, 0xD8, 0x5E, 0xB7, 0x31,
+         0x04, 0x82, 0x6B, 0xED, 0xDA, 0x5C, 0xB5, 0x33,
+         0xDB, 0x5D, 0xB4, 0x32, 0x05, 0x83, 0x6A, 0xEC,
+         0xD1, 0x57, 0xBE, 0x38, 0x0F, 0x89, 0x60, 0xE6,
+         0x0E, 0x88, 0x61, 0xE7, 0xD0, 0x56, 0xBF, 0x39,
+         0x0C, 0x8A, 0x63, 0xE5, 0xD2, 0x54, 0xBD, 0x3B,
+         0xD3, 0x55, 0xBC, 0x3A, 0x0D, 0x8B, 0x62, 0xE4,
+         0x08, 0x8E, 0x67, 0xE1, 0xD6, 0x50, 0xB9, 0x3F,
+         0xD7, 0x51, 0xB8, 0x3E, 0x09, 0x8F, 0x66, 0xE0,
+         0xD5, 0x53, 0xBA, 0x3C, 0x0B, 0x8D, 0x64, 0xE2,
+         0x0A, 0x8C, 0x65, 0xE3, 0xD4, 0x52, 0xBB, 0x3D,
+         0xC1, 0x47, 0xAE, 0x28, 0x1F, 0x99, 0x70, 0xF6,
+         0x1E, 0x98, 0x71, 0xF7, 0xC0, 0x46, 0xAF, 0x29,
+         0x1C, 0x9A, 0x73, 0xF5, 0xC2, 0x44, 0xAD, 0x2B,
+         0xC3, 0x45, 0xAC, 0x2A, 0x1D, 0x9B, 0x72, 0xF4,
+         0x18, 0x9E, 0x77, 0xF1, 0xC6, 0x40, 0xA9, 0x2F,
+         0xC7, 0x41, 0xA8, 0x2E, 0x19, 0x9F, 0x76, 0xF0,
+         0xC5, 0x43, 0xAA, 0x2C, 0x1B, 0x9D, 0x74, 0xF2,
+         0x1A, 0x9C, 0x75, 0xF3, 0xC4, 0x42, 0xAB, 0x2D,
+         0x10, 0x96, 0x7F, 0xF9, 0xCE, 0x48, 0xA1, 0x27,
+         0xCF, 0x49, 0xA0, 0x26, 0x11, 0x97, 0x7E, 0xF8,
+         0xCD, 0x4B, 0xA2, 0x24, 0x13, 0x95, 0x7C, 0xFA,
+         0x12, 0x94, 0x7D, 0xFB, 0xCC, 0x4A, 0xA3, 0x25,
+         0xC9, 0x4F, 0xA6, 0x20, 0x17, 0x91, 0x78, 0xFE,
+         0x16, 0x90, 0x79, 0xFF, 0xC8, 0x4E, 0xA7, 0x21,
+         0x14, 0x92, 0x7B, 0xFD, 0xCA, 0x4C, 0xA5, 0x23,
+         0xCB, 0x4D, 0xA4, 0x22, 0x15, 0x93, 0x7A, 0xFC},
+        {0x00, 0xE1, 0xA1, 0x40, 0x21, 0xC0, 0x80, 0x61,
+         0x42, 0xA3, 0xE3, 0x02, 0x63, 0x82, 0xC2, 0x23,
+         0x84, 0x65, 0x25, 0xC4, 0xA5, 0x44, 0x04, 0xE5,
+         0xC6, 0x27, 0x67, 0x86, 0xE7, 0x06, 0x46, 0xA7,
+         0x6B, 0x8A, 0xCA, 0x2B, 0x4A, 0xAB, 0xEB, 0x0A,
+         0x29, 0xC8, 0x88, 0x69, 0x08, 0xE9, 0xA9, 0x48,
+         0xEF, 0x0E, 0x4E, 0xAF, 0xCE, 0x2F, 0x6F, 0x8E,
+         0xAD, 0x4C, 0x0C, 0xED, 0x8C, 0x6D, 0x2D, 0xCC,
+         0xD6, 0x37, 0x77, 0x96, 0xF7, 0x16, 0x56, 0xB7,
+         0x94, 0x75, 0x35, 0xD4, 0xB5, 0x54, 0x14, 0xF5,
+         0x52, 0xB3, 0xF3, 0x12, 0x73, 0x92, 0xD2, 0x33,
+         0x10, 0xF1, 0xB1, 0x50, 0x31, 0xD0, 0x90, 0x71,
+         0xBD, 0x5C, 0x1C, 0xFD, 0x9C, 0x7D, 0x3D, 0xDC,
+         0xFF, 0x1E, 0x5E, 0xBF, 0xDE, 0x3F, 0x7F, 0x9E,
+         0x39, 0xD8, 0x98, 0x79, 0x18, 0xF9, 0xB9, 0x58,
+         0x7B, 0x9A, 0xDA, 0x3B, 0x5A, 0xBB, 0xFB, 0x1A,
+         0xCF, 0x2E, 0x6E, 0x8F, 0xEE, 0x0F, 0x4F, 0xAE,
+         0x8D, 0x6C, 0x2C, 0xCD, 0xAC, 0x4D, 0x0D, 0xEC,
+         0x4B, 0xAA, 0xEA, 0x0B, 0x6A, 0x8B, 0xCB, 0x2A,
+         0x09, 0xE8, 0xA8, 0x49, 0x28, 0xC9, 0x89, 0x68,
+         0xA4, 0x45, 0x05, 0xE4, 0x85, 0x64, 0x24, 0xC5,
+         0xE6, 0x07, 0x47, 0xA6, 0xC7, 0x26, 0x66, 0x87,
+         0x20, 0xC1, 0x81, 0x60, 0x01, 0xE0, 0xA0, 0x41,
+         0x62, 0x83, 0xC3, 0x22, 0x43, 0xA2, 0xE2, 0x03,
+         0x19, 0xF8, 0xB8, 0x59, 0x38, 0xD9, 0x99, 0x78,
+         0x5B, 0xBA, 0xFA, 0x1B, 0x7A, 0x9B, 0xDB, 0x3A,
+         0x9D, 0x7C, 0x3C, 0xDD, 0xBC, 0x5D, 0x1D, 0xFC,
+         0xDF, 0x3E, 0x7E, 0x9F, 0xFE, 0x1F, 0x5F, 0xBE,
+         0x72, 0x93, 0xD3, 0x32, 0x53, 0xB2, 0xF2, 0x13,
+         0x30, 0xD1, 0x91, 0x70, 0x11, 0xF0, 0xB0, 0x51,
+         0xF6, 0x17, 0x57, 0xB6, 0xD7, 0x36, 0x76, 0x97,
+         0xB4, 0x55, 0x15, 0xF4, 0x95, 0x74, 0x34, 0xD5}
+    };
+    uint64_t parity = 0;
+    uint8_t crc = checkdata->crc;
+
+    /*handle whole 8 byte words while at least 1 byte remains after them,
+      since final_crc is the CRC before the last byte is applied*/
+    for (; size > 8; data += 8, size -= 8) {
+        uint64_t word;
+
+        memcpy(&word, data, 8);
+        parity ^= word;
+
+        crc = CRC8[7][crc ^ data[0]] ^
+              CRC8[6][data[1]] ^
+              CRC8[5][data[2]] ^
+              CRC8[4][data[3]] ^
+              CRC8[3][data[4]] ^
+              CRC8[2][data[5]] ^
+              CRC8[1][data[6]] ^
+              CRC8[0][data[7]];
+    }
+
+    /*fold the words' parity down to a single byte*/
+    parity ^= parity >> 32;
+    parity ^= parity >> 16;
+    parity ^= parity >> 8;
+    checkdata->parity ^= (uint8_t)parity;
+
+    /*then the remaining bytes individually*/
+    for (; size > 0; data++, size--) {
+        checkdata->parity ^= *data;
+        crc = CRC8[0][(checkdata->final_crc = crc ^ *data)];
+    }
 
-    checkdata->parity ^= byte;
-    checkdata->crc = CRC8[(checkdata->final_crc = checkdata->crc ^ byte)];
+    checkdata->crc = crc;
 }
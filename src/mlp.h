@@ -26,17 +26,133 @@ struct MLPDecoder_s;
 
 typedef struct MLPDecoder_s MLPDecoder;
 
+/*if stereo_only is set and the stream has 2 substreams,
+  only substream 0's 2 channel presentation is decoded
+  and substream 1 is skipped entirely
+
+  if verify is set, each substream's parity and CRC-8 are checked
+  otherwise they're skipped, which is only suitable
+  for material known to be intact*/
 MLPDecoder*
-dvda_open_mlpdecoder(const struct stream_parameters* parameters);
+dvda_open_mlpdecoder(const struct stream_parameters* parameters,
+                     int stereo_only,
+                     int verify);
 
 void
 dvda_close_mlpdecoder(MLPDecoder* decoder);
 
+/*cumulative counts of an MLP decoder's work*/
+struct mlp_decoder_stats {
+    uint64_t frames;           /*MLP frames decoded*/
+    uint64_t blocks;           /*blocks decoded, across all substreams*/
+    uint64_t restart_headers;  /*restart headers read*/
+    uint64_t check_failures;   /*substreams failing parity or CRC-8*/
+};
+
 /*given a packet reader substream
   (not including the header or pad 2 bytes)
   decodes as many samples as possible to samples
+  which are appended interleaved, in RIFF WAVE channel order
   and returns the number of PCM frames decoded*/
 unsigned
 dvda_mlpdecoder_decode_packet(MLPDecoder* decoder,
                               BitstreamReader* packet_reader,
-                              aa_int* samples);
+                              a_int* samples);
+
+/*adds the decoder's counts so far to stats*/
+void
+dvda_mlpdecoder_stats(const MLPDecoder* decoder,
+                      struct mlp_decoder_stats* stats);
+
+/*returns the number of PCM frames in each MLP frame
+  of a stream with the given parameters*/
+unsigned
+dvda_mlp_frame_size(const struct stream_parameters* parameters);
+
+/*given a queue of MLP data starting at a frame boundary,
+  removes as many complete MLP frames as possible without decoding them
+  and returns the number of frames removed
+
+  any trailing partial frame is left on the queue*/
+unsigned
+dvda_mlp_skip_frames(BitstreamQueue* mlp_data);
+
+/*a multithreaded MLP decoder
+
+  the MLP stream is split into segments at restart points,
+  where every substream has a restart header
+  and a decoder may begin on the stream,
+  so each segment can be decoded by its own freshly opened MLPDecoder,
+  whose filter state starts out cleared,
+  on a pool of worker threads
+  while the output is returned in the original order*/
+struct MLPParallelDecoder_s;
+
+typedef struct MLPParallelDecoder_s MLPParallelDecoder;
+
+/*starts "threads" worker threads, which must be at least 1
+
+  stereo_only and verify are as for dvda_open_mlpdecoder()*/
+MLPParallelDecoder*
+dvda_open_mlp_parallel_decoder(const struct stream_parameters* parameters,
+                               int stereo_only,
+                               int verify,
+                               unsigned threads);
+
+/*stops the worker threads and discards any undecoded segments*/
+void
+dvda_close_mlp_parallel_decoder(MLPParallelDecoder* decoder);
+
+/*given a packet reader substream
+  (not including the header or pad 2 bytes)
+  appends its MLP data to the stream
+  and hands off any segments it completes to the worker threads*/
+void
+dvda_mlp_parallel_decoder_enqueue(MLPParallelDecoder* decoder,
+                                  BitstreamReader* packet_reader);
+
+/*indicates there is no more MLP data
+  and hands off any remaining data as the final segment
+
+  should more data be enqueued afterward, it starts a new segment,
+  so this may also be used to end a segment at a known restart point*/
+void
+dvda_mlp_parallel_decoder_finish(MLPParallelDecoder* decoder);
+
+/*returns the number of segments handed off
+  whose output hasn't yet been taken*/
+unsigned
+dvda_mlp_parallel_decoder_pending(MLPParallelDecoder* decoder);
+
+/*waits for the oldest pending segment to be decoded
+  and appends its samples to samples,
+  interleaved in RIFF WAVE channel order
+
+  returns the number of PCM frames appended,
+  which is 0 if no segments are pending
+  or the segment decoded no PCM frames*/
+unsigned
+dvda_mlp_parallel_decoder_take(MLPParallelDecoder* decoder,
+                               a_int* samples);
+
+/*adds the counts of every segment decoded so far to stats*/
+void
+dvda_mlp_parallel_decoder_stats(MLPParallelDecoder* decoder,
+                                struct mlp_decoder_stats* stats);
+
+#ifdef MLP_STAGE_TIMING
+/*when built with MLP_STAGE_TIMING defined,
+  every MLPDecoder in the process adds the nanoseconds it spends
+  in each stage of decoding to these totals
+
+  the totals aren't locked, so this is only for benchmarking
+  single-threaded decoding*/
+struct mlp_stage_timing {
+    uint64_t residuals;  /*reading and Huffman decoding residuals*/
+    uint64_t filtering;  /*FIR/IIR filtering residuals to channels*/
+    uint64_t rematrix;   /*rematrixing and noise generation*/
+    uint64_t output;     /*output shifts and interleaving to WAVE order*/
+};
+
+extern struct mlp_stage_timing dvda_mlp_stage_timing;
+#endif
@@ -18,13 +18,32 @@
 *******************************************************/
 
 #include "packet.h"
+#include <string.h>
+#include "clock.h"
+#include "probes.h"
 
 #define AUDIO_STREAM_ID 0xBD
 #define SECTOR_SIZE 2048
 
+/*returns the next packet as for packet_reader_next_packet()
+  but without counting or timing it*/
+static BitstreamReader*
+next_packet(Packet_Reader *packet_reader,
+            unsigned *stream_id,
+            unsigned *sector);
+
+/*returns the total time the AOB reader has spent on sectors*/
+static inline uint64_t
+aob_reader_ns(const AOB_Reader *aob_reader)
+{
+    const struct aob_reader_stats *stats = aob_reader_stats(aob_reader);
+    return stats->read_ns + stats->decrypt_ns;
+}
+
 /*returns 0 on success, 1 on failure*/
 static int
 read_pack_header(BitstreamReader *sector_reader,
+                 const bs_format_t *pack_header_format,
                  uint64_t *pts,
                  unsigned *SCR_extension,
                  unsigned *bitrate);
@@ -32,6 +51,14 @@ read_pack_header(BitstreamReader *sector_reader,
 struct Packet_Reader_s {
     AOB_Reader *aob_reader;
     BitstreamQueue *sector_data;
+    struct packet_reader_stats stats;
+
+    /*pack and packet header formats, compiled once per reader*/
+    bs_format_t *pack_header_format;
+    bs_format_t *packet_header_format;
+
+    /*the AOB reader's counts when the packet reader was opened*/
+    struct aob_reader_stats aob_stats_start;
 };
 
 Packet_Reader*
@@ -40,6 +67,11 @@ packet_reader_open(AOB_Reader *aob_reader)
     Packet_Reader *packet_reader = malloc(sizeof(Packet_Reader));
     packet_reader->aob_reader = aob_reader;
     packet_reader->sector_data = br_open_queue(BS_BIG_ENDIAN);
+    memset(&packet_reader->stats, 0, sizeof(struct packet_reader_stats));
+    packet_reader->pack_header_format = bs_compile_format(
+        "32u 2u 3u 1u 15u 1u 15u 1u 9u 1u 22u 2u 5p 3u");
+    packet_reader->packet_header_format = bs_compile_format("24u 8u 16u");
+    packet_reader->aob_stats_start = *aob_reader_stats(aob_reader);
     return packet_reader;
 }
 
@@ -47,6 +79,8 @@ void
 packet_reader_free(Packet_Reader *packet_reader)
 {
     packet_reader->sector_data->close(packet_reader->sector_data);
+    free(packet_reader->pack_header_format);
+    free(packet_reader->packet_header_format);
     free(packet_reader);
 }
 
@@ -61,6 +95,64 @@ BitstreamReader*
 packet_reader_next_packet(Packet_Reader *packet_reader,
                           unsigned *stream_id,
                           unsigned *sector)
+{
+    const uint64_t aob_start = aob_reader_ns(packet_reader->aob_reader);
+    const uint64_t start = dvda_clock_ns();
+    BitstreamReader *packet = next_packet(packet_reader, stream_id, sector);
+
+    packet_reader->stats.demux_ns +=
+        (dvda_clock_ns() - start) -
+        (aob_reader_ns(packet_reader->aob_reader) - aob_start);
+    if (packet) {
+        packet_reader->stats.packets_demuxed += 1;
+        DVDA_PROBE3(packet, *stream_id, *sector, packet->size(packet));
+    }
+    return packet;
+}
+
+BitstreamReader*
+packet_reader_next_audio_packet(Packet_Reader *packet_reader,
+                                unsigned *sector)
+{
+    unsigned stream_id = 0;
+    BitstreamReader *packet = packet_reader_next_packet(packet_reader,
+                                                        &stream_id,
+                                                        sector);
+    if (!packet) {
+        return NULL;
+    }
+    if (stream_id == AUDIO_STREAM_ID) {
+        return packet;
+    } else {
+        packet->close(packet);
+        packet_reader->stats.packets_skipped += 1;
+        return packet_reader_next_audio_packet(packet_reader, sector);
+    }
+}
+
+const struct packet_reader_stats*
+packet_reader_stats(const Packet_Reader *packet_reader)
+{
+    return &packet_reader->stats;
+}
+
+void
+packet_reader_aob_stats(const Packet_Reader *packet_reader,
+                        struct aob_reader_stats *stats)
+{
+    const struct aob_reader_stats *start = &packet_reader->aob_stats_start;
+
+    *stats = *aob_reader_stats(packet_reader->aob_reader);
+    stats->sectors_read -= start->sectors_read;
+    stats->bytes_decrypted -= start->bytes_decrypted;
+    stats->read_ns -= start->read_ns;
+    stats->decrypt_ns -= start->decrypt_ns;
+}
+
+static BitstreamReader*
+next_packet(Packet_Reader *packet_reader,
+            unsigned *stream_id,
+            unsigned *sector)
 {
     BitstreamQueue *sector_data = packet_reader->sector_data;
     BitstreamReader *sector_reader = (BitstreamReader*)sector_data;
@@ -79,7 +171,11 @@ packet_reader_next_packet(Packet_Reader *packet_reader,
 
         /*read pack header from sector data*/
         sector_data->push(sector_data, SECTOR_SIZE, sector_buffer);
-        if (read_pack_header(sector_reader, &pts, &SCR_extension, &bitrate)) {
+        if (read_pack_header(sector_reader,
+                             packet_reader->pack_header_format,
+                             &pts,
+                             &SCR_extension,
+                             &bitrate)) {
             return NULL;
         }
     }
@@ -94,8 +190,11 @@ packet_reader_next_packet(Packet_Reader *packet_reader,
         BitstreamReader *packet_data;
 
         /*read 48 bit packet header*/
-        sector_reader->parse(sector_reader, "24u 8u 16u",
-                             &start_code, stream_id, &packet_data_length);
+        sector_reader->parse_compiled(sector_reader,
+                                      packet_reader->packet_header_format,
+                                      &start_code,
+                                      stream_id,
+                                      &packet_data_length);
 
         /*ensure start code is correct*/
         if (start_code != 0x000001) {
@@ -115,27 +214,9 @@ packet_reader_next_packet(Packet_Reader *packet_reader,
     }
 }
 
-BitstreamReader*
-packet_reader_next_audio_packet(Packet_Reader *packet_reader,
-                                unsigned *sector)
-{
-    unsigned stream_id = 0;
-    BitstreamReader *packet = packet_reader_next_packet(packet_reader,
-                                                        &stream_id,
-                                                        sector);
-    if (!packet) {
-        return NULL;
-    }
-    if (stream_id == AUDIO_STREAM_ID) {
-        return packet;
-    } else {
-        packet->close(packet);
-        return packet_reader_next_audio_packet(packet_reader, sector);
-    }
-}
-
 static int
 read_pack_header(BitstreamReader *sector_reader,
+                 const bs_format_t *pack_header_format,
                  uint64_t *pts,
                  unsigned *SCR_extension,
                  unsigned *bitrate)
@@ -148,9 +229,9 @@ read_pack_header(BitstreamReader *sector_reader,
         unsigned PTS_low;
         unsigned stuffing_count;
 
-        sector_reader->parse(
+        sector_reader->parse_compiled(
             sector_reader,
-            "32u 2u 3u 1u 15u 1u 15u 1u 9u 1u 22u 2u 5p 3u",
+            pack_header_format,
             &sync_bytes,     /*32 bits*/
             &(pad[0]),       /* 2 bits*/
             &PTS_high,       /* 3 bits*/
@@ -27,6 +27,15 @@ struct Packet_Reader_s;
 
 typedef struct Packet_Reader_s Packet_Reader;
 
+/*cumulative counts of a packet reader's work since it was opened*/
+struct packet_reader_stats {
+    uint64_t packets_demuxed;  /*packets pulled apart from sectors*/
+    uint64_t packets_skipped;  /*non-audio packets passed over
+                                 by packet_reader_next_audio_packet()*/
+    uint64_t demux_ns;         /*time spent pulling apart packets,
+                                 not counting the AOB reader's own*/
+};
+
 /*given an AOB_Reader, opens a packet reader
   which pulls apart the stream of sectors into individual packets*/
 Packet_Reader*
@@ -57,4 +66,15 @@ BitstreamReader*
 packet_reader_next_audio_packet(Packet_Reader *packet_reader,
                                 unsigned *sector);
 
+/*returns the reader's counts so far*/
+const struct packet_reader_stats*
+packet_reader_stats(const Packet_Reader *packet_reader);
+
+/*populates stats with the enclosed AOB reader's counts
+  since the packet reader was opened,
+  which are less than its totals if the AOB reader has been read before*/
+void
+packet_reader_aob_stats(const Packet_Reader *packet_reader,
+                        struct aob_reader_stats *stats);
+
 #endif
@@ -40,6 +40,45 @@ SL16_char_to_int(unsigned char *s);
 static int
 SL24_char_to_int(unsigned char *s);
 
+/*the order of the bytes of 2 PCM frames within a packet,
+  by bits per sample and channel count*/
+static const uint8_t AOB_BYTE_SWAP[2][6][36] = {
+    { /*16 bps*/
+        { 1,  0,  3,  2},                                 /*1 ch*/
+        { 1,  0,  3,  2,  5,  4,  7,  6},                 /*2 ch*/
+        { 1,  0,  3,  2,  5,  4,  7,  6,  9,  8, 11, 10}, /*3 ch*/
+        { 1,  0,  3,  2,  5,  4,  7,  6,  9,  8, 11, 10,
+         13, 12, 15, 14},                                 /*4 ch*/
+        { 1,  0,  3,  2,  5,  4,  7,  6,  9,  8, 11, 10,
+         13, 12, 15, 14, 17, 16, 19, 18},                 /*5 ch*/
+        { 5,  4,  7,  6, 17, 16, 19, 18,  1,  0,  3,  2,
+          9,  8, 11, 10, 13, 12, 15, 14, 21, 20, 23, 22}  /*6 ch*/
+    },
+    { /*24 bps*/
+        {   2,  1,  5,  4,  0,  3},  /*1 ch*/
+        {   2,  1,  5,  4,  8,  7,
+           11, 10,  0,  3,  6,  9},  /*2 ch*/
+        {   8,  7, 17, 16,  6, 15,
+            2,  1,  5,  4, 11, 10,
+           14, 13,  0,  3,  9, 12},  /*3 ch*/
+        {   8,  7, 11, 10, 20, 19,
+           23, 22,  6,  9, 18, 21,
+            2,  1,  5,  4, 14, 13,
+           17, 16,  0,  3, 12, 15},  /*4 ch*/
+        {   8,  7, 11, 10, 14, 13,
+           23, 22, 26, 25, 29, 28,
+            6,  9, 12, 21, 24, 27,
+            2,  1,  5,  4, 17, 16,
+           20, 19,  0,  3, 15, 18},  /*5 ch*/
+        {   8,  7, 11, 10, 26, 25,
+           29, 28,  6,  9, 24, 27,
+            2,  1,  5,  4, 14, 13,
+           17, 16, 20, 19, 23, 22,
+           32, 31, 35, 34,  0,  3,
+           12, 15, 18, 21, 30, 33}  /*6 ch*/
+    }
+};
+
 struct PCMDecoder_s {
     unsigned bps;
     int (*converter)(unsigned char *);
@@ -98,44 +137,8 @@ dvda_pcmdecoder_decode_params(BitstreamReader *packet_reader,
 unsigned
 dvda_pcmdecoder_decode_packet(PCMDecoder* decoder,
                               BitstreamReader* packet_reader,
-                              aa_int* samples)
+                              a_int* samples)
 {
-    const static uint8_t AOB_BYTE_SWAP[2][6][36] = {
-        { /*16 bps*/
-            { 1,  0,  3,  2},                                 /*1 ch*/
-            { 1,  0,  3,  2,  5,  4,  7,  6},                 /*2 ch*/
-            { 1,  0,  3,  2,  5,  4,  7,  6,  9,  8, 11, 10}, /*3 ch*/
-            { 1,  0,  3,  2,  5,  4,  7,  6,  9,  8, 11, 10,
-             13, 12, 15, 14},                                 /*4 ch*/
-            { 1,  0,  3,  2,  5,  4,  7,  6,  9,  8, 11, 10,
-             13, 12, 15, 14, 17, 16, 19, 18},                 /*5 ch*/
-            { 5,  4,  7,  6, 17, 16, 19, 18,  1,  0,  3,  2,
-              9,  8, 11, 10, 13, 12, 15, 14, 21, 20, 23, 22}  /*6 ch*/
-        },
-        { /*24 bps*/
-            {   2,  1,  5,  4,  0,  3},  /*1 ch*/
-            {   2,  1,  5,  4,  8,  7,
-               11, 10,  0,  3,  6,  9},  /*2 ch*/
-            {   8,  7, 17, 16,  6, 15,
-                2,  1,  5,  4, 11, 10,
-               14, 13,  0,  3,  9, 12},  /*3 ch*/
-            {   8,  7, 11, 10, 20, 19,
-               23, 22,  6,  9, 18, 21,
-                2,  1,  5,  4, 14, 13,
-               17, 16,  0,  3, 12, 15},  /*4 ch*/
-            {   8,  7, 11, 10, 14, 13,
-               23, 22, 26, 25, 29, 28,
-                6,  9, 12, 21, 24, 27,
-                2,  1,  5,  4, 17, 16,
-               20, 19,  0,  3, 15, 18},  /*5 ch*/
-            {   8,  7, 11, 10, 26, 25,
-               29, 28,  6,  9, 24, 27,
-                2,  1,  5,  4, 14, 13,
-               17, 16, 20, 19, 23, 22,
-               32, 31, 35, 34,  0,  3,
-               12, 15, 18, 21, 30, 33}  /*6 ch*/
-        }
-    };
     const unsigned bps = decoder->bps;
     int (*converter)(unsigned char *) = decoder->converter;
     const unsigned channels = decoder->channels;
@@ -155,10 +158,10 @@ dvda_pcmdecoder_decode_packet(PCMDecoder* decoder,
                 (uint8_t)(read(packet_reader, 8));
         }
 
-        /*decode bytes to PCM ints and place them in proper channels*/
+        /*decode bytes to PCM ints, which are already interleaved*/
+        samples->resize_for(samples, channels * 2);
         for (i = 0; i < (channels * 2); i++) {
-            a_int* channel = samples->_[i % channels];
-            channel->append(channel, converter(unswapped_ptr));
+            a_append(samples, converter(unswapped_ptr));
             unswapped_ptr += bytes_per_sample;
         }
 
@@ -168,6 +171,35 @@ dvda_pcmdecoder_decode_packet(PCMDecoder* decoder,
     return processed_frames;
 }
 
+unsigned
+dvda_pcm_encode_chunk(unsigned bits_per_sample,
+                      unsigned channel_count,
+                      const int samples[],
+                      uint8_t chunk[])
+{
+    const unsigned bps = (bits_per_sample == 16) ? 0 : 1;
+    const unsigned bytes_per_sample = bits_per_sample / 8;
+    const unsigned chunk_size = bytes_per_sample * channel_count * 2;
+    uint8_t unswapped[36];
+    uint8_t* unswapped_ptr = unswapped;
+    unsigned i;
+
+    /*store samples as little-endian bytes*/
+    for (i = 0; i < (channel_count * 2); i++) {
+        unsigned j;
+        for (j = 0; j < bytes_per_sample; j++) {
+            *unswapped_ptr++ = (uint8_t)(samples[i] >> (j * 8));
+        }
+    }
+
+    /*then swap them to packet order*/
+    for (i = 0; i < chunk_size; i++) {
+        chunk[i] = unswapped[AOB_BYTE_SWAP[bps][channel_count - 1][i]];
+    }
+
+    return chunk_size;
+}
+
 static int
 SL16_char_to_int(unsigned char *s)
 {
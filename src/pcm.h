@@ -40,8 +40,21 @@ dvda_pcmdecoder_decode_params(BitstreamReader *packet_reader,
 /*given a packet reader substream
   (not including the stream parameters or second padding)
   decodes as many samples as possible to samples
+  which are appended interleaved, in RIFF WAVE channel order
   and returns the number of PCM frames decoded*/
 unsigned
 dvda_pcmdecoder_decode_packet(PCMDecoder* decoder,
                               BitstreamReader* packet_reader,
-                              aa_int* samples);
+                              a_int* samples);
+
+/*the inverse of dvda_pcmdecoder_decode_packet(), for generating streams
+
+  given 2 PCM frames of interleaved samples in RIFF WAVE channel order
+  at 16 or 24 bits per sample,
+  writes them to chunk in the order they're stored in a packet
+  and returns the number of bytes written, which is at most 36*/
+unsigned
+dvda_pcm_encode_chunk(unsigned bits_per_sample,
+                      unsigned channel_count,
+                      const int samples[],
+                      uint8_t chunk[]);
@@ -0,0 +1,58 @@
+/********************************************************
+ DVD-A Library, a module for reading DVD-Audio discs
+ Copyright (C) 2014-2015  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#ifndef __LIBDVDAUDIO_PROBES_H__
+#define __LIBDVDAUDIO_PROBES_H__
+
+/*static tracepoints on the decoding path under the "libdvdaudio" provider
+  for timing individual events with a tracer such as bpftrace
+
+  when built with HAS_SDT (as by "make SDT=1") these are USDT probes
+  from systemtap's sys/sdt.h, each just a nop until a tracer attaches,
+  and otherwise they compile to nothing and their arguments are unused
+
+  probes and their arguments:
+
+  sector__read__start(sector)          reading a sector from an AOB
+  sector__read__done(sector, error)
+  decrypt__start(sector)               CPPM-decrypting a sector
+  decrypt__done(sector, encrypted)
+  packet(stream_id, sector, size)      a packet pulled from a sector
+  mlp__frame__start(size)              decoding an MLP frame
+  mlp__frame__done(pcm_frames)
+  mlp__restart__header(min_channel, max_channel)
+  major__sync(bytes_skipped)           a major sync found in the stream
+  read__start(reader, pcm_frames)      a call to dvda_read()
+  read__done(reader, pcm_frames)*/
+
+#ifdef HAS_SDT
+#include <sys/sdt.h>
+#define DVDA_PROBE1(NAME, A1) \
+    DTRACE_PROBE1(libdvdaudio, NAME, A1)
+#define DVDA_PROBE2(NAME, A1, A2) \
+    DTRACE_PROBE2(libdvdaudio, NAME, A1, A2)
+#define DVDA_PROBE3(NAME, A1, A2, A3) \
+    DTRACE_PROBE3(libdvdaudio, NAME, A1, A2, A3)
+#else
+#define DVDA_PROBE1(NAME, A1) do {} while (0)
+#define DVDA_PROBE2(NAME, A1, A2) do {} while (0)
+#define DVDA_PROBE3(NAME, A1, A2, A3) do {} while (0)
+#endif
+
+#endif
@@ -39,4 +39,86 @@ dvda_params_equal(const struct stream_parameters *p1,
             (p1->channel_assignment == p2->channel_assignment));
 }
 
+/*given a 4 bit packed field,
+  returns the bits-per-sample which is either 16, 20 or 24*/
+static inline unsigned
+dvda_unpack_bits_per_sample(unsigned packed_field)
+{
+    switch (packed_field) {
+    case 0:
+        return 16;
+    case 1:
+        return 20;
+    case 2:
+        return 24;
+    default:
+        return 0;
+    }
+}
+
+/*given a 4 bit packed field,
+  returns the sample rate in Hz which is either
+  44100, 48000, 88200, 96000 176400 or 192000*/
+static inline unsigned
+dvda_unpack_sample_rate(unsigned packed_field)
+{
+    switch (packed_field) {
+    case 0:
+        return 48000;
+    case 1:
+        return 96000;
+    case 2:
+        return 192000;
+    case 8:
+        return 44100;
+    case 9:
+        return 88200;
+    case 10:
+        return 176400;
+    default:
+        return 0;
+    }
+}
+
+/*given a 5 bit packed field,
+  returns the channel count which is between 1 and 6*/
+static inline unsigned
+dvda_unpack_channel_count(unsigned packed_field)
+{
+    switch (packed_field) {
+    case 0:  /*front center*/
+        return 1;
+    case 1:  /*front left, front right*/
+        return 2;
+    case 2:  /*front left, front right, back center*/
+    case 4:  /*front left, front right, LFE*/
+    case 7:  /*front left, front right, front center*/
+        return 3;
+    case 3:  /*front left, front right, back left, back right*/
+    case 5:  /*front left, front right, LFE, back center*/
+    case 8:  /*front left, front right, front center, back center*/
+    case 10: /*front left, front right, front center, LFE*/
+    case 13: /*front left, front right, front center, back center*/
+    case 15: /*front left, front right, front center, LFE*/
+        return 4;
+    case 6:  /*front left, front right, LFE, back left, back right*/
+    case 9:  /*front left, front right, front center, back left, back right*/
+    case 11: /*front left, front right, front center, LFE, back center*/
+    case 14: /*front left, front right, front center, back left, back right*/
+    case 16: /*front left, front right, front center, LFE, back center*/
+    case 18: /*front left, front right, back left, back right, LFE*/
+    case 19: /*front left, front right, back left, back right, front center*/
+        return 5;
+    case 12: /*front left, front right, front center,
+               LFE, back left, back right*/
+    case 17: /*front left, front right, front center,
+               LFE, back left, back right*/
+    case 20: /*front left, front right, back left, back right,
+               front center, LFE*/
+        return 6;
+    default:
+        return 0;
+    }
+}
+
 #endif
@@ -0,0 +1,763 @@
+/********************************************************
+ DVD-A Library, a module for reading DVD-Audio discs
+ Copyright (C) 2014-2015  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#include <stdio.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "bitstream.h"
+#include "huffman.h"
+#include "array.h"
+
+/*bench-primitives times the BitstreamReader and array operations
+  every decoder is built on, in nanoseconds per operation
+
+  each benchmark is run several times and its fastest run is reported,
+  and given a baseline file of earlier results
+  any benchmark more than a threshold slower than its baseline
+  is reported as a regression*/
+
+/*the size of the random data every reader runs over*/
+#define DATA_SIZE (1 << 20)
+
+#define DEFAULT_RUNS 5
+#define DEFAULT_THRESHOLD 25
+
+#define MAX_NAME 64
+
+typedef enum {
+    BACKEND_FILE,
+    BACKEND_BUFFER,
+    BACKEND_QUEUE,
+    BACKEND_NONE
+} backend_t;
+
+static const char* const BACKEND_NAME[] = {"file", "buffer", "queue"};
+
+/*runs a benchmark's workload once on the given backend
+  and returns the number of operations timed
+  between its calls to bench_start() and bench_stop()*/
+typedef uint64_t (*benchmark_f)(backend_t backend);
+
+struct benchmark {
+    const char* name;
+    benchmark_f run;
+    int per_backend;   /*whether to run once per reader backend*/
+};
+
+struct result {
+    char name[MAX_NAME];
+    double ns_per_op;
+};
+
+/*the random data readers run over and a temporary file holding it*/
+static uint8_t *bench_data;
+static FILE *bench_file;
+
+static uint64_t bench_started;
+static uint64_t bench_elapsed;
+
+void
+display_options(const char *progname, FILE *output);
+
+uint64_t
+bench_clock(void);
+
+void
+bench_start(void);
+
+void
+bench_stop(void);
+
+/*returns a reader positioned at the start of the benchmark data
+  which must be passed to close_reader() when finished*/
+BitstreamReader*
+open_reader(backend_t backend);
+
+void
+close_reader(backend_t backend, BitstreamReader *reader);
+
+uint64_t
+bench_read(backend_t backend);
+
+uint64_t
+bench_read_unary(backend_t backend);
+
+uint64_t
+bench_parse(backend_t backend);
+
+uint64_t
+bench_parse_compiled(backend_t backend);
+
+uint64_t
+bench_huffman(backend_t backend);
+
+uint64_t
+bench_substream(backend_t backend);
+
+uint64_t
+bench_enqueue(backend_t backend);
+
+uint64_t
+bench_getpos_setpos(backend_t backend);
+
+uint64_t
+bench_queue_grow(backend_t backend);
+
+uint64_t
+bench_queue_cycle(backend_t backend);
+
+uint64_t
+bench_a_int_append(backend_t backend);
+
+uint64_t
+bench_a_int_extend(backend_t backend);
+
+uint64_t
+bench_a_int_de_head(backend_t backend);
+
+uint64_t
+bench_a_int_tail(backend_t backend);
+
+/*returns the fastest time per operation of several runs*/
+double
+run_benchmark(benchmark_f run, backend_t backend, unsigned runs);
+
+/*reads a baseline file of results, one "name ns_per_op" per line,
+  and returns the number read or -1 if the file can't be opened*/
+int
+read_baseline(const char *path, struct result **baseline);
+
+const struct result*
+find_result(const struct result *results, int count, const char *name);
+
+static const struct benchmark BENCHMARKS[] = {
+    {"br.read", bench_read, 1},
+    {"br.read_unary", bench_read_unary, 1},
+    {"br.parse", bench_parse, 1},
+    {"br.parse_compiled", bench_parse_compiled, 1},
+    {"br.huffman", bench_huffman, 1},
+    {"br.substream", bench_substream, 1},
+    {"br.enqueue", bench_enqueue, 1},
+    {"br.getpos_setpos", bench_getpos_setpos, 1},
+    {"br_queue.grow", bench_queue_grow, 0},
+    {"br_queue.cycle", bench_queue_cycle, 0},
+    {"a_int.append", bench_a_int_append, 0},
+    {"a_int.extend", bench_a_int_extend, 0},
+    {"a_int.de_head", bench_a_int_de_head, 0},
+    {"a_int.tail", bench_a_int_tail, 0}
+};
+
+int
+main(int argc, char *argv[])
+{
+    char* progname = argv[0];
+    char* baseline_path = NULL;
+    unsigned runs = DEFAULT_RUNS;
+    unsigned threshold = DEFAULT_THRESHOLD;
+    struct result *baseline = NULL;
+    int baseline_count = 0;
+    unsigned regressions = 0;
+    unsigned i;
+
+    /*parse arguments*/
+    static struct option long_options[] = {
+        {"baseline", required_argument, 0, 'b'},
+        {"runs", required_argument, 0, 'r'},
+        {"threshold", required_argument, 0, 't'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int option_index = 0;
+    int c;
+
+    do {
+        c = getopt_long(argc, argv, "b:r:t:h", long_options, &option_index);
+
+        switch (c) {
+        case 'h':
+            display_options(progname, stdout);
+            return 0;
+        case 'b':
+            baseline_path = optarg;
+            break;
+        case 'r':
+            if ((runs = (unsigned)strtoul(optarg, NULL, 10)) == 0) {
+                fprintf(stderr, "*** Error: runs must be at least 1\n");
+                return 1;
+            }
+            break;
+        case 't':
+            threshold = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case '?':
+            return 1;
+        case 0:
+        case -1:
+            break;
+        }
+    } while (c != -1);
+
+    if (baseline_path &&
+        ((baseline_count = read_baseline(baseline_path, &baseline)) < 0)) {
+        fprintf(stderr, "*** Error: unable to read baseline \"%s\"\n",
+                baseline_path);
+        return 1;
+    }
+
+    /*the same pseudo-random data on every run*/
+    bench_data = malloc(DATA_SIZE);
+    srand(1);
+    for (i = 0; i < DATA_SIZE; i++) {
+        bench_data[i] = (uint8_t)(rand() >> 4);
+    }
+    if ((bench_file = tmpfile()) == NULL) {
+        fprintf(stderr, "*** Error: unable to create temporary file\n");
+        free(bench_data);
+        free(baseline);
+        return 1;
+    }
+    fwrite(bench_data, 1, DATA_SIZE, bench_file);
+
+    if (baseline_path) {
+        printf("%-28s %10s %10s %8s\n",
+               "benchmark", "ns/op", "baseline", "change");
+    }
+
+    for (i = 0; i < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); i++) {
+        const struct benchmark *benchmark = &BENCHMARKS[i];
+        const backend_t last_backend =
+            benchmark->per_backend ? BACKEND_QUEUE : BACKEND_FILE;
+        backend_t backend;
+
+        for (backend = BACKEND_FILE; backend <= last_backend; backend++) {
+            char name[MAX_NAME];
+            const struct result *base;
+            double ns_per_op;
+
+            if (benchmark->per_backend) {
+                snprintf(name, sizeof(name), "%s.%s",
+                         benchmark->name, BACKEND_NAME[backend]);
+            } else {
+                snprintf(name, sizeof(name), "%s", benchmark->name);
+            }
+
+            ns_per_op = run_benchmark(benchmark->run,
+                                      benchmark->per_backend ?
+                                      backend : BACKEND_NONE,
+                                      runs);
+
+            if (!baseline_path) {
+                printf("%s %.3f\n", name, ns_per_op);
+            } else if ((base = find_result(baseline,
+                                           baseline_count,
+                                           name)) != NULL) {
+                const double change =
+                    ((ns_per_op / base->ns_per_op) - 1.0) * 100.0;
+                const int regressed = change > threshold;
+
+                printf("%-28s %10.3f %10.3f %+7.1f%%%s\n",
+                       name, ns_per_op, base->ns_per_op, change,
+                       regressed ? "  REGRESSION" : "");
+                regressions += regressed;
+            } else {
+                printf("%-28s %10.3f %10s\n", name, ns_per_op, "-");
+            }
+            fflush(stdout);
+        }
+    }
+
+    fclose(bench_file);
+    free(bench_data);
+    free(baseline);
+
+    if (regressions) {
+        fprintf(stderr, "*** %u benchmark(s) more than %u%% slower "
+                "than baseline\n", regressions, threshold);
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+void
+display_options(const char *progname, FILE *output)
+{
+    fprintf(output, "*** Usage : %s [OPTIONS]\n", progname);
+    fprintf(output, "Options:\n");
+    fprintf(output, "  -h, --help                "
+            "show this help message and exit\n");
+    fprintf(output, "  -b FILE, --baseline=FILE  "
+            "compare results to those in FILE\n");
+    fprintf(output, "  -r N, --runs=N            "
+            "runs of each benchmark, %d if omitted\n", DEFAULT_RUNS);
+    fprintf(output, "  -t PCT, --threshold=PCT   "
+            "percent slower than baseline counted as a regression,\n"
+                    "                            "
+            "%d if omitted\n", DEFAULT_THRESHOLD);
+}
+
+uint64_t
+bench_clock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+void
+bench_start(void)
+{
+    bench_started = bench_clock();
+}
+
+void
+bench_stop(void)
+{
+    bench_elapsed += bench_clock() - bench_started;
+}
+
+BitstreamReader*
+open_reader(backend_t backend)
+{
+    switch (backend) {
+    case BACKEND_FILE:
+    default:
+        fseek(bench_file, 0, SEEK_SET);
+        return br_open(bench_file, BS_BIG_ENDIAN);
+    case BACKEND_BUFFER:
+        return br_open_buffer(bench_data, DATA_SIZE, BS_BIG_ENDIAN);
+    case BACKEND_QUEUE:
+        {
+            BitstreamQueue *queue = br_open_queue(BS_BIG_ENDIAN);
+            queue->push(queue, DATA_SIZE, bench_data);
+            return (BitstreamReader*)queue;
+        }
+    }
+}
+
+void
+close_reader(backend_t backend, BitstreamReader *reader)
+{
+    if (backend == BACKEND_FILE) {
+        /*leave the temporary file open for the next run*/
+        reader->free(reader);
+    } else {
+        reader->close(reader);
+    }
+}
+
+uint64_t
+bench_read(backend_t backend)
+{
+    /*a mix of field sizes, 71 bits per pass*/
+    static const unsigned BITS[] = {1, 2, 3, 5, 8, 12, 16, 24};
+    const unsigned passes = 100000;
+    BitstreamReader *reader = open_reader(backend);
+    br_read_f read = reader->read;
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < passes; i++) {
+        unsigned j;
+        for (j = 0; j < 8; j++) {
+            read(reader, BITS[j]);
+        }
+    }
+    bench_stop();
+
+    close_reader(backend, reader);
+    return (uint64_t)passes * 8;
+}
+
+uint64_t
+bench_read_unary(backend_t backend)
+{
+    /*random data averages 2 bits per value*/
+    const unsigned values = 1000000;
+    BitstreamReader *reader = open_reader(backend);
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < values; i++) {
+        reader->read_unary(reader, 1);
+    }
+    bench_stop();
+
+    close_reader(backend, reader);
+    return values;
+}
+
+uint64_t
+bench_parse(backend_t backend)
+{
+    /*the 9 bytes of PCM stream parameters*/
+    const unsigned parses = DATA_SIZE / 9;
+    BitstreamReader *reader = open_reader(backend);
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < parses; i++) {
+        unsigned first_audio_frame;
+        unsigned group_0_bps;
+        unsigned group_1_bps;
+        unsigned group_0_rate;
+        unsigned group_1_rate;
+        unsigned channel_assignment;
+        unsigned crc;
+
+        reader->parse(reader,
+                      "16u 8p 4u 4u 4u 4u 8p 8u 8p 8u",
+                      &first_audio_frame,
+                      &group_0_bps,
+                      &group_1_bps,
+                      &group_0_rate,
+                      &group_1_rate,
+                      &channel_assignment,
+                      &crc);
+    }
+    bench_stop();
+
+    close_reader(backend, reader);
+    return parses;
+}
+
+uint64_t
+bench_parse_compiled(backend_t backend)
+{
+    /*the same parameters as bench_parse, from a compiled format*/
+    const unsigned parses = DATA_SIZE / 9;
+    BitstreamReader *reader = open_reader(backend);
+    bs_format_t *format = bs_compile_format("16u 8p 4u 4u 4u 4u 8p 8u 8p 8u");
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < parses; i++) {
+        unsigned first_audio_frame;
+        unsigned group_0_bps;
+        unsigned group_1_bps;
+        unsigned group_0_rate;
+        unsigned group_1_rate;
+        unsigned channel_assignment;
+        unsigned crc;
+
+        reader->parse_compiled(reader,
+                               format,
+                               &first_audio_frame,
+                               &group_0_bps,
+                               &group_1_bps,
+                               &group_0_rate,
+                               &group_1_rate,
+                               &channel_assignment,
+                               &crc);
+    }
+    bench_stop();
+
+    free(format);
+    close_reader(backend, reader);
+    return parses;
+}
+
+uint64_t
+bench_huffman(backend_t backend)
+{
+    /*a complete tree of codes 1, 01, 001 ... 0000001, 0000000
+      so any data decodes*/
+    struct huffman_frequency frequencies[8];
+    br_huffman_table_t *table;
+    const unsigned codes = 1000000;
+    BitstreamReader *reader;
+    unsigned i;
+
+    for (i = 0; i < 7; i++) {
+        frequencies[i].bits = 1;
+        frequencies[i].length = i + 1;
+        frequencies[i].value = (int)i;
+    }
+    frequencies[7].bits = 0;
+    frequencies[7].length = 7;
+    frequencies[7].value = 7;
+    compile_br_huffman_table(&table, frequencies, 8, BS_BIG_ENDIAN);
+
+    reader = open_reader(backend);
+
+    bench_start();
+    for (i = 0; i < codes; i++) {
+        reader->read_huffman_code(reader, table);
+    }
+    bench_stop();
+
+    close_reader(backend, reader);
+    free(table);
+    return codes;
+}
+
+uint64_t
+bench_substream(backend_t backend)
+{
+    const unsigned substreams = DATA_SIZE / 64;
+    BitstreamReader *reader = open_reader(backend);
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < substreams; i++) {
+        BitstreamReader *substream = reader->substream(reader, 64);
+        substream->close(substream);
+    }
+    bench_stop();
+
+    close_reader(backend, reader);
+    return substreams;
+}
+
+uint64_t
+bench_enqueue(backend_t backend)
+{
+    const unsigned enqueues = DATA_SIZE / 64;
+    BitstreamReader *reader = open_reader(backend);
+    BitstreamQueue *queue = br_open_queue(BS_BIG_ENDIAN);
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < enqueues; i++) {
+        reader->enqueue(reader, 64, queue);
+        if ((i % 1024) == 1023) {
+            queue->reset(queue);
+        }
+    }
+    bench_stop();
+
+    queue->close(queue);
+    close_reader(backend, reader);
+    return enqueues;
+}
+
+uint64_t
+bench_getpos_setpos(backend_t backend)
+{
+    const unsigned rewinds = 200000;
+    BitstreamReader *reader = open_reader(backend);
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < rewinds; i++) {
+        br_pos_t *pos = reader->getpos(reader);
+        reader->skip(reader, 32);
+        reader->setpos(reader, pos);
+        pos->del(pos);
+        reader->skip(reader, 8);
+    }
+    bench_stop();
+
+    close_reader(backend, reader);
+    return rewinds;
+}
+
+uint64_t
+bench_queue_grow(backend_t backend)
+{
+    /*pushes to an ever-growing queue, as when buffering a stream*/
+    const unsigned pushes = DATA_SIZE / 64;
+    BitstreamQueue *queue = br_open_queue(BS_BIG_ENDIAN);
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < pushes; i++) {
+        queue->push(queue, 64, bench_data + (i * 64));
+    }
+    bench_stop();
+
+    queue->close(queue);
+    return pushes;
+}
+
+uint64_t
+bench_queue_cycle(backend_t backend)
+{
+    /*pushes to a queue while consuming from it,
+      as when decoding packets as they arrive*/
+    const unsigned pushes = DATA_SIZE / 1000;
+    BitstreamQueue *queue = br_open_queue(BS_BIG_ENDIAN);
+    BitstreamReader *reader = (BitstreamReader*)queue;
+    unsigned i;
+
+    queue->push(queue, 4096, bench_data);
+
+    bench_start();
+    for (i = 0; i < pushes; i++) {
+        queue->push(queue, 1000, bench_data + (i * 1000));
+        reader->skip_bytes(reader, 1000);
+    }
+    bench_stop();
+
+    queue->close(queue);
+    return pushes;
+}
+
+uint64_t
+bench_a_int_append(backend_t backend)
+{
+    const unsigned appends = 1000000;
+    a_int *array = a_int_new();
+    unsigned i;
+
+    bench_start();
+    for (i = 0; i < appends; i++) {
+        array->append(array, (int)i);
+        if ((i % 65536) == 65535) {
+            array->reset(array);
+        }
+    }
+    bench_stop();
+
+    array->del(array);
+    return appends;
+}
+
+uint64_t
+bench_a_int_extend(backend_t backend)
+{
+    const unsigned extends = 50000;
+    a_int *array = a_int_new();
+    a_int *to_add = a_int_new();
+    unsigned i;
+
+    for (i = 0; i < 256; i++) {
+        to_add->append(to_add, (int)i);
+    }
+
+    bench_start();
+    for (i = 0; i < extends; i++) {
+        array->extend(array, to_add);
+        if ((i % 256) == 255) {
+            array->reset(array);
+        }
+    }
+    bench_stop();
+
+    to_add->del(to_add);
+    array->del(array);
+    return extends;
+}
+
+uint64_t
+bench_a_int_de_head(backend_t backend)
+{
+    /*drops consumed samples from the front of a buffer*/
+    const unsigned de_heads = 100000;
+    a_int *array = a_int_new();
+    a_int *remainder = a_int_new();
+    unsigned i;
+
+    for (i = 0; i < 4096; i++) {
+        array->append(array, (int)i);
+    }
+
+    bench_start();
+    for (i = 0; i < de_heads; i++) {
+        array->de_head(array, 16, remainder);
+    }
+    bench_stop();
+
+    remainder->del(remainder);
+    array->del(array);
+    return de_heads;
+}
+
+uint64_t
+bench_a_int_tail(backend_t backend)
+{
+    const unsigned tails = 100000;
+    a_int *array = a_int_new();
+    a_int *tail = a_int_new();
+    unsigned i;
+
+    for (i = 0; i < 4096; i++) {
+        array->append(array, (int)i);
+    }
+
+    bench_start();
+    for (i = 0; i < tails; i++) {
+        array->tail(array, 256, tail);
+    }
+    bench_stop();
+
+    tail->del(tail);
+    array->del(array);
+    return tails;
+}
+
+double
+run_benchmark(benchmark_f run, backend_t backend, unsigned runs)
+{
+    double fastest = 0.0;
+    unsigned i;
+
+    for (i = 0; i < runs; i++) {
+        uint64_t operations;
+        double ns_per_op;
+
+        bench_elapsed = 0;
+        operations = run(backend);
+        ns_per_op = (double)bench_elapsed / operations;
+        if ((i == 0) || (ns_per_op < fastest)) {
+            fastest = ns_per_op;
+        }
+    }
+
+    return fastest;
+}
+
+int
+read_baseline(const char *path, struct result **baseline)
+{
+    FILE *file;
+    struct result result;
+    int count = 0;
+
+    if ((file = fopen(path, "r")) == NULL) {
+        return -1;
+    }
+
+    *baseline = NULL;
+    while (fscanf(file, "%63s %lf", result.name, &result.ns_per_op) == 2) {
+        *baseline = realloc(*baseline, (count + 1) * sizeof(struct result));
+        (*baseline)[count++] = result;
+    }
+
+    fclose(file);
+    return count;
+}
+
+const struct result*
+find_result(const struct result *results, int count, const char *name)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (!strcmp(results[i].name, name)) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,607 @@
+/********************************************************
+ DVD-A Library, a module for reading DVD-Audio discs
+ Copyright (C) 2014-2015  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#include <stdio.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "dvd-audio.h"
+#include "aob.h"
+#include "packet.h"
+#include "pcm.h"
+#include "mlp.h"
+#ifdef HAS_CPPM
+#include "cppm/cppm.h"
+#endif
+
+/*dvda-bench times each stage of the decoding pipeline on its own
+  over a disc's title set
+
+  the sectors are read from disc and put through CPPM decryption
+  in the first pass, demuxed to packets with PCM packets unswizzled
+  in the second pass, and fully decoded with dvda_read() in the third
+
+  the MLP stages are timed within the decoder itself,
+  which is why this links against an mlp.c built with MLP_STAGE_TIMING*/
+
+#define SECTOR_SIZE 2048
+#define BUFFER_SIZE 4096
+
+#define PCM_CODEC_ID 0xA0
+
+typedef enum {
+    STAGE_AOB_READ,
+    STAGE_CPPM_DECRYPT,
+    STAGE_PACKET_DEMUX,
+    STAGE_PCM_UNSWIZZLE,
+    STAGE_MLP_RESIDUALS,
+    STAGE_MLP_FILTERING,
+    STAGE_MLP_REMATRIX,
+    STAGE_MLP_OUTPUT,
+    STAGE_DVDA_READ,
+    STAGE_COUNT
+} stage_t;
+
+static const char* const STAGE_NAME[STAGE_COUNT] = {
+    "aob_read",
+    "cppm_decrypt",
+    "packet_demux",
+    "pcm_unswizzle",
+    "mlp_residuals",
+    "mlp_filtering",
+    "mlp_rematrix",
+    "mlp_output",
+    "dvda_read"
+};
+
+struct stage {
+    int measured;
+    uint64_t nanoseconds;
+
+    /*the bytes of input the stage processes*/
+    uint64_t bytes;
+};
+
+/*the decoded output of the title set, split by codec*/
+struct audio_totals {
+    uint64_t samples;   /*PCM frames times channel count*/
+    double seconds;     /*playback time*/
+};
+
+struct bench {
+    struct stage stage[STAGE_COUNT];
+    struct audio_totals pcm;
+    struct audio_totals mlp;
+};
+
+void
+display_options(const char *progname, FILE *output);
+
+uint64_t
+bench_clock(void);
+
+/*reads every sector of the title set
+  and runs a copy of each through CPPM decryption
+
+  returns 0 on success, 1 if the title set's AOBs can't be opened*/
+int
+bench_sectors(const char *audio_ts,
+              const char *cdrom,
+              unsigned titleset_num,
+              struct bench *bench);
+
+/*splits the title set's sectors into packets
+  and unswizzles the samples of every PCM packet
+
+  returns 0 on success, 1 if the title set's AOBs can't be opened*/
+int
+bench_packets(const char *audio_ts,
+              const char *cdrom,
+              unsigned titleset_num,
+              struct bench *bench);
+
+/*decodes every title of the title set with dvda_read()*/
+void
+bench_titles(DVDA_Titleset *titleset, struct bench *bench);
+
+void
+display_results(const struct bench *bench, FILE *output);
+
+void
+display_results_json(const struct bench *bench,
+                     const char *audio_ts,
+                     unsigned titleset_num,
+                     FILE *output);
+
+int
+main(int argc, char *argv[])
+{
+    char* progname = argv[0];
+    char* audio_ts = NULL;
+    char* cdrom = NULL;
+    unsigned titleset_num = 1;
+    int json = 0;
+
+    /*parse arguments*/
+    static struct option long_options[] = {
+        {"audio_ts", required_argument, 0, 'A'},
+        {"cdrom", required_argument, 0, 'c'},
+        {"titleset", required_argument, 0, 's'},
+        {"json", no_argument, 0, 'j'},
+        {"help", no_argument, 0, 'h'},
+        {"version", no_argument, 0, 'v'},
+        {0, 0, 0, 0}
+    };
+
+    int option_index = 0;
+    int c;
+
+    DVDA* dvda;
+    DVDA_Titleset* titleset;
+    struct bench bench;
+
+    do {
+        c = getopt_long(argc, argv, "A:c:s:jh", long_options, &option_index);
+
+        switch (c) {
+        case 'h':
+            display_options(progname, stdout);
+            return 0;
+        case 'v':
+            printf("libDVD-Audio %s\n", LIBDVDAUDIO_VERSION_STRING);
+            return 0;
+        case 'A':
+            audio_ts = optarg;
+            break;
+        case 'c':
+            cdrom = optarg;
+            break;
+        case 's':
+            titleset_num = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            json = 1;
+            break;
+        case '?':
+            return 1;
+        case 0:
+        case -1:
+            break;
+        }
+    } while (c != -1);
+
+    if (!audio_ts) {
+        display_options(progname, stdout);
+        return 0;
+    }
+
+    /*open DVD-A*/
+    if ((dvda = dvda_open(audio_ts, cdrom)) == NULL) {
+        fprintf(stderr,
+                "*** Error: \"%s\""
+                " does not appear to be a valid AUDIO_TS path\n",
+                audio_ts);
+        return 1;
+    }
+
+    if ((titleset = dvda_open_titleset(dvda, titleset_num)) == NULL) {
+        fprintf(stderr, "*** Error: unable to open title set %u\n",
+                titleset_num);
+        dvda_close(dvda);
+        return 1;
+    }
+
+    memset(&bench, 0, sizeof(bench));
+
+    if (bench_sectors(audio_ts, cdrom, titleset_num, &bench) ||
+        bench_packets(audio_ts, cdrom, titleset_num, &bench)) {
+        fprintf(stderr, "*** Error: unable to read title set %u\n",
+                titleset_num);
+        dvda_close_titleset(titleset);
+        dvda_close(dvda);
+        return 1;
+    }
+
+    bench_titles(titleset, &bench);
+
+    dvda_close_titleset(titleset);
+    dvda_close(dvda);
+
+    if (json) {
+        display_results_json(&bench, audio_ts, titleset_num, stdout);
+    } else {
+        display_results(&bench, stdout);
+    }
+
+    return 0;
+}
+
+void
+display_options(const char *progname, FILE *output)
+{
+    fprintf(output, "*** Usage : %s -A [AUDIO_TS] [OPTIONS]\n", progname);
+    fprintf(output, "Options:\n");
+    fprintf(output, "  -h, --help                "
+            "show this help message and exit\n");
+    fprintf(output, "  --version                 "
+            "display version number and exit\n");
+    fprintf(output, "  -A PATH, --audio_ts=PATH  "
+            "path to disc's AUDIO_TS directory\n");
+    fprintf(output, "  -c DEVICE, --cdrom=DEVICE "
+            "optional path to disc's cdrom device\n");
+    fprintf(output, "  -s NUM, --titleset=NUM    "
+            "title set to benchmark, 1 if omitted\n");
+    fprintf(output, "  -j, --json                "
+            "display results as JSON\n");
+}
+
+uint64_t
+bench_clock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+int
+bench_sectors(const char *audio_ts,
+              const char *cdrom,
+              unsigned titleset_num,
+              struct bench *bench)
+{
+    struct stage *aob_read = &(bench->stage[STAGE_AOB_READ]);
+    AOB_Reader *aob_reader;
+    uint8_t sector[SECTOR_SIZE];
+#ifdef HAS_CPPM
+    struct stage *cppm_decrypt = &(bench->stage[STAGE_CPPM_DECRYPT]);
+    /*decryption takes the same time whatever the key,
+      so an arbitrary one stands in for the disc's*/
+    struct cppm_decoder cppm_decoder = {0, 0x0123456789ABCDULL, 0};
+    uint8_t encrypted[SECTOR_SIZE];
+#endif
+
+    if ((aob_reader = aob_reader_open(audio_ts,
+                                      cdrom,
+                                      titleset_num)) == NULL) {
+        return 1;
+    }
+
+    aob_read->measured = 1;
+#ifdef HAS_CPPM
+    cppm_decrypt->measured = 1;
+#endif
+
+    for (;;) {
+        uint64_t start = bench_clock();
+        const int error = aob_reader_read(aob_reader, sector);
+
+        aob_read->nanoseconds += bench_clock() - start;
+        if (error) {
+            break;
+        }
+        aob_read->bytes += SECTOR_SIZE;
+
+#ifdef HAS_CPPM
+        /*only pack sectors can be marked as encrypted,
+          and they're what a protected disc's sectors are*/
+        memcpy(encrypted, sector, SECTOR_SIZE);
+        encrypted[20] |= 0x10;
+        if (mpeg2_check_pes_scrambling_control(encrypted)) {
+            start = bench_clock();
+            cppm_decrypt_block(&cppm_decoder, encrypted, 1);
+            cppm_decrypt->nanoseconds += bench_clock() - start;
+            cppm_decrypt->bytes += SECTOR_SIZE;
+        }
+#endif
+    }
+
+    aob_reader_close(aob_reader);
+    return 0;
+}
+
+int
+bench_packets(const char *audio_ts,
+              const char *cdrom,
+              unsigned titleset_num,
+              struct bench *bench)
+{
+    struct stage *packet_demux = &(bench->stage[STAGE_PACKET_DEMUX]);
+    struct stage *pcm_unswizzle = &(bench->stage[STAGE_PCM_UNSWIZZLE]);
+    AOB_Reader *aob_reader;
+    Packet_Reader *packet_reader;
+    PCMDecoder *pcm_decoder = NULL;
+    unsigned decoder_bps = 0;
+    unsigned decoder_channels = 0;
+    a_int *samples = a_int_new();
+
+    if ((aob_reader = aob_reader_open(audio_ts,
+                                      cdrom,
+                                      titleset_num)) == NULL) {
+        samples->del(samples);
+        return 1;
+    }
+    packet_reader = packet_reader_open(aob_reader);
+
+    packet_demux->measured = 1;
+
+    for (;;) {
+        uint64_t start = bench_clock();
+        unsigned sector;
+        BitstreamReader *packet =
+            packet_reader_next_audio_packet(packet_reader, &sector);
+
+        packet_demux->nanoseconds += bench_clock() - start;
+        if (!packet) {
+            break;
+        }
+        packet_demux->bytes += packet->size(packet);
+
+        if (!setjmp(*br_try(packet))) {
+            unsigned pad_1_size;
+            unsigned codec_id;
+            unsigned pad_2_size;
+
+            packet->parse(packet, "16p 8u", &pad_1_size);
+            packet->skip_bytes(packet, pad_1_size);
+            packet->parse(packet, "8u 8p 8p 8u", &codec_id, &pad_2_size);
+
+            if (codec_id == PCM_CODEC_ID) {
+                struct stream_parameters parameters;
+                unsigned bps;
+                unsigned channels;
+
+                dvda_pcmdecoder_decode_params(packet, &parameters);
+                packet->skip_bytes(packet, pad_2_size - 9);
+
+                bps = dvda_unpack_bits_per_sample(parameters.group_0_bps);
+                channels =
+                    dvda_unpack_channel_count(parameters.channel_assignment);
+
+                if ((bps != decoder_bps) || (channels != decoder_channels)) {
+                    if (pcm_decoder) {
+                        dvda_close_pcmdecoder(pcm_decoder);
+                    }
+                    pcm_decoder = dvda_open_pcmdecoder(bps, channels);
+                    decoder_bps = bps;
+                    decoder_channels = channels;
+                }
+
+                pcm_unswizzle->bytes += packet->size(packet);
+                samples->reset(samples);
+                start = bench_clock();
+                dvda_pcmdecoder_decode_packet(pcm_decoder, packet, samples);
+                pcm_unswizzle->nanoseconds += bench_clock() - start;
+            }
+            br_etry(packet);
+        } else {
+            /*skip any truncated packet*/
+            br_etry(packet);
+        }
+        packet->close(packet);
+    }
+
+    /*title sets without PCM have nothing to unswizzle*/
+    pcm_unswizzle->measured = (pcm_unswizzle->bytes != 0);
+
+    /*demuxing pulls sectors through the AOB reader,
+      so take out the time the first pass spent reading them*/
+    if (packet_demux->nanoseconds >
+        bench->stage[STAGE_AOB_READ].nanoseconds) {
+        packet_demux->nanoseconds -=
+            bench->stage[STAGE_AOB_READ].nanoseconds;
+    } else {
+        packet_demux->nanoseconds = 0;
+    }
+
+    if (pcm_decoder) {
+        dvda_close_pcmdecoder(pcm_decoder);
+    }
+    samples->del(samples);
+    packet_reader_close(packet_reader);
+    return 0;
+}
+
+void
+bench_titles(DVDA_Titleset *titleset, struct bench *bench)
+{
+    struct stage *dvda_read_stage = &(bench->stage[STAGE_DVDA_READ]);
+    const unsigned title_count = dvda_title_count(titleset);
+    int *buffer = NULL;
+    unsigned buffer_channels = 0;
+    unsigned t;
+
+    memset(&dvda_mlp_stage_timing, 0, sizeof(dvda_mlp_stage_timing));
+    dvda_read_stage->measured = 1;
+
+    for (t = 1; t <= title_count; t++) {
+        DVDA_Title *title;
+        DVDA_Track_Reader *reader;
+        uint64_t start;
+        uint64_t pcm_frames = 0;
+        unsigned channels;
+        unsigned frames_read;
+        struct audio_totals *totals;
+
+        if ((title = dvda_open_title(titleset, t)) == NULL) {
+            continue;
+        }
+
+        start = bench_clock();
+        if ((reader = dvda_open_title_reader(title)) == NULL) {
+            dvda_close_title(title);
+            continue;
+        }
+
+        channels = dvda_channel_count(reader);
+        if (channels > buffer_channels) {
+            buffer = realloc(buffer, sizeof(int) * channels * BUFFER_SIZE);
+            buffer_channels = channels;
+        }
+
+        while ((frames_read = dvda_read(reader, BUFFER_SIZE, buffer)) > 0) {
+            pcm_frames += frames_read;
+        }
+        dvda_read_stage->nanoseconds += bench_clock() - start;
+
+        totals = (dvda_codec(reader) == DVDA_MLP) ?
+            &(bench->mlp) : &(bench->pcm);
+        totals->samples += pcm_frames * channels;
+        totals->seconds += (double)pcm_frames / dvda_sample_rate(reader);
+
+        dvda_close_track_reader(reader);
+        dvda_close_title(title);
+    }
+
+    free(buffer);
+
+    /*dvda_read() covers every packet
+      and the MLP stages cover the MLP packets among them*/
+    dvda_read_stage->bytes = bench->stage[STAGE_PACKET_DEMUX].bytes;
+
+    if (bench->mlp.samples) {
+        const uint64_t mlp_bytes =
+            bench->stage[STAGE_PACKET_DEMUX].bytes -
+            bench->stage[STAGE_PCM_UNSWIZZLE].bytes;
+        const struct {
+            stage_t stage;
+            uint64_t nanoseconds;
+        } mlp_stages[] = {
+            {STAGE_MLP_RESIDUALS, dvda_mlp_stage_timing.residuals},
+            {STAGE_MLP_FILTERING, dvda_mlp_stage_timing.filtering},
+            {STAGE_MLP_REMATRIX, dvda_mlp_stage_timing.rematrix},
+            {STAGE_MLP_OUTPUT, dvda_mlp_stage_timing.output}
+        };
+        unsigned i;
+
+        for (i = 0; i < sizeof(mlp_stages) / sizeof(mlp_stages[0]); i++) {
+            struct stage *stage = &(bench->stage[mlp_stages[i].stage]);
+            stage->measured = 1;
+            stage->nanoseconds = mlp_stages[i].nanoseconds;
+            stage->bytes = mlp_bytes;
+        }
+    }
+}
+
+/*returns the decoded audio a stage's input holds*/
+static struct audio_totals
+stage_audio(const struct bench *bench, stage_t stage)
+{
+    struct audio_totals totals;
+
+    switch (stage) {
+    case STAGE_PCM_UNSWIZZLE:
+        return bench->pcm;
+    case STAGE_MLP_RESIDUALS:
+    case STAGE_MLP_FILTERING:
+    case STAGE_MLP_REMATRIX:
+    case STAGE_MLP_OUTPUT:
+        return bench->mlp;
+    default:
+        totals.samples = bench->pcm.samples + bench->mlp.samples;
+        totals.seconds = bench->pcm.seconds + bench->mlp.seconds;
+        return totals;
+    }
+}
+
+/*returns amount per second over the given number of nanoseconds,
+  or 0 if no time was spent*/
+static double
+per_second(double amount, uint64_t nanoseconds)
+{
+    return nanoseconds ? (amount * 1e9 / nanoseconds) : 0.0;
+}
+
+void
+display_results(const struct bench *bench, FILE *output)
+{
+    stage_t s;
+
+    fprintf(output, "%-14s %10s %10s %14s %10s\n",
+            "stage", "seconds", "MB/s", "samples/s", "realtime");
+
+    for (s = 0; s < STAGE_COUNT; s++) {
+        const struct stage *stage = &(bench->stage[s]);
+        const struct audio_totals audio = stage_audio(bench, s);
+
+        if (!stage->measured) {
+            fprintf(output, "%-14s %10s\n", STAGE_NAME[s], "n/a");
+            continue;
+        }
+
+        fprintf(output, "%-14s %10.4f %10.1f %14.0f %9.1fx\n",
+                STAGE_NAME[s],
+                stage->nanoseconds / 1e9,
+                per_second(stage->bytes / 1e6, stage->nanoseconds),
+                per_second(audio.samples, stage->nanoseconds),
+                per_second(audio.seconds, stage->nanoseconds));
+    }
+}
+
+void
+display_results_json(const struct bench *bench,
+                     const char *audio_ts,
+                     unsigned titleset_num,
+                     FILE *output)
+{
+    const char *c;
+    stage_t s;
+
+    fputs("{\n  \"audio_ts\": \"", output);
+    for (c = audio_ts; *c; c++) {
+        if ((*c == '"') || (*c == '\\')) {
+            fputc('\\', output);
+        }
+        fputc(*c, output);
+    }
+    fputs("\",\n", output);
+    fprintf(output, "  \"titleset\": %u,\n", titleset_num);
+    fprintf(output, "  \"pcm\": {\"samples\": %llu, \"seconds\": %.3f},\n",
+            (unsigned long long)bench->pcm.samples, bench->pcm.seconds);
+    fprintf(output, "  \"mlp\": {\"samples\": %llu, \"seconds\": %.3f},\n",
+            (unsigned long long)bench->mlp.samples, bench->mlp.seconds);
+    fputs("  \"stages\": [\n", output);
+
+    for (s = 0; s < STAGE_COUNT; s++) {
+        const struct stage *stage = &(bench->stage[s]);
+        const struct audio_totals audio = stage_audio(bench, s);
+
+        fprintf(output, "    {\"name\": \"%s\", ", STAGE_NAME[s]);
+        if (stage->measured) {
+            fprintf(output,
+                    "\"seconds\": %.6f, "
+                    "\"bytes\": %llu, "
+                    "\"mb_per_second\": %.3f, "
+                    "\"samples_per_second\": %.0f, "
+                    "\"realtime\": %.3f}",
+                    stage->nanoseconds / 1e9,
+                    (unsigned long long)stage->bytes,
+                    per_second(stage->bytes / 1e6, stage->nanoseconds),
+                    per_second(audio.samples, stage->nanoseconds),
+                    per_second(audio.seconds, stage->nanoseconds));
+        } else {
+            fputs("\"seconds\": null}", output);
+        }
+        fputs(((s + 1) < STAGE_COUNT) ? ",\n" : "\n", output);
+    }
+
+    fputs("  ]\n}\n", output);
+}
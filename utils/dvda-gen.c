@@ -0,0 +1,932 @@
+/********************************************************
+ DVD-A Library, a module for reading DVD-Audio discs
+ Copyright (C) 2014-2015  Brian Langenberger
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*******************************************************/
+
+#include <stdio.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "dvd-audio.h"
+#include "bitstream.h"
+#include "pcm.h"
+#include "stream_parameters.h"
+
+/*dvda-gen writes a synthetic AUDIO_TS directory of PCM titles
+  for benchmarks and tests which can't rely on commercial discs
+
+  every channel of every track holds a sine wave
+  whose frequency depends on the channel,
+  continuing from one track to the next within a title*/
+
+#define SECTOR_SIZE 2048
+
+/*a title set may have at most 9 AOB files
+  of at most 1 GiB each*/
+#define MAX_AOBS 9
+#define MAX_AOB_SECTORS (1 << 19)
+
+#define MAX_TRACKS 99
+
+#define PACK_HEADER_SIZE 14
+#define PACKET_HEADER_SIZE 6
+
+/*the audio packet header, without any pad 1 bytes,
+  followed by the 9 bytes of PCM stream parameters*/
+#define PCM_HEADER_SIZE (3 + 4 + 9)
+
+#define AUDIO_STREAM_ID 0xBD
+#define PADDING_STREAM_ID 0xBE
+#define PCM_CODEC_ID 0xA0
+
+#define CHANNEL_ASSIGNMENTS 21
+
+static const unsigned SAMPLE_RATES[] = {
+    44100, 48000, 88200, 96000, 176400, 192000};
+
+static const unsigned BITS_PER_SAMPLE[] = {16, 24};
+
+struct layout {
+    unsigned sample_rate;
+    unsigned bits_per_sample;
+    unsigned channel_assignment;
+};
+
+struct track {
+    unsigned pcm_frames;
+    unsigned pts_length;
+    unsigned first_sector;
+    unsigned last_sector;
+};
+
+struct title {
+    struct layout layout;
+    unsigned track_count;
+    struct track track[MAX_TRACKS];
+};
+
+/*writes a title set's sectors across as many AOB files as needed*/
+struct aob_writer {
+    const char *audio_ts;
+    unsigned titleset;
+    unsigned aob_sectors;   /*the most sectors in each AOB*/
+    unsigned aob_number;
+    FILE *aob;
+    unsigned sector;        /*sectors written to the title set so far*/
+};
+
+/*the sector being filled with packets*/
+struct sector {
+    uint8_t data[SECTOR_SIZE];
+    unsigned size;
+};
+
+void
+display_options(const char *progname, FILE *output);
+
+/*parses a comma-separated list of track lengths in PCM frames
+
+  returns the number of tracks, or 0 if the list is invalid*/
+unsigned
+parse_track_lengths(const char *list, unsigned lengths[]);
+
+char*
+join_paths(const char *path1, const char *path2);
+
+/*creates the directory at path along with any missing parents,
+  setting created to the length of the shortest leading part of path
+  that didn't exist, or 0 if the whole path already existed
+
+  returns 0 on success, 1 on error*/
+int
+make_directories(const char *path, size_t *created);
+
+/*removes the directories made by make_directories(), deepest first*/
+void
+remove_directories(const char *path, size_t created);
+
+/*removes any files written to audio_ts for the given number of title sets
+  so a failed run leaves no partial disc behind*/
+void
+remove_output(const char *audio_ts, unsigned titleset_count);
+
+/*returns the 4 bit packed field of a sample rate
+  or bits-per-sample, or -1 if it isn't supported*/
+int
+pack_sample_rate(unsigned sample_rate);
+
+int
+pack_bits_per_sample(unsigned bits_per_sample);
+
+/*returns the PTS length nearest to the given number of PCM frames
+  whose own length in PCM frames, as readers round it, is even
+  and places that length in pcm_frames*/
+unsigned
+track_pts_length(unsigned requested_frames,
+                 unsigned sample_rate,
+                 unsigned *pcm_frames);
+
+/*writes a title set of the given titles, all of whose layouts are set,
+  to ATS_XX_0.IFO and ATS_XX_N.AOB files in audio_ts
+
+  each title's tracks have the given lengths in PCM frames
+  and with mid_sector set, every track but the first
+  starts in the same sector as its predecessor's last packet
+
+  returns 0 on success, 1 on error*/
+int
+write_titleset(const char *audio_ts,
+               unsigned titleset,
+               unsigned aob_sectors,
+               int mid_sector,
+               unsigned title_count,
+               struct title titles[],
+               const unsigned track_lengths[],
+               unsigned track_count);
+
+/*writes the title's packets, filling in its track's sector numbers*/
+int
+write_title_audio(struct aob_writer *writer,
+                  int mid_sector,
+                  struct title *title);
+
+int
+write_sector(struct aob_writer *writer, struct sector *sector);
+
+void
+write_ats_ifo(BitstreamWriter *ifo,
+              unsigned title_count,
+              const struct title titles[]);
+
+void
+write_audio_ts_ifo(BitstreamWriter *ifo, unsigned titleset_count);
+
+int
+write_file(const char *audio_ts,
+           const char *filename,
+           const BitstreamRecorder *data);
+
+int
+main(int argc, char *argv[])
+{
+    char* progname = argv[0];
+    char* audio_ts = NULL;
+    struct layout layout = {48000, 16, 1};
+    unsigned title_count = 1;
+    unsigned aob_sectors = MAX_AOB_SECTORS;
+    unsigned track_lengths[MAX_TRACKS] = {4800, 7201, 2400};
+    unsigned track_count = 3;
+    int mid_sector = 0;
+    int all_layouts = 0;
+    unsigned titleset_count;
+    size_t created;
+    unsigned i;
+
+    /*parse arguments*/
+    static struct option long_options[] = {
+        {"audio_ts", required_argument, 0, 'A'},
+        {"rate", required_argument, 0, 'r'},
+        {"bits", required_argument, 0, 'b'},
+        {"channels", required_argument, 0, 'c'},
+        {"titles", required_argument, 0, 'n'},
+        {"tracks", required_argument, 0, 't'},
+        {"aob-sectors", required_argument, 0, 's'},
+        {"mid-sector", no_argument, 0, 'm'},
+        {"all-layouts", no_argument, 0, 'a'},
+        {"help", no_argument, 0, 'h'},
+        {"version", no_argument, 0, 'v'},
+        {0, 0, 0, 0}
+    };
+
+    int option_index = 0;
+    int c;
+
+    BitstreamRecorder *ifo;
+
+    do {
+        c = getopt_long(argc, argv, "A:r:b:c:n:t:s:mah",
+                        long_options, &option_index);
+
+        switch (c) {
+        case 'h':
+            display_options(progname, stdout);
+            return 0;
+        case 'v':
+            printf("libDVD-Audio %s\n", LIBDVDAUDIO_VERSION_STRING);
+            return 0;
+        case 'A':
+            audio_ts = optarg;
+            break;
+        case 'r':
+            layout.sample_rate = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            layout.bits_per_sample = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            layout.channel_assignment = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            title_count = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            if ((track_count = parse_track_lengths(optarg,
+                                                   track_lengths)) == 0) {
+                fprintf(stderr, "*** Error: invalid track lengths \"%s\"\n",
+                        optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            aob_sectors = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            mid_sector = 1;
+            break;
+        case 'a':
+            all_layouts = 1;
+            break;
+        case '?':
+            return 1;
+        case 0:
+        case -1:
+            break;
+        }
+    } while (c != -1);
+
+    if (!audio_ts) {
+        display_options(progname, stdout);
+        return 0;
+    }
+
+    if (pack_sample_rate(layout.sample_rate) < 0) {
+        fprintf(stderr, "*** Error: unsupported sample rate %u\n",
+                layout.sample_rate);
+        return 1;
+    }
+    if (pack_bits_per_sample(layout.bits_per_sample) < 0) {
+        fprintf(stderr, "*** Error: unsupported bits per sample %u\n",
+                layout.bits_per_sample);
+        return 1;
+    }
+    if (layout.channel_assignment >= CHANNEL_ASSIGNMENTS) {
+        fprintf(stderr, "*** Error: channel assignment must be 0 to %d\n",
+                CHANNEL_ASSIGNMENTS - 1);
+        return 1;
+    }
+    if ((title_count == 0) || (title_count > 99)) {
+        fprintf(stderr, "*** Error: title count must be 1 to 99\n");
+        return 1;
+    }
+    if ((aob_sectors == 0) || (aob_sectors > MAX_AOB_SECTORS)) {
+        fprintf(stderr, "*** Error: AOB sectors must be 1 to %d\n",
+                MAX_AOB_SECTORS);
+        return 1;
+    }
+
+    if (make_directories(audio_ts, &created)) {
+        return 1;
+    }
+
+    if (all_layouts) {
+        /*one title set per channel assignment,
+          each with a title per sample rate and bits-per-sample*/
+        const unsigned rates = sizeof(SAMPLE_RATES) / sizeof(unsigned);
+        const unsigned depths = sizeof(BITS_PER_SAMPLE) / sizeof(unsigned);
+        struct title *titles = malloc(rates * depths * sizeof(struct title));
+
+        titleset_count = CHANNEL_ASSIGNMENTS;
+        for (i = 0; i < titleset_count; i++) {
+            unsigned r;
+            unsigned b;
+
+            for (r = 0; r < rates; r++) {
+                for (b = 0; b < depths; b++) {
+                    struct layout *title_layout =
+                        &(titles[(r * depths) + b].layout);
+                    title_layout->sample_rate = SAMPLE_RATES[r];
+                    title_layout->bits_per_sample = BITS_PER_SAMPLE[b];
+                    title_layout->channel_assignment = i;
+                }
+            }
+
+            if (write_titleset(audio_ts,
+                               i + 1,
+                               aob_sectors,
+                               mid_sector,
+                               rates * depths,
+                               titles,
+                               track_lengths,
+                               track_count)) {
+                free(titles);
+                goto error;
+            }
+        }
+        free(titles);
+    } else {
+        struct title *titles = malloc(title_count * sizeof(struct title));
+
+        titleset_count = 1;
+        for (i = 0; i < title_count; i++) {
+            titles[i].layout = layout;
+        }
+        if (write_titleset(audio_ts,
+                           1,
+                           aob_sectors,
+                           mid_sector,
+                           title_count,
+                           titles,
+                           track_lengths,
+                           track_count)) {
+            free(titles);
+            goto error;
+        }
+        free(titles);
+    }
+
+    ifo = bw_open_recorder(BS_BIG_ENDIAN);
+    write_audio_ts_ifo((BitstreamWriter*)ifo, titleset_count);
+    if (write_file(audio_ts, "AUDIO_TS.IFO", ifo)) {
+        ifo->close(ifo);
+        goto error;
+    }
+    ifo->close(ifo);
+
+    return 0;
+
+error:
+    remove_output(audio_ts, titleset_count);
+    remove_directories(audio_ts, created);
+    return 1;
+}
+
+void
+display_options(const char *progname, FILE *output)
+{
+    fprintf(output, "*** Usage : %s -A [AUDIO_TS] [OPTIONS]\n", progname);
+    fprintf(output, "Options:\n");
+    fprintf(output, "  -h, --help                "
+            "show this help message and exit\n");
+    fprintf(output, "  --version                 "
+            "display version number and exit\n");
+    fprintf(output, "  -A PATH, --audio_ts=PATH  "
+            "AUDIO_TS directory to write, created if necessary\n");
+    fprintf(output, "  -r HZ, --rate=HZ          "
+            "sample rate, 48000 if omitted\n");
+    fprintf(output, "  -b BITS, --bits=BITS      "
+            "bits per sample, 16 or 24, 16 if omitted\n");
+    fprintf(output, "  -c NUM, --channels=NUM    "
+            "channel assignment from 0 to 20, 1 (stereo) if omitted\n");
+    fprintf(output, "  -n NUM, --titles=NUM      "
+            "number of titles, 1 if omitted\n");
+    fprintf(output, "  -t LIST, --tracks=LIST    "
+            "comma-separated track lengths in PCM frames\n"
+                    "                            "
+            "4800,7201,2400 if omitted\n");
+    fprintf(output, "  -s NUM, --aob-sectors=NUM "
+            "most sectors per AOB file, %d if omitted\n",
+            MAX_AOB_SECTORS);
+    fprintf(output, "  -m, --mid-sector          "
+            "start each track after the first partway through a sector\n");
+    fprintf(output, "  -a, --all-layouts         "
+            "write a title set per channel assignment\n"
+                    "                            "
+            "with a title per sample rate and bits per sample\n");
+}
+
+unsigned
+parse_track_lengths(const char *list, unsigned lengths[])
+{
+    unsigned count = 0;
+
+    for (;;) {
+        char *end;
+        const unsigned long length = strtoul(list, &end, 10);
+
+        if ((end == list) || (length == 0) || (length > 0xFFFFFF) ||
+            (count == MAX_TRACKS)) {
+            return 0;
+        }
+        lengths[count++] = (unsigned)length;
+
+        if (*end == ',') {
+            list = end + 1;
+        } else if (*end == '\0') {
+            return count;
+        } else {
+            return 0;
+        }
+    }
+}
+
+char*
+join_paths(const char *path1, const char *path2)
+{
+    char *joined = malloc(strlen(path1) + 1 + strlen(path2) + 1);
+
+    sprintf(joined, "%s/%s", path1, path2);
+    return joined;
+}
+
+int
+make_directories(const char *path, size_t *created)
+{
+    char *partial = malloc(strlen(path) + 1);
+    size_t i;
+
+    strcpy(partial, path);
+    *created = 0;
+
+    /*create each leading part of the path in turn,
+      skipping a leading slash*/
+    for (i = 1; i <= strlen(path); i++) {
+        if ((path[i] == '/') || (path[i] == '\0')) {
+            partial[i] = '\0';
+            if (mkdir(partial, 0755) == 0) {
+                if (*created == 0) {
+                    *created = i;
+                }
+            } else if (errno != EEXIST) {
+                fprintf(stderr, "*** Error: unable to create \"%s\"\n",
+                        partial);
+                free(partial);
+                remove_directories(path, *created);
+                return 1;
+            }
+            partial[i] = path[i];
+        }
+    }
+
+    free(partial);
+    if (path[0] == '\0') {
+        fprintf(stderr, "*** Error: unable to create \"\"\n");
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+void
+remove_directories(const char *path, size_t created)
+{
+    char *partial;
+
+    if (created == 0) {
+        return;
+    }
+
+    partial = malloc(strlen(path) + 1);
+    strcpy(partial, path);
+    for (;;) {
+        char *separator;
+
+        rmdir(partial);
+        separator = strrchr(partial, '/');
+        if ((separator == NULL) || ((size_t)(separator - partial) < created)) {
+            break;
+        }
+        *separator = '\0';
+    }
+    free(partial);
+}
+
+void
+remove_output(const char *audio_ts, unsigned titleset_count)
+{
+    unsigned titleset;
+    char *path;
+
+    for (titleset = 1; titleset <= titleset_count; titleset++) {
+        char filename[] = "ATS_XX_X.AOB";
+        unsigned aob;
+
+        snprintf(filename, sizeof(filename), "ATS_%2.2u_0.IFO", titleset);
+        path = join_paths(audio_ts, filename);
+        unlink(path);
+        free(path);
+        for (aob = 1; aob <= MAX_AOBS; aob++) {
+            snprintf(filename, sizeof(filename), "ATS_%2.2u_%1.1u.AOB",
+                     titleset, aob);
+            path = join_paths(audio_ts, filename);
+            unlink(path);
+            free(path);
+        }
+    }
+
+    path = join_paths(audio_ts, "AUDIO_TS.IFO");
+    unlink(path);
+    free(path);
+}
+
+int
+pack_sample_rate(unsigned sample_rate)
+{
+    int packed;
+
+    for (packed = 0; packed < 16; packed++) {
+        if (dvda_unpack_sample_rate(packed) == sample_rate) {
+            return packed;
+        }
+    }
+    return -1;
+}
+
+int
+pack_bits_per_sample(unsigned bits_per_sample)
+{
+    /*20 bits per sample is valid for MLP but not PCM*/
+    switch (bits_per_sample) {
+    case 16:
+        return 0;
+    case 24:
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+unsigned
+track_pts_length(unsigned requested_frames,
+                 unsigned sample_rate,
+                 unsigned *pcm_frames)
+{
+    unsigned pts_length =
+        (unsigned)lround((double)requested_frames * PTS_PER_SECOND /
+                         sample_rate);
+
+    for (;; pts_length++) {
+        const long frames =
+            lround((double)pts_length * sample_rate / PTS_PER_SECOND);
+
+        if ((frames > 0) && ((frames % 2) == 0)) {
+            *pcm_frames = (unsigned)frames;
+            return pts_length;
+        }
+    }
+}
+
+int
+write_titleset(const char *audio_ts,
+               unsigned titleset,
+               unsigned aob_sectors,
+               int mid_sector,
+               unsigned title_count,
+               struct title titles[],
+               const unsigned track_lengths[],
+               unsigned track_count)
+{
+    struct aob_writer writer;
+    BitstreamRecorder *ifo;
+    char ifo_name[] = "ATS_XX_0.IFO";
+    unsigned t;
+
+    writer.audio_ts = audio_ts;
+    writer.titleset = titleset;
+    writer.aob_sectors = aob_sectors;
+    writer.aob_number = 0;
+    writer.aob = NULL;
+    writer.sector = 0;
+
+    for (t = 0; t < title_count; t++) {
+        struct title *title = &(titles[t]);
+        unsigned i;
+
+        title->track_count = track_count;
+        for (i = 0; i < track_count; i++) {
+            title->track[i].pts_length =
+                track_pts_length(track_lengths[i],
+                                 title->layout.sample_rate,
+                                 &(title->track[i].pcm_frames));
+        }
+
+        if (write_title_audio(&writer, mid_sector, title)) {
+            if (writer.aob) {
+                fclose(writer.aob);
+            }
+            return 1;
+        }
+
+        printf("title set %u title %u: %uHz %u bits assignment %u, "
+               "sectors %u-%u, PCM frames",
+               titleset,
+               t + 1,
+               title->layout.sample_rate,
+               title->layout.bits_per_sample,
+               title->layout.channel_assignment,
+               title->track[0].first_sector,
+               title->track[track_count - 1].last_sector);
+        for (i = 0; i < track_count; i++) {
+            printf(" %u", title->track[i].pcm_frames);
+        }
+        printf("\n");
+    }
+
+    if (writer.aob) {
+        fclose(writer.aob);
+    }
+
+    ifo = bw_open_recorder(BS_BIG_ENDIAN);
+    write_ats_ifo((BitstreamWriter*)ifo, title_count, titles);
+    snprintf(ifo_name, sizeof(ifo_name), "ATS_%2.2u_0.IFO", titleset);
+    if (write_file(audio_ts, ifo_name, ifo)) {
+        ifo->close(ifo);
+        return 1;
+    }
+    ifo->close(ifo);
+
+    return 0;
+}
+
+int
+write_title_audio(struct aob_writer *writer,
+                  int mid_sector,
+                  struct title *title)
+{
+    const struct layout *layout = &(title->layout);
+    const unsigned channels =
+        dvda_unpack_channel_count(layout->channel_assignment);
+    const unsigned chunk_size =
+        (layout->bits_per_sample / 8) * channels * 2;
+    const unsigned smallest_packet =
+        PACKET_HEADER_SIZE + PCM_HEADER_SIZE + chunk_size;
+    const double amplitude = (1 << (layout->bits_per_sample - 2));
+    unsigned frame = 0;
+    struct sector sector;
+    unsigned t;
+
+    sector.size = 0;
+
+    for (t = 0; t < title->track_count; t++) {
+        struct track *track = &(title->track[t]);
+        unsigned chunks = track->pcm_frames / 2;
+
+        track->first_sector = UINT_MAX;
+
+        while (chunks) {
+            BitstreamRecorder *packet = bw_open_recorder(BS_BIG_ENDIAN);
+            BitstreamWriter *w = (BitstreamWriter*)packet;
+            unsigned space;
+            unsigned packet_chunks;
+            unsigned pad_1_size = 0;
+            int ends_sector;
+            unsigned i;
+
+            if (sector.size == 0) {
+                /*MPEG-2 pack header with zeroed timestamps*/
+                BitstreamRecorder *pack = bw_open_recorder(BS_BIG_ENDIAN);
+                pack->build((BitstreamWriter*)pack,
+                            "32u 2u 3u 1u 15u 1u 15u 1u 9u 1u 22u 2u 5u 3u",
+                            0x000001BA, 1, 0, 1, 0, 1, 0, 1, 0, 1,
+                            0, 3, 0, 0);
+                memcpy(sector.data, pack->data(pack), PACK_HEADER_SIZE);
+                sector.size = PACK_HEADER_SIZE;
+                pack->close(pack);
+            }
+
+            space = SECTOR_SIZE - sector.size -
+                PACKET_HEADER_SIZE - PCM_HEADER_SIZE;
+            packet_chunks = MIN(chunks, space / chunk_size);
+            chunks -= packet_chunks;
+            space -= packet_chunks * chunk_size;
+
+            /*the sector ends with this packet if nothing more fits
+              or the track ends and the next doesn't share the sector*/
+            ends_sector = (space < smallest_packet) ||
+                ((chunks == 0) &&
+                 (!mid_sector || ((t + 1) == title->track_count)));
+
+            /*fill the rest of an ending sector with pad 1 bytes
+              if there's no room for a padding packet*/
+            if (ends_sector && (space < PACKET_HEADER_SIZE)) {
+                pad_1_size = space;
+            }
+
+            w->build(w, "24u 8u 16u",
+                     1,
+                     AUDIO_STREAM_ID,
+                     PCM_HEADER_SIZE + pad_1_size +
+                     (packet_chunks * chunk_size));
+            w->build(w, "16p 8u", pad_1_size);
+            for (i = 0; i < pad_1_size; i++) {
+                w->write(w, 8, 0);
+            }
+            w->build(w, "8u 8p 8p 8u", PCM_CODEC_ID, 9);
+            w->build(w, "16u 8p 4u 4u 4u 4u 8p 8u 8p 8u",
+                     0,
+                     pack_bits_per_sample(layout->bits_per_sample),
+                     pack_bits_per_sample(layout->bits_per_sample),
+                     pack_sample_rate(layout->sample_rate),
+                     pack_sample_rate(layout->sample_rate),
+                     layout->channel_assignment,
+                     0);
+
+            for (i = 0; i < packet_chunks; i++) {
+                int samples[12];
+                uint8_t chunk[36];
+                unsigned f;
+                unsigned c;
+
+                for (f = 0; f < 2; f++) {
+                    for (c = 0; c < channels; c++) {
+                        samples[(f * channels) + c] = (int)lround(
+                            amplitude *
+                            sin(2 * M_PI * 110 * (c + 1) * (frame + f) /
+                                layout->sample_rate));
+                    }
+                }
+                frame += 2;
+
+                dvda_pcm_encode_chunk(layout->bits_per_sample,
+                                      channels,
+                                      samples,
+                                      chunk);
+                w->write_bytes(w, chunk, chunk_size);
+            }
+
+            memcpy(sector.data + sector.size,
+                   packet->data(packet),
+                   packet->bytes_written(packet));
+            sector.size += packet->bytes_written(packet);
+            packet->close(packet);
+
+            if (track->first_sector == UINT_MAX) {
+                track->first_sector = writer->sector;
+            }
+            track->last_sector = writer->sector;
+
+            if (ends_sector) {
+                if (write_sector(writer, &sector)) {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int
+write_sector(struct aob_writer *writer, struct sector *sector)
+{
+    const unsigned padding = SECTOR_SIZE - sector->size;
+
+    if (padding) {
+        /*fill the rest of the sector with a padding packet*/
+        sector->data[sector->size] = 0;
+        sector->data[sector->size + 1] = 0;
+        sector->data[sector->size + 2] = 1;
+        sector->data[sector->size + 3] = PADDING_STREAM_ID;
+        sector->data[sector->size + 4] =
+            (uint8_t)((padding - PACKET_HEADER_SIZE) >> 8);
+        sector->data[sector->size + 5] =
+            (uint8_t)(padding - PACKET_HEADER_SIZE);
+        memset(sector->data + sector->size + PACKET_HEADER_SIZE,
+               0,
+               padding - PACKET_HEADER_SIZE);
+    }
+
+    if ((writer->aob == NULL) ||
+        ((writer->sector % writer->aob_sectors) == 0)) {
+        /*move on to the next AOB*/
+        char aob_name[] = "ATS_XX_X.AOB";
+        char *aob_path;
+
+        if (writer->aob) {
+            fclose(writer->aob);
+            writer->aob = NULL;
+        }
+        if (writer->aob_number == MAX_AOBS) {
+            fprintf(stderr, "*** Error: title set %u needs more than %d "
+                    "AOB files\n", writer->titleset, MAX_AOBS);
+            return 1;
+        }
+        writer->aob_number += 1;
+        snprintf(aob_name, sizeof(aob_name), "ATS_%2.2u_%1.1u.AOB",
+                 writer->titleset, writer->aob_number);
+        aob_path = join_paths(writer->audio_ts, aob_name);
+        if ((writer->aob = fopen(aob_path, "wb")) == NULL) {
+            fprintf(stderr, "*** Error: unable to open \"%s\"\n", aob_path);
+            free(aob_path);
+            return 1;
+        }
+        free(aob_path);
+    }
+
+    if (fwrite(sector->data, 1, SECTOR_SIZE, writer->aob) != SECTOR_SIZE) {
+        fprintf(stderr, "*** Error: unable to write title set %u\n",
+                writer->titleset);
+        return 1;
+    }
+
+    writer->sector += 1;
+    sector->size = 0;
+    return 0;
+}
+
+void
+write_ats_ifo(BitstreamWriter *ifo,
+              unsigned title_count,
+              const struct title titles[])
+{
+    unsigned table_offset = 8 + (8 * title_count);
+    unsigned t;
+
+    /*identifier followed by the rest of the first sector*/
+    ifo->write_bytes(ifo, (const uint8_t*)"DVDAUDIO-ATS", 12);
+    ifo->build(ifo, "2036*8p");
+
+    /*title table whose offsets are relative to the second sector*/
+    ifo->build(ifo, "16u 16p 32p", title_count);
+    for (t = 0; t < title_count; t++) {
+        ifo->build(ifo, "8u 24p 32u", t + 1, table_offset);
+        table_offset += 16 + (32 * titles[t].track_count);
+    }
+
+    for (t = 0; t < title_count; t++) {
+        const struct title *title = &(titles[t]);
+        unsigned pts_length = 0;
+        unsigned pts_index = 0;
+        unsigned i;
+
+        for (i = 0; i < title->track_count; i++) {
+            pts_length += title->track[i].pts_length;
+        }
+
+        ifo->build(ifo, "16p 8u 8u 32u 32p 16u 16p",
+                   title->track_count,
+                   title->track_count,
+                   pts_length,
+                   16 + (20 * title->track_count));
+        for (i = 0; i < title->track_count; i++) {
+            ifo->build(ifo, "32p 8u 8p 32u 32u 48p",
+                       i + 1,
+                       pts_index,
+                       title->track[i].pts_length);
+            pts_index += title->track[i].pts_length;
+        }
+        for (i = 0; i < title->track_count; i++) {
+            ifo->build(ifo, "32u 32u 32u",
+                       i + 1,
+                       title->track[i].first_sector,
+                       title->track[i].last_sector);
+        }
+    }
+
+    /*pad the file to a whole sector*/
+    ifo->byte_align(ifo);
+    while (((BitstreamRecorder*)ifo)->bytes_written(
+               (BitstreamRecorder*)ifo) % SECTOR_SIZE) {
+        ifo->write(ifo, 8, 0);
+    }
+}
+
+void
+write_audio_ts_ifo(BitstreamWriter *ifo, unsigned titleset_count)
+{
+    ifo->write_bytes(ifo, (const uint8_t*)"DVDAUDIO-AMG", 12);
+    ifo->build(ifo, "51*8p 8u 1984*8p", titleset_count);
+}
+
+int
+write_file(const char *audio_ts,
+           const char *filename,
+           const BitstreamRecorder *data)
+{
+    char *path = join_paths(audio_ts, filename);
+    FILE *file;
+    size_t written;
+
+    if ((file = fopen(path, "wb")) == NULL) {
+        fprintf(stderr, "*** Error: unable to open \"%s\"\n", path);
+        free(path);
+        return 1;
+    }
+    written = fwrite(data->data(data), 1, data->bytes_written(data), file);
+    if (fclose(file) || (written != data->bytes_written(data))) {
+        fprintf(stderr, "*** Error: unable to write \"%s\"\n", path);
+        free(path);
+        return 1;
+    }
+    free(path);
+    return 0;
+}
@@ -21,11 +21,83 @@
 #include <getopt.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "dvd-audio.h"
 #include "bitstream.h"
 
 #define BUFFER_SIZE 4096
 
+/*the size of the RIFF WAVE header preceding the data chunk's samples*/
+#define WAVE_HEADER_SIZE 68
+
+/*the size of standard output's buffer when streaming to it*/
+#define STREAM_BUFFER_SIZE (1 << 20)
+
+struct wave_output {
+    FILE* log;
+    FILE* file;
+    char* output_path;
+
+    /*raw output has no header
+      and a header written to a stream that can't seek
+      is never rewritten, so the data is kept to the length it gives
+      unless the length wasn't known when it was written,
+      in which case it's open-ended and gives no length at all*/
+    int raw;
+    int seekable;
+    int open_ended;
+
+    unsigned sample_rate;
+    unsigned channel_count;
+    unsigned channel_mask;
+    unsigned bits_per_sample;
+
+    /*samples are stored in whole bytes, left-justified*/
+    unsigned bytes_per_sample;
+    unsigned sample_shift;
+
+    /*the PCM frame count in the header written so far
+      and the number of frames actually written*/
+    unsigned header_pcm_frames;
+    unsigned total_pcm_frames;
+
+    /*BUFFER_SIZE PCM frames packed as little-endian bytes*/
+    uint8_t* packed;
+};
+
+/*the state of a pass over a whole title set*/
+struct titleset_output {
+    const char* output_dir;
+    int is_open;
+    struct wave_output wave;
+};
+
+/*a track to be extracted by one of the -j workers*/
+struct extract_job {
+    DVDA_Title* title;
+    unsigned track_num;
+
+    /*the job's progress messages,
+      which are displayed in job order once it's finished*/
+    char* log_data;
+    size_t log_size;
+    int finished;
+};
+
+struct extract_pool {
+    struct extract_job* jobs;
+    unsigned job_count;
+    const char* output_dir;
+
+    /*the next job to be taken by a worker,
+      guarded by lock along with each job's finished flag*/
+    unsigned next_job;
+    pthread_mutex_t lock;
+    pthread_cond_t job_finished;
+};
+
 void
 display_options(const char *progname, FILE *output);
 
@@ -39,11 +111,97 @@ extract_tracks(DVDA* dvda, DVDA_Title* title,
 void
 extract_track(DVDA* dvda, DVDA_Title* title,
               unsigned track_num,
-              const char *output_dir);
+              const char *output_dir,
+              FILE *log);
 
-void
+/*extracts the title's track to output_path, where "-" is standard output,
+  as a RIFF WAVE file or as raw little-endian PCM with no header
+
+  returns 0 on success, 1 on failure*/
+int
+extract_track_output(DVDA_Title* title,
+                     unsigned track_num,
+                     const char *output_path,
+                     int raw,
+                     FILE *log);
+
+int
 extract_track_data(DVDA_Track_Reader* track_reader,
-                   const char *output_path);
+                   const char *output_path,
+                   unsigned total_pcm_frames,
+                   int raw,
+                   FILE *log);
+
+/*extracts the given title's track, or all titles or tracks if 0,
+  on a pool of worker threads with at most "workers" tracks in progress
+
+  returns 0 on success, 1 if a title can't be opened*/
+int
+extract_tracks_parallel(DVDA_Titleset* titleset,
+                        unsigned title_num,
+                        unsigned track_num,
+                        const char *output_dir,
+                        unsigned workers);
+
+void*
+extract_worker(void* data);
+
+/*extracts every track of the title set in a single pass over the disc*/
+int
+extract_titleset(DVDA_Titleset* titleset,
+                 const char *output_dir);
+
+/*opens a RIFF WAVE file at output_path for the reader's stream,
+  where "-" is standard output,
+  and writes its initial header unless raw is set,
+  with progress messages sent to log
+
+  total_pcm_frames is the stream's length if known in advance,
+  in which case the file is preallocated to its final size,
+  or 0 if not known, in which case a stream that can't seek
+  gets a header with RIFF and data sizes of 0xFFFFFFFF
+
+  returns 1 on success, 0 if the file can't be opened*/
+int
+open_wave_output(struct wave_output* wave,
+                 const DVDA_Track_Reader* track_reader,
+                 const char *output_path,
+                 unsigned total_pcm_frames,
+                 int raw,
+                 FILE *log);
+
+/*packs the PCM frames to little-endian bytes and writes them in bulk*/
+void
+write_wave_data(struct wave_output* wave,
+                const int buffer[],
+                unsigned pcm_frames);
+
+/*rewrites the RIFF WAVE header if the initial one's length was wrong
+  and closes the file
+
+  returns 0 on success, 1 if writing the file failed*/
+int
+close_wave_output(struct wave_output* wave);
+
+/*writes a RIFF WAVE header for the given number of PCM frames
+  at the file's current position*/
+void
+write_wave_file_header(struct wave_output* wave,
+                       unsigned total_pcm_frames);
+
+int
+titleset_start_track(void* sink_data,
+                     unsigned title_num,
+                     unsigned track_num,
+                     const DVDA_Track_Reader* track_reader);
+
+int
+titleset_write(void* sink_data,
+               const int buffer[],
+               unsigned pcm_frames);
+
+int
+titleset_finish_track(void* sink_data);
 
 void
 write_wave_header(BitstreamWriter* output,
@@ -60,8 +218,12 @@ main(int argc, char *argv[])
     char* audio_ts = NULL;
     char* cdrom = NULL;
     char* output_dir = ".";
+    char* output_path = NULL;
+    int raw = 0;
+    int single_pass = 0;
     unsigned title_num = 0;
     unsigned track_num = 0;
+    unsigned workers = 1;
 
     /*parse arguments*/
     static struct option long_options[] = {
@@ -70,6 +232,10 @@ main(int argc, char *argv[])
         {"title", required_argument, 0, 'T'},
         {"track", required_argument, 0, 't'},
         {"dir", required_argument, 0, 'd'},
+        {"jobs", required_argument, 0, 'j'},
+        {"output", required_argument, 0, 'o'},
+        {"raw", no_argument, 0, 'r'},
+        {"single-pass", no_argument, 0, 's'},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 'v'},
         {0, 0, 0, 0}
@@ -83,7 +249,7 @@ main(int argc, char *argv[])
     const unsigned titleset_num = 1;
 
     do {
-        c = getopt_long(argc, argv, "A:c:T:t:d:h", long_options, &option_index);
+        c = getopt_long(argc, argv, "A:c:T:t:d:j:o:rsh", long_options, &option_index);
 
         switch (c) {
         case 'h':
@@ -107,6 +273,21 @@ main(int argc, char *argv[])
         case 'd':
             output_dir = optarg;
             break;
+        case 'j':
+            if ((workers = (unsigned)strtoul(optarg, NULL, 10)) == 0) {
+                fprintf(stderr, "*** Error: jobs must be at least 1\n");
+                return 1;
+            }
+            break;
+        case 'o':
+            output_path = optarg;
+            break;
+        case 'r':
+            raw = 1;
+            break;
+        case 's':
+            single_pass = 1;
+            break;
         case '?':
             return 1;
         case 0:
@@ -138,8 +319,62 @@ main(int argc, char *argv[])
         return 0;
     }
 
-    if (title_num == 0) {
-        /*if no title indicated, extract them all*/
+    if (raw && !output_path) {
+        fprintf(stderr, "*** Error: -r only applies to a track "
+                "extracted with -o\n");
+        goto error;
+    }
+
+    if (single_pass &&
+        (title_num || track_num || output_path || (workers > 1))) {
+        fprintf(stderr, "*** Error: -s extracts the whole title set "
+                "and can't be combined with -T, -t, -o or -j\n");
+        goto error;
+    }
+
+    if (output_path) {
+        /*extract a single track to the given file or standard output,
+          in which case progress messages go to standard error*/
+        DVDA_Title* title;
+
+        if ((title_num == 0) || (track_num == 0)) {
+            fprintf(stderr, "*** Error: -o requires a single track "
+                    "selected with -T and -t\n");
+            goto error;
+        }
+        if ((title = dvda_open_title(titleset, title_num)) == NULL) {
+            fprintf(stderr, "*** Error: unable to open title %u\n",
+                    title_num);
+            goto error;
+        }
+        if (extract_track_output(title,
+                                 track_num,
+                                 output_path,
+                                 raw,
+                                 strcmp(output_path, "-") ?
+                                 stdout : stderr)) {
+            dvda_close_title(title);
+            goto error;
+        }
+        dvda_close_title(title);
+    } else if (workers > 1) {
+        /*extract tracks concurrently*/
+        if (extract_tracks_parallel(titleset,
+                                    title_num,
+                                    track_num,
+                                    output_dir,
+                                    workers)) {
+            goto error;
+        }
+    } else if (single_pass) {
+        /*extract everything in a single pass over the disc*/
+        if (extract_titleset(titleset, output_dir)) {
+            fprintf(stderr, "*** Error: unable to read title set %u\n",
+                    titleset_num);
+            goto error;
+        }
+    } else if (title_num == 0) {
+        /*if no title indicated, extract the track from them all*/
         for (title_num = 1;
              title_num <= dvda_title_count(titleset);
              title_num++) {
@@ -152,7 +387,7 @@ main(int argc, char *argv[])
              if (track_num == 0) {
                  extract_tracks(dvda, title, output_dir);
              } else {
-                 extract_track(dvda, title, track_num, output_dir);
+                 extract_track(dvda, title, track_num, output_dir, stdout);
              }
              dvda_close_title(title);
         }
@@ -166,7 +401,7 @@ main(int argc, char *argv[])
         if (track_num == 0) {
             extract_tracks(dvda, title, output_dir);
         } else {
-            extract_track(dvda, title, track_num, output_dir);
+            extract_track(dvda, title, track_num, output_dir, stdout);
         }
         dvda_close_title(title);
     }
@@ -208,6 +443,20 @@ display_options(const char *progname, FILE *output)
             "output directory to place extracted file\n"
                     "                            "
             "if omitted, the current working directory is used\n");
+    fprintf(output, "  -j N, --jobs=N            "
+            "number of tracks to extract concurrently\n");
+    fprintf(output, "  -o FILE, --output=FILE    "
+            "file to extract the track given by -T and -t to\n"
+                    "                            "
+            "or - to stream it to standard output\n");
+    fprintf(output, "  -r, --raw                 "
+            "with -o, write raw little-endian PCM with no header\n");
+    fprintf(output, "  -s, --single-pass         "
+            "extract all tracks in one pass over the disc\n"
+                    "                            "
+            "a track starting partway through a sector may\n"
+                    "                            "
+            "differ from the track extracted on its own\n");
 }
 
 static inline int
@@ -243,110 +492,534 @@ extract_tracks(DVDA* dvda, DVDA_Title* title,
 {
     unsigned track_num;
     for (track_num = 1; track_num <= dvda_track_count(title); track_num++) {
-        extract_track(dvda, title, track_num, output_dir);
+        extract_track(dvda, title, track_num, output_dir, stdout);
     }
 }
 
 void
 extract_track(DVDA* dvda, DVDA_Title* title,
               unsigned track_num,
-              const char *output_dir)
+              const char *output_dir,
+              FILE *log)
 {
-    DVDA_Track* track = dvda_open_track(title, track_num);
-    DVDA_Track_Reader* track_reader;
     char track_name[] = "track-XX-XX.wav";
     char *output_path;
 
+    snprintf(track_name, sizeof(track_name),
+             "track-%2.2d-%2.2d.wav",
+             dvda_title_number(title),
+             track_num);
+
+    output_path = join_paths(output_dir, track_name);
+
+    extract_track_output(title, track_num, output_path, 0, log);
+
+    free(output_path);
+}
+
+int
+extract_track_output(DVDA_Title* title,
+                     unsigned track_num,
+                     const char *output_path,
+                     int raw,
+                     FILE *log)
+{
+    DVDA_Track* track = dvda_open_track(title, track_num);
+    DVDA_Track_Reader* track_reader;
+    int result;
+
     if (!track) {
         fprintf(stderr, "*** Error: unable to open track %u\n", track_num);
-        return;
+        return 1;
     }
 
     if ((track_reader = dvda_open_track_reader(track)) == NULL) {
         fprintf(stderr, "*** Error: unable to open track %u for reading\n",
                 track_num);
         dvda_close_track(track);
-        return;
+        return 1;
     }
 
-    snprintf(track_name, sizeof(track_name),
-             "track-%2.2d-%2.2d.wav",
-             dvda_title_number(title),
-             dvda_track_number(track));
+    /*an MLP track's length is found from its frame headers alone,
+      but a PCM track's would take decoding it twice,
+      so its header is rewritten with the length once it's done*/
+    result = extract_track_data(track_reader,
+                                output_path,
+                                dvda_codec(track_reader) == DVDA_MLP ?
+                                dvda_track_pcm_frames(track) : 0,
+                                raw,
+                                log);
 
-    output_path = join_paths(output_dir, track_name);
     dvda_close_track(track);
-
-    extract_track_data(track_reader, output_path);
-
-    free(output_path);
     dvda_close_track_reader(track_reader);
+    return result;
 }
 
-void
+int
 extract_track_data(DVDA_Track_Reader* track_reader,
-                   const char *output_path)
+                   const char *output_path,
+                   unsigned total_pcm_frames,
+                   int raw,
+                   FILE *log)
 {
-    FILE *output_file;
-    BitstreamWriter *output;
-    const unsigned channel_count = dvda_channel_count(track_reader);
-    const unsigned bits_per_sample = dvda_bits_per_sample(track_reader);
-    int buffer[BUFFER_SIZE * channel_count];
+    struct wave_output wave;
+    int buffer[BUFFER_SIZE * dvda_channel_count(track_reader)];
     unsigned frames_read;
-    bw_pos_t *file_start;
-    unsigned total_pcm_frames = 0;
-    bw_write_signed_f write_signed;
 
-    if ((output_file = fopen(output_path, "wb")) == NULL) {
+    if (!open_wave_output(&wave,
+                          track_reader,
+                          output_path,
+                          total_pcm_frames,
+                          raw,
+                          log)) {
+        return 1;
+    }
+
+    /*transfer data from track reader to data chunk*/
+    while ((frames_read = dvda_read(track_reader,
+                                    BUFFER_SIZE,
+                                    buffer)) > 0) {
+        write_wave_data(&wave, buffer, frames_read);
+    }
+
+    return close_wave_output(&wave);
+}
+
+int
+extract_tracks_parallel(DVDA_Titleset* titleset,
+                        unsigned title_num,
+                        unsigned track_num,
+                        const char *output_dir,
+                        unsigned workers)
+{
+    const unsigned first_title = title_num ? title_num : 1;
+    const unsigned last_title =
+        title_num ? title_num : dvda_title_count(titleset);
+    DVDA_Title** titles =
+        malloc(sizeof(DVDA_Title*) * (last_title - first_title + 1));
+    unsigned title_count = 0;
+    struct extract_pool pool;
+    pthread_t* threads;
+    unsigned thread_count = 0;
+    unsigned i;
+    int result = 0;
+
+    /*titles are shared by all the workers,
+      which each open their own tracks and readers from them*/
+    pool.jobs = NULL;
+    pool.job_count = 0;
+    pool.output_dir = output_dir;
+    pool.next_job = 0;
+    for (title_num = first_title; title_num <= last_title; title_num++) {
+        DVDA_Title* title = dvda_open_title(titleset, title_num);
+        unsigned first_track;
+        unsigned last_track;
+
+        if (!title) {
+            fprintf(stderr, "*** Error: unable to open title %u\n",
+                    title_num);
+            result = 1;
+            goto finished;
+        }
+        titles[title_count++] = title;
+
+        if (track_num) {
+            first_track = last_track = track_num;
+        } else {
+            first_track = 1;
+            last_track = dvda_track_count(title);
+        }
+
+        pool.jobs = realloc(pool.jobs,
+                            sizeof(struct extract_job) *
+                            (pool.job_count +
+                             (last_track - first_track + 1)));
+        for (; first_track <= last_track; first_track++) {
+            struct extract_job* job = &pool.jobs[pool.job_count++];
+            job->title = title;
+            job->track_num = first_track;
+            job->log_data = NULL;
+            job->log_size = 0;
+            job->finished = 0;
+        }
+    }
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.job_finished, NULL);
+
+    threads = malloc(sizeof(pthread_t) * workers);
+    for (i = 0; (i < workers) && (i < pool.job_count); i++) {
+        if (pthread_create(&threads[thread_count],
+                           NULL,
+                           extract_worker,
+                           &pool) == 0) {
+            thread_count++;
+        }
+    }
+    if ((thread_count == 0) && (pool.job_count > 0)) {
+        /*no workers could be started, so extract on this thread*/
+        extract_worker(&pool);
+    }
+
+    /*display each job's messages in order as it finishes*/
+    for (i = 0; i < pool.job_count; i++) {
+        struct extract_job* job = &pool.jobs[i];
+
+        pthread_mutex_lock(&pool.lock);
+        while (!job->finished) {
+            pthread_cond_wait(&pool.job_finished, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
+
+        if (job->log_data) {
+            fwrite(job->log_data, 1, job->log_size, stdout);
+            fflush(stdout);
+            free(job->log_data);
+        }
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_cond_destroy(&pool.job_finished);
+    pthread_mutex_destroy(&pool.lock);
+
+finished:
+    free(pool.jobs);
+    for (i = 0; i < title_count; i++) {
+        dvda_close_title(titles[i]);
+    }
+    free(titles);
+    return result;
+}
+
+void*
+extract_worker(void* data)
+{
+    struct extract_pool* pool = data;
+
+    for (;;) {
+        struct extract_job* job;
+        FILE* log;
+
+        pthread_mutex_lock(&pool->lock);
+        if (pool->next_job == pool->job_count) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        job = &pool->jobs[pool->next_job++];
+        pthread_mutex_unlock(&pool->lock);
+
+        if ((log = open_memstream(&job->log_data, &job->log_size)) != NULL) {
+            extract_track(NULL, job->title, job->track_num,
+                          pool->output_dir, log);
+            fclose(log);
+        } else {
+            extract_track(NULL, job->title, job->track_num,
+                          pool->output_dir, stdout);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        job->finished = 1;
+        pthread_cond_broadcast(&pool->job_finished);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+int
+extract_titleset(DVDA_Titleset* titleset,
+                 const char *output_dir)
+{
+    const dvda_track_sink_t sink = {
+        titleset_start_track,
+        titleset_write,
+        titleset_finish_track
+    };
+    struct titleset_output titleset_output;
+
+    titleset_output.output_dir = output_dir;
+    titleset_output.is_open = 0;
+
+    return dvda_read_titleset(titleset, 0, &sink, &titleset_output);
+}
+
+int
+open_wave_output(struct wave_output* wave,
+                 const DVDA_Track_Reader* track_reader,
+                 const char *output_path,
+                 unsigned total_pcm_frames,
+                 int raw,
+                 FILE *log)
+{
+    FILE *output_file;
+
+    if (!strcmp(output_path, "-")) {
+        /*nothing else goes to standard output when streaming,
+          so it's safe to enlarge its buffer*/
+        output_file = stdout;
+        setvbuf(output_file, NULL, _IOFBF, STREAM_BUFFER_SIZE);
+    } else if ((output_file = fopen(output_path, "wb")) == NULL) {
         fprintf(stderr, "*** Error: unable to open \"%s\" for writing\n",
                 output_path);
-        return;
+        return 0;
     }
 
-    printf("* Extracting %s track  %u channels  %u Hz  %u bps\n",
-           (dvda_codec(track_reader) == DVDA_MLP ? "MLP" : "PCM"),
-           dvda_channel_count(track_reader),
-           dvda_sample_rate(track_reader),
-           dvda_bits_per_sample(track_reader));
+    fprintf(log, "* Extracting %s track  %u channels  %u Hz  %u bps\n",
+            (dvda_codec(track_reader) == DVDA_MLP ? "MLP" : "PCM"),
+            dvda_channel_count(track_reader),
+            dvda_sample_rate(track_reader),
+            dvda_bits_per_sample(track_reader));
+
+    wave->log = log;
+    wave->file = output_file;
+    wave->output_path = strdup(output_path);
+    wave->raw = raw;
+    wave->seekable = (fseek(output_file, 0, SEEK_CUR) == 0);
+    wave->open_ended = !wave->seekable && (total_pcm_frames == 0);
+    wave->sample_rate = dvda_sample_rate(track_reader);
+    wave->channel_count = dvda_channel_count(track_reader);
+    wave->channel_mask = dvda_riff_wave_channel_mask(track_reader);
+    wave->bits_per_sample = dvda_bits_per_sample(track_reader);
+    wave->bytes_per_sample = (wave->bits_per_sample + 7) / 8;
+    wave->sample_shift = wave->bytes_per_sample * 8 - wave->bits_per_sample;
+    wave->header_pcm_frames = 0;
+    wave->total_pcm_frames = 0;
+    wave->packed = malloc(BUFFER_SIZE *
+                          wave->channel_count *
+                          wave->bytes_per_sample);
 
-    output = bw_open(output_file, BS_LITTLE_ENDIAN);
-    write_signed = output->write_signed;
+    if (raw) {
+        return 1;
+    }
+
+#if defined(_POSIX_ADVISORY_INFO) && (_POSIX_ADVISORY_INFO > 0)
+    if (total_pcm_frames && wave->seekable) {
+        /*reserve the whole file up front
+          so it's laid out contiguously on disk*/
+        const off_t data_size = (off_t)total_pcm_frames *
+                                wave->channel_count *
+                                wave->bytes_per_sample;
+
+        posix_fallocate(fileno(output_file),
+                        0,
+                        WAVE_HEADER_SIZE + data_size + (data_size % 2));
+    }
+#endif
 
     /*write initial RIFF WAVE header*/
-    file_start = output->getpos(output);
-    write_wave_header(
-        output,
-        dvda_sample_rate(track_reader),
-        channel_count,
-        dvda_riff_wave_channel_mask(track_reader),
-        bits_per_sample,
-        total_pcm_frames);
+    write_wave_file_header(wave, total_pcm_frames);
 
-    /*transfer data from track reader to data chunk*/
-    while ((frames_read = dvda_read(track_reader,
-                                    BUFFER_SIZE,
-                                    buffer)) > 0) {
+    return 1;
+}
+
+void
+write_wave_data(struct wave_output* wave,
+                const int buffer[],
+                unsigned pcm_frames)
+{
+    const unsigned channel_count = wave->channel_count;
+    const unsigned sample_shift = wave->sample_shift;
+    /*samples are stored as their low bits and their sign,
+      as the BitstreamWriter's write_signed() did*/
+    const unsigned sign_bit = 1u << (wave->bits_per_sample - 1);
+    const unsigned value_mask = sign_bit - 1;
+
+    if (!wave->raw && !wave->seekable && !wave->open_ended) {
+        /*drop any frames past a streamed header's length*/
+        const unsigned remaining =
+            wave->header_pcm_frames - wave->total_pcm_frames;
+        if (pcm_frames > remaining) {
+            pcm_frames = remaining;
+        }
+    }
+
+    wave->total_pcm_frames += pcm_frames;
+
+    while (pcm_frames > 0) {
+        const unsigned frames = pcm_frames < BUFFER_SIZE ?
+                                pcm_frames : BUFFER_SIZE;
+        const unsigned samples = frames * channel_count;
+        uint8_t *packed = wave->packed;
         unsigned i;
-        for (i = 0; i < frames_read * channel_count; i++) {
-            write_signed(output, bits_per_sample, buffer[i]);
+
+        switch (wave->bytes_per_sample) {
+        case 2:
+            for (i = 0; i < samples; i++) {
+                const unsigned sample =
+                    (buffer[i] & value_mask) | (buffer[i] < 0 ? sign_bit : 0);
+                packed[0] = sample & 0xFF;
+                packed[1] = (sample >> 8) & 0xFF;
+                packed += 2;
+            }
+            break;
+        case 3:
+            for (i = 0; i < samples; i++) {
+                const unsigned sample =
+                    ((buffer[i] & value_mask) |
+                     (buffer[i] < 0 ? sign_bit : 0)) << sample_shift;
+                packed[0] = sample & 0xFF;
+                packed[1] = (sample >> 8) & 0xFF;
+                packed[2] = (sample >> 16) & 0xFF;
+                packed += 3;
+            }
+            break;
+        }
+
+        fwrite(wave->packed, 1, packed - wave->packed, wave->file);
+        buffer += samples;
+        pcm_frames -= frames;
+    }
+}
+
+int
+close_wave_output(struct wave_output* wave)
+{
+    const unsigned bytes_per_frame =
+        wave->channel_count * wave->bytes_per_sample;
+    unsigned data_size;
+    int result = 0;
+
+    if (!wave->raw && !wave->seekable && !wave->open_ended) {
+        /*pad a short stream with silence to its header's length*/
+        memset(wave->packed, 0, BUFFER_SIZE * bytes_per_frame);
+        while (wave->total_pcm_frames < wave->header_pcm_frames) {
+            const unsigned remaining =
+                wave->header_pcm_frames - wave->total_pcm_frames;
+            const unsigned frames =
+                remaining < BUFFER_SIZE ? remaining : BUFFER_SIZE;
+            fwrite(wave->packed, bytes_per_frame, frames, wave->file);
+            wave->total_pcm_frames += frames;
+        }
+    }
+
+    data_size = wave->total_pcm_frames * bytes_per_frame;
+
+    /*the data chunk is padded to an even size*/
+    if (!wave->raw && (data_size % 2)) {
+        fputc(0, wave->file);
+    }
+
+    if (!wave->raw &&
+        !wave->open_ended &&
+        (wave->total_pcm_frames != wave->header_pcm_frames)) {
+        /*go back and write finished RIFF WAVE header
+          and drop any preallocated space left unused*/
+        fflush(wave->file);
+        if (ftruncate(fileno(wave->file),
+                      WAVE_HEADER_SIZE + data_size + (data_size % 2))) {
+            fprintf(stderr, "*** Error: unable to truncate \"%s\"\n",
+                    wave->output_path);
         }
-        total_pcm_frames += frames_read;
+        fseek(wave->file, 0, SEEK_SET);
+        write_wave_file_header(wave, wave->total_pcm_frames);
+    }
+
+    if (wave->file == stdout) {
+        result = (fflush(wave->file) != 0) || ferror(wave->file);
+    } else {
+        result = ferror(wave->file) != 0;
+        result = (fclose(wave->file) != 0) || result;
     }
+    free(wave->packed);
+
+    if (result) {
+        fprintf(stderr, "*** Error: unable to write \"%s\"\n",
+                wave->output_path);
+    } else {
+        fprintf(wave->log, "* Wrote: \"%s\"\n", wave->output_path);
+    }
+    free(wave->output_path);
+    return result;
+}
+
+void
+write_wave_file_header(struct wave_output* wave,
+                       unsigned total_pcm_frames)
+{
+    BitstreamRecorder* header = bw_open_recorder(BS_LITTLE_ENDIAN);
 
-    /*go back and write finished RIFF WAVE header*/
-    output->setpos(output, file_start);
-    file_start->del(file_start);
     write_wave_header(
-        output,
-        dvda_sample_rate(track_reader),
-        channel_count,
-        dvda_riff_wave_channel_mask(track_reader),
-        bits_per_sample,
+        (BitstreamWriter*)header,
+        wave->sample_rate,
+        wave->channel_count,
+        wave->channel_mask,
+        wave->bits_per_sample,
         total_pcm_frames);
 
-    output->close(output);
+    if (wave->open_ended) {
+        /*RIFF and data chunk sizes of 0xFFFFFFFF
+          mark a stream whose length isn't known*/
+        uint8_t data[WAVE_HEADER_SIZE];
+
+        memcpy(data, header->data(header), WAVE_HEADER_SIZE);
+        memset(data + 4, 0xFF, 4);
+        memset(data + WAVE_HEADER_SIZE - 4, 0xFF, 4);
+        fwrite(data, 1, WAVE_HEADER_SIZE, wave->file);
+    } else {
+        fwrite(header->data(header),
+               1,
+               header->bytes_written(header),
+               wave->file);
+    }
+
+    header->close(header);
+    wave->header_pcm_frames = total_pcm_frames;
+}
+
+int
+titleset_start_track(void* sink_data,
+                     unsigned title_num,
+                     unsigned track_num,
+                     const DVDA_Track_Reader* track_reader)
+{
+    struct titleset_output* titleset_output = sink_data;
+    char track_name[] = "track-XX-XX.wav";
+    char *output_path;
+
+    snprintf(track_name, sizeof(track_name),
+             "track-%2.2d-%2.2d.wav",
+             title_num,
+             track_num);
+
+    output_path = join_paths(titleset_output->output_dir, track_name);
+
+    /*a track that can't be written is skipped
+      rather than stopping the rest of the title set*/
+    titleset_output->is_open = open_wave_output(&titleset_output->wave,
+                                                track_reader,
+                                                output_path,
+                                                0,
+                                                0,
+                                                stdout);
+
+    free(output_path);
+    return 0;
+}
+
+int
+titleset_write(void* sink_data,
+               const int buffer[],
+               unsigned pcm_frames)
+{
+    struct titleset_output* titleset_output = sink_data;
 
-    printf("* Wrote: \"%s\"\n", output_path);
+    if (titleset_output->is_open) {
+        write_wave_data(&titleset_output->wave, buffer, pcm_frames);
+    }
+    return 0;
+}
+
+int
+titleset_finish_track(void* sink_data)
+{
+    struct titleset_output* titleset_output = sink_data;
+
+    if (titleset_output->is_open) {
+        close_wave_output(&titleset_output->wave);
+        titleset_output->is_open = 0;
+    }
+    return 0;
 }
 
 void
@@ -365,7 +1038,8 @@ write_wave_header(BitstreamWriter* output,
     const uint8_t sub_format[] = {1, 0, 0, 0, 0, 0, 16, 0,
                                   128, 0, 0, 170, 0, 56, 155, 113};
 
-    const unsigned bytes_per_sample = bits_per_sample / 8;
+    /*20 bps samples are stored in 24 bit containers*/
+    const unsigned bytes_per_sample = (bits_per_sample + 7) / 8;
     const unsigned avg_bytes_per_second =
         sample_rate * channel_count * bytes_per_sample;
     const unsigned block_align =
@@ -388,7 +1062,7 @@ write_wave_header(BitstreamWriter* output,
                   sample_rate,
                   avg_bytes_per_second,
                   block_align,
-                  bits_per_sample,
+                  bytes_per_sample * 8,
                   22, /*CB size*/
                   bits_per_sample,
                   channel_mask,